@@ -0,0 +1,382 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#ifdef __linux__
+# define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+# include <windows.h>
+#endif
+#ifdef __linux__
+# include <sched.h>
+#endif
+/**************************************/
+#include "Bench.h"
+#include "Spectrice.h"
+/**************************************/
+#define ALIGNMENT 64
+/**************************************/
+
+void Bench_DefaultOptions(struct Bench_Options_t *Opt) {
+	Opt->CsvFilename   = NULL;
+	Opt->JsonFilename  = NULL;
+	Opt->CPU           = 0;
+	Opt->nReps         = 200;
+	Opt->MinSampleTime = 20.0e-6;
+	Opt->WarmupTime    = 0.05;
+	Opt->Perf          = 1;
+}
+
+int Bench_ParseOption(struct Bench_Options_t *Opt, const char *Arg) {
+	if(!memcmp(Arg, "-csv:", 5)) {
+		Opt->CsvFilename = *(Arg + 5) ? (Arg + 5) : NULL;
+	}
+
+	else if(!memcmp(Arg, "-json:", 6)) {
+		Opt->JsonFilename = *(Arg + 6) ? (Arg + 6) : NULL;
+	}
+
+	else if(!memcmp(Arg, "-cpu:", 5)) {
+		Opt->CPU = atoi(Arg + 5);
+	}
+
+	else if(!memcmp(Arg, "-reps:", 6)) {
+		int x = atoi(Arg + 6);
+		if(x > 0) Opt->nReps = x;
+		else printf("WARNING: Ignoring invalid parameter to reps (%d)\n", x);
+	}
+
+	else if(!memcmp(Arg, "-mintime:", 9)) {
+		double x = atof(Arg + 9);
+		if(x > 0.0) Opt->MinSampleTime = x;
+		else printf("WARNING: Ignoring invalid parameter to mintime (%s)\n", Arg + 9);
+	}
+
+	else if(!memcmp(Arg, "-warmup:", 8)) {
+		double x = atof(Arg + 8);
+		if(x >= 0.0) Opt->WarmupTime = x;
+		else printf("WARNING: Ignoring invalid parameter to warmup (%s)\n", Arg + 8);
+	}
+
+	else if(!memcmp(Arg, "-perf:", 6)) {
+		Opt->Perf = atoi(Arg + 6) != 0;
+	}
+
+	else return 0;
+	return 1;
+}
+
+void Bench_PrintOptionsUsage(void) {
+	printf(
+		" -csv:FILE       - Write results to FILE as CSV.\n"
+		" -json:FILE      - Write results to FILE as JSON.\n"
+		" -cpu:0          - Pin to this CPU (-1 = don't pin).\n"
+		" -reps:200       - Set number of timed samples per measurement.\n"
+		" -mintime:2e-5   - Set minimum time per sample (seconds).\n"
+		" -warmup:0.05    - Set warm-up time per measurement (seconds).\n"
+		" -perf:1         - Read hardware performance counters (Linux only).\n"
+	);
+}
+
+/**************************************/
+
+double Bench_GetTime(void) {
+#ifdef _WIN32
+	LARGE_INTEGER Freq, Count;
+	QueryPerformanceFrequency(&Freq);
+	QueryPerformanceCounter(&Count);
+	return (double)Count.QuadPart / (double)Freq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1.0e-9;
+#endif
+}
+
+int Bench_PinCPU(int CPU) {
+	if(CPU < 0) return 1;
+#if defined(_WIN32)
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << CPU) != 0;
+#elif defined(__linux__)
+	cpu_set_t Set;
+	CPU_ZERO(&Set);
+	CPU_SET(CPU, &Set);
+	return sched_setaffinity(0, sizeof(Set), &Set) == 0;
+#else
+	return 0;
+#endif
+}
+
+void *Bench_AlignedAlloc(size_t Size) {
+	//! Store the original pointer just before the aligned block
+	char *Base = malloc(Size + ALIGNMENT + sizeof(void*));
+	if(!Base) return NULL;
+	char *Ptr = Base + sizeof(void*);
+	Ptr += (-(uintptr_t)Ptr) & (ALIGNMENT-1);
+	((void**)Ptr)[-1] = Base;
+	return Ptr;
+}
+
+void Bench_AlignedFree(void *Ptr) {
+	if(Ptr) free(((void**)Ptr)[-1]);
+}
+
+/**************************************/
+
+//! Hardware counters for the main thread
+//! These are opened on the first measurement, and stay open until exit.
+static struct Perf_t Perf;
+static int PerfState = 0; //! 0 = Not opened yet, 1 = Opened, -1 = Unavailable
+
+static int OpenPerf(void) {
+	if(PerfState == 0) {
+		if(Perf_Open(&Perf)) PerfState = 1;
+		else {
+			printf(
+				"WARNING: Hardware counters are unavailable (%s; perf_event_paranoid = %d); reporting times only.\n",
+				strerror(Perf.Error), Perf_GetParanoid()
+			);
+			PerfState = -1;
+		}
+	}
+	return PerfState > 0;
+}
+
+int Bench_HasCounter(int Counter) {
+	return PerfState > 0 && Perf_Has(&Perf, Counter);
+}
+
+/**************************************/
+
+static int CompareDouble(const void *a, const void *b) {
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+void Bench_GetStats(struct Bench_Stats_t *Stats, double *Samples, int nSamples) {
+	int n;
+	double Sum = 0.0;
+	qsort(Samples, nSamples, sizeof(double), CompareDouble);
+	for(n=0;n<nSamples;n++) Sum += Samples[n];
+	Stats->Min    = Samples[0];
+	Stats->Median = (nSamples & 1) ? Samples[nSamples/2] : 0.5*(Samples[nSamples/2-1] + Samples[nSamples/2]);
+	Stats->P99    = Samples[(int)(0.99 * (nSamples-1) + 0.5)];
+	Stats->Mean   = Sum / nSamples;
+}
+
+void Bench_Measure(struct Bench_Stats_t *Stats, const struct Bench_Options_t *Opt, Bench_Func_t Func, void *User) {
+	int n;
+
+	//! Warm up (caches, branch predictors, clock frequency), doubling the
+	//! number of calls until one sample is long enough
+	int nCalls = 1;
+	double WarmupEnd = Bench_GetTime() + Opt->WarmupTime;
+	for(;;) {
+		double t = Bench_GetTime();
+		Func(User, nCalls);
+		t = Bench_GetTime() - t;
+		if(t < Opt->MinSampleTime && nCalls < (1<<24)) nCalls *= 2;
+		else if(Bench_GetTime() >= WarmupEnd) break;
+	}
+
+	//! Take samples
+	double *Samples = malloc(sizeof(double) * Opt->nReps);
+	if(!Samples) {
+		memset(Stats, 0, sizeof(struct Bench_Stats_t));
+		return;
+	}
+	int HaveCounters = Opt->Perf && OpenPerf();
+	uint64_t Counters0[PERF_COUNTER_COUNT], Counters1[PERF_COUNTER_COUNT];
+	if(HaveCounters) Perf_Read(&Perf, Counters0);
+	for(n=0;n<Opt->nReps;n++) {
+		double t = Bench_GetTime();
+		Func(User, nCalls);
+		Samples[n] = (Bench_GetTime() - t) / nCalls;
+	}
+	if(HaveCounters) Perf_Read(&Perf, Counters1);
+	Bench_GetStats(Stats, Samples, Opt->nReps);
+	free(Samples);
+
+	//! Counters include the timer reads, but these are negligible next to
+	//! MinSampleTime worth of work
+	Stats->HaveCounters = HaveCounters;
+	for(n=0;n<PERF_COUNTER_COUNT;n++) {
+		Stats->Counters[n] = HaveCounters ? (double)(Counters1[n] - Counters0[n]) / ((double)nCalls * Opt->nReps) : 0.0;
+	}
+}
+
+void Bench_FormatCounters(char *Buf, size_t BufSize, const struct Bench_Stats_t *Stats) {
+	const double *c = Stats->Counters;
+	size_t Len = 0;
+	Buf[0] = '\0';
+	if(!Stats->HaveCounters) return;
+	if(Bench_HasCounter(PERF_CYCLES) && Bench_HasCounter(PERF_INSTRUCTIONS) && c[PERF_CYCLES] > 0.0) {
+		Len += snprintf(Buf + Len, BufSize - Len, " IPC %.2f", c[PERF_INSTRUCTIONS] / c[PERF_CYCLES]);
+	}
+	if(Len < BufSize && Bench_HasCounter(PERF_L1D_LOADS) && Bench_HasCounter(PERF_L1D_MISSES) && c[PERF_L1D_LOADS] > 0.0) {
+		Len += snprintf(Buf + Len, BufSize - Len, " L1D %.2f%%", c[PERF_L1D_MISSES] * 100.0 / c[PERF_L1D_LOADS]);
+	}
+	if(Len < BufSize && Bench_HasCounter(PERF_LLC_LOADS) && Bench_HasCounter(PERF_LLC_MISSES) && c[PERF_LLC_LOADS] > 0.0) {
+		Len += snprintf(Buf + Len, BufSize - Len, " LLC %.2f%%", c[PERF_LLC_MISSES] * 100.0 / c[PERF_LLC_LOADS]);
+	}
+	if(Len < BufSize && Bench_HasCounter(PERF_BRANCH_MISSES)) {
+		snprintf(Buf + Len, BufSize - Len, " BrMiss %.1f", c[PERF_BRANCH_MISSES]);
+	}
+}
+
+/**************************************/
+
+int Bench_Output_Open(struct Bench_Output_t *Out, const struct Bench_Options_t *Opt, const char *Name) {
+	memset(Out, 0, sizeof(struct Bench_Output_t));
+	if(Opt->CsvFilename) {
+		Out->Csv = fopen(Opt->CsvFilename, "w");
+		if(!Out->Csv) {
+			printf("ERROR: Unable to create CSV file (%s).\n", Opt->CsvFilename);
+			return 0;
+		}
+	}
+	if(Opt->JsonFilename) {
+		Out->Json = fopen(Opt->JsonFilename, "w");
+		if(!Out->Json) {
+			printf("ERROR: Unable to create JSON file (%s).\n", Opt->JsonFilename);
+			if(Out->Csv) fclose(Out->Csv);
+			Out->Csv = NULL;
+			return 0;
+		}
+
+		//! Describe the build, so that runs can be matched up when diffing
+		fprintf(
+			Out->Json,
+			"{\n"
+			" \"benchmark\": \"%s\",\n"
+			" \"build\": {\n"
+			"  \"version\": %d,\n"
+			"  \"compiler\": \"%s\",\n"
+			"  \"date\": \"%s %s\",\n"
+			"  \"sse\": %d, \"avx\": %d, \"avx2\": %d, \"fma\": %d\n"
+			" },\n"
+			" \"options\": { \"cpu\": %d, \"reps\": %d, \"mintime\": %g, \"warmup\": %g, \"perf\": %d },\n"
+			" \"results\": [",
+			Name,
+			SPECTRICE_VERSION,
+#ifdef __VERSION__
+			__VERSION__,
+#else
+			"unknown",
+#endif
+			__DATE__, __TIME__,
+#ifdef __SSE__
+			1,
+#else
+			0,
+#endif
+#ifdef __AVX__
+			1,
+#else
+			0,
+#endif
+#ifdef __AVX2__
+			1,
+#else
+			0,
+#endif
+#ifdef __FMA__
+			1,
+#else
+			0,
+#endif
+			Opt->CPU, Opt->nReps, Opt->MinSampleTime, Opt->WarmupTime, Opt->Perf
+		);
+	}
+	return 1;
+}
+
+void Bench_Output_Close(struct Bench_Output_t *Out) {
+	if(Out->Csv) fclose(Out->Csv);
+	if(Out->Json) {
+		fprintf(Out->Json, "\n ]\n}\n");
+		fclose(Out->Json);
+	}
+	Out->Csv  = NULL;
+	Out->Json = NULL;
+}
+
+/**************************************/
+
+//! Append a formatted field to a CSV line
+static void AppendCsv(char *Line, const char *Fmt, const char *Sep, const char *Value) {
+	size_t Len = strlen(Line);
+	snprintf(Line + Len, 1024 - Len, Fmt, Sep, Value);
+}
+
+//! Add a field that has already been formatted
+static void AddField(struct Bench_Output_t *Out, const char *Key, const char *Value, int Quoted) {
+	const char *Sep = Out->nFields ? "," : "";
+	if(Out->nRecords == 0) AppendCsv(Out->CsvHeader, "%s%s", Sep, Key);
+	AppendCsv(Out->CsvRow, "%s%s", Sep, Value);
+	if(Out->Json) {
+		fprintf(Out->Json, Quoted ? "%s\"%s\": \"%s\"" : "%s\"%s\": %s", Out->nFields ? ", " : "", Key, Value);
+	}
+	Out->nFields++;
+}
+
+void Bench_Output_Begin(struct Bench_Output_t *Out) {
+	Out->nFields   = 0;
+	Out->CsvRow[0] = '\0';
+	if(Out->Json) fprintf(Out->Json, "%s\n  { ", Out->nRecords ? "," : "");
+}
+
+void Bench_Output_Str(struct Bench_Output_t *Out, const char *Key, const char *Value) {
+	AddField(Out, Key, Value, 1);
+}
+
+void Bench_Output_Int(struct Bench_Output_t *Out, const char *Key, long long Value) {
+	char Buf[32];
+	snprintf(Buf, sizeof(Buf), "%lld", Value);
+	AddField(Out, Key, Buf, 0);
+}
+
+void Bench_Output_Num(struct Bench_Output_t *Out, const char *Key, double Value) {
+	char Buf[32];
+	snprintf(Buf, sizeof(Buf), "%.6g", Value);
+	AddField(Out, Key, Buf, 0);
+}
+
+void Bench_Output_Counters(struct Bench_Output_t *Out, const struct Bench_Stats_t *Stats) {
+	int n;
+	const double *c = Stats->Counters;
+	if(!Stats->HaveCounters) return;
+	for(n=0;n<PERF_COUNTER_COUNT;n++) {
+		if(Bench_HasCounter(n)) Bench_Output_Num(Out, Perf_GetCounterName(n), c[n]);
+	}
+	if(Bench_HasCounter(PERF_CYCLES) && Bench_HasCounter(PERF_INSTRUCTIONS)) {
+		Bench_Output_Num(Out, "ipc", (c[PERF_CYCLES] > 0.0) ? (c[PERF_INSTRUCTIONS] / c[PERF_CYCLES]) : 0.0);
+	}
+	if(Bench_HasCounter(PERF_L1D_LOADS) && Bench_HasCounter(PERF_L1D_MISSES)) {
+		Bench_Output_Num(Out, "l1d_miss_rate", (c[PERF_L1D_LOADS] > 0.0) ? (c[PERF_L1D_MISSES] / c[PERF_L1D_LOADS]) : 0.0);
+	}
+	if(Bench_HasCounter(PERF_LLC_LOADS) && Bench_HasCounter(PERF_LLC_MISSES)) {
+		Bench_Output_Num(Out, "llc_miss_rate", (c[PERF_LLC_LOADS] > 0.0) ? (c[PERF_LLC_MISSES] / c[PERF_LLC_LOADS]) : 0.0);
+	}
+}
+
+void Bench_Output_End(struct Bench_Output_t *Out) {
+	if(Out->Csv) {
+		if(Out->nRecords == 0) fprintf(Out->Csv, "%s\n", Out->CsvHeader);
+		fprintf(Out->Csv, "%s\n", Out->CsvRow);
+	}
+	if(Out->Json) fprintf(Out->Json, " }");
+	Out->nRecords++;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
@@ -0,0 +1,137 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#pragma once
+/**************************************/
+#include <stddef.h>
+#include <stdio.h>
+/**************************************/
+#include "Perf.h"
+/**************************************/
+
+//! Common benchmark options
+struct Bench_Options_t {
+	const char *CsvFilename;  //! CSV output (NULL = none)
+	const char *JsonFilename; //! JSON output (NULL = none)
+	int    CPU;               //! CPU to pin the benchmark to (-1 = don't pin)
+	int    nReps;             //! Timed samples per measurement
+	double MinSampleTime;     //! Minimum time per sample (seconds)
+	double WarmupTime;        //! Warm-up time per measurement (seconds)
+	int    Perf;              //! Read hardware counters (0 = False, 1 = True)
+};
+
+//! Timing statistics (all in seconds)
+//! Counters[] are the hardware counts per call over all timed samples,
+//! when HaveCounters is set (see Bench_HasCounter()).
+struct Bench_Stats_t {
+	double Min;
+	double Median;
+	double P99;
+	double Mean;
+	int    HaveCounters;
+	double Counters[PERF_COUNTER_COUNT];
+};
+
+//! Result writer
+//! Each result is a record of named fields, written as a CSV row (after a
+//! header taken from the first record) and as an object in a JSON array.
+struct Bench_Output_t {
+	FILE *Csv;
+	FILE *Json;
+	int   nRecords;
+	int   nFields;
+	char  CsvHeader[1024];
+	char  CsvRow[1024];
+};
+
+/**************************************/
+
+//! Bench_DefaultOptions(Opt)
+//! Description: Set default options.
+void Bench_DefaultOptions(struct Bench_Options_t *Opt);
+
+//! Bench_ParseOption(Opt, Arg)
+//! Description: Parse a common option (-csv:FILE, -json:FILE, -cpu:N,
+//!              -reps:N, -mintime:SECONDS, -warmup:SECONDS, -perf:0|1).
+//! Returns: 1 if the option was handled, or 0 otherwise.
+int Bench_ParseOption(struct Bench_Options_t *Opt, const char *Arg);
+
+//! Bench_PrintOptionsUsage()
+//! Description: Print usage text for the common options.
+void Bench_PrintOptionsUsage(void);
+
+/**************************************/
+
+//! Bench_GetTime()
+//! Description: Get a monotonic timestamp.
+//! Returns: Time in seconds.
+double Bench_GetTime(void);
+
+//! Bench_PinCPU(CPU)
+//! Description: Pin the calling thread to one CPU.
+//! Returns: On success, returns 1. On failure, returns 0.
+int Bench_PinCPU(int CPU);
+
+//! Bench_AlignedAlloc(Size), Bench_AlignedFree(Ptr)
+//! Description: Allocate/free memory aligned to 64 bytes.
+void *Bench_AlignedAlloc(size_t Size);
+void  Bench_AlignedFree(void *Ptr);
+
+//! Bench_GetStats(Stats, Samples, nSamples)
+//! Description: Get statistics from timing samples.
+//! NOTE: Samples are sorted in-place.
+void Bench_GetStats(struct Bench_Stats_t *Stats, double *Samples, int nSamples);
+
+//! Bench_Measure(Stats, Opt, Func, User)
+//! Description: Time Func(User, nCalls), which must do nCalls iterations
+//!              of the work to measure. After warming up, the number of
+//!              calls per sample is chosen so that each sample takes at
+//!              least Opt->MinSampleTime, and Opt->nReps samples are taken.
+//! Returns: Statistics per call.
+//!              If Opt->Perf is set, hardware counters are also read
+//!              around the timed samples; these only count work done on
+//!              the calling thread. When counters are unavailable, a
+//!              warning is printed once and only times are reported.
+//! Returns: Statistics per call.
+typedef void (*Bench_Func_t)(void *User, int nCalls);
+void Bench_Measure(struct Bench_Stats_t *Stats, const struct Bench_Options_t *Opt, Bench_Func_t Func, void *User);
+
+//! Bench_HasCounter(Counter)
+//! Returns: 1 if the PERF_x counter was available to Bench_Measure(), or 0 otherwise.
+int Bench_HasCounter(int Counter);
+
+//! Bench_FormatCounters(Buf, BufSize, Stats)
+//! Description: Format IPC, L1D/LLC miss rates and branch misses per call
+//!              as a short string, for whichever counters are available
+//!              (empty if none).
+void Bench_FormatCounters(char *Buf, size_t BufSize, const struct Bench_Stats_t *Stats);
+
+/**************************************/
+
+//! Bench_Output_Open(Out, Opt, Name)
+//! Description: Open the CSV/JSON outputs given in Opt.
+//! Returns: On success, returns 1. On failure, returns 0 (a message is printed).
+int Bench_Output_Open(struct Bench_Output_t *Out, const struct Bench_Options_t *Opt, const char *Name);
+
+//! Bench_Output_Close(Out)
+//! Description: Finish and close the outputs.
+void Bench_Output_Close(struct Bench_Output_t *Out);
+
+//! Record writing
+//! Fields must be given in the same order for every record.
+void Bench_Output_Begin(struct Bench_Output_t *Out);
+void Bench_Output_Str  (struct Bench_Output_t *Out, const char *Key, const char *Value);
+void Bench_Output_Int  (struct Bench_Output_t *Out, const char *Key, long long Value);
+void Bench_Output_Num  (struct Bench_Output_t *Out, const char *Key, double Value);
+void Bench_Output_End  (struct Bench_Output_t *Out);
+
+//! Bench_Output_Counters(Out, Stats)
+//! Description: Add the available hardware counters (per call) and the
+//!              rates derived from them to the current record.
+void Bench_Output_Counters(struct Bench_Output_t *Out, const struct Bench_Stats_t *Stats);
+
+/**************************************/
+//! EOF
+/**************************************/
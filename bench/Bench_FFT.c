@@ -0,0 +1,154 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/**************************************/
+#include "Bench.h"
+#include "Fourier.h"
+/**************************************/
+#define MIN_SIZE 16
+#define MAX_SIZE 65536
+/**************************************/
+
+//! Transforms to measure
+//! MixedRadix is set for transforms that take sizes other than powers of two.
+struct Transform_t {
+	const char *Name;
+	void (*Func)(float *Buf, float *Tmp, int N);
+	int MixedRadix;
+};
+
+static const struct Transform_t Transforms[] = {
+	{ "FFTReCenter",  Fourier_FFTReCenter,  1 },
+	{ "iFFTReCenter", Fourier_iFFTReCenter, 1 },
+	{ "DCT2",         Fourier_DCT2,         0 },
+	{ "DCT4",         Fourier_DCT4,         0 },
+};
+#define N_TRANSFORMS (int)(sizeof(Transforms) / sizeof(Transforms[0]))
+
+//! Work descriptor
+//! NOTE: The transforms are in-place and grow the data on every call, so
+//! the input is copied in before each call (as the library does). The copy
+//! is timed separately and subtracted.
+struct Work_t {
+	const struct Transform_t *Transform; //! NULL = copy only
+	const float *Src;
+	float *Buf;
+	float *Tmp;
+	int    N;
+};
+
+static void DoWork(void *User, int nCalls) {
+	struct Work_t *Work = (struct Work_t*)User;
+	int n;
+	for(n=0;n<nCalls;n++) {
+		memcpy(Work->Buf, Work->Src, sizeof(float) * Work->N);
+		if(Work->Transform) Work->Transform->Func(Work->Buf, Work->Tmp, Work->N);
+	}
+}
+
+/**************************************/
+
+int main(int argc, const char *argv[]) {
+	int n, t, N;
+	int MinSize = MIN_SIZE, MaxSize = MAX_SIZE;
+	int Mixed = 0;
+	struct Bench_Options_t Opt;
+	Bench_DefaultOptions(&Opt);
+	for(n=1;n<argc;n++) {
+		if(Bench_ParseOption(&Opt, argv[n])) continue;
+		if(!memcmp(argv[n], "-minsize:", 9)) MinSize = atoi(argv[n] + 9);
+		else if(!memcmp(argv[n], "-maxsize:", 9)) MaxSize = atoi(argv[n] + 9);
+		else if(!strcmp(argv[n], "-mixed")) Mixed = 1;
+		else {
+			printf(
+				"Bench_FFT - Fourier transform microbenchmark\n"
+				"Usage: Bench_FFT [Opt]\n"
+				"Options:\n"
+				" -minsize:%-6d - Set smallest transform size.\n"
+				" -maxsize:%-6d - Set largest transform size.\n"
+				" -mixed          - Also measure sizes of 3*2^n and 5*2^n.\n",
+				MIN_SIZE, MAX_SIZE
+			);
+			Bench_PrintOptionsUsage();
+			return 1;
+		}
+	}
+	if(MinSize < MIN_SIZE) MinSize = MIN_SIZE;
+	if(MaxSize > MAX_SIZE) MaxSize = MAX_SIZE;
+	if(!Bench_PinCPU(Opt.CPU)) printf("WARNING: Unable to pin to CPU %d.\n", Opt.CPU);
+
+	struct Bench_Output_t Out;
+	if(!Bench_Output_Open(&Out, &Opt, "fft")) return -1;
+	float *Src = Bench_AlignedAlloc(sizeof(float) * MaxSize);
+	float *Buf = Bench_AlignedAlloc(sizeof(float) * MaxSize);
+	float *Tmp = Bench_AlignedAlloc(sizeof(float) * MaxSize);
+	if(!Src || !Buf || !Tmp) {
+		printf("ERROR: Couldn't allocate buffers.\n");
+		Bench_Output_Close(&Out);
+		return -1;
+	}
+	srand(1);
+	for(n=0;n<MaxSize;n++) Src[n] = rand() * (2.0f / RAND_MAX) - 1.0f;
+
+	printf("%-12s %6s %11s %11s %9s %11s\n", "Transform", "N", "Median(ns)", "P99(ns)", "GFLOP/s", "MSamples/s");
+	for(N=MinSize;N<=MaxSize;N++) {
+		int Pow2 = (N & (N-1)) == 0;
+		if(!Pow2) {
+			int m = (N % 3 == 0) ? (N / 3) : (N % 5 == 0) ? (N / 5) : 0;
+			if(!Mixed || (m & (m-1)) != 0 || !Fourier_IsFFTSize(N)) continue;
+		}
+
+		//! Time the copy on its own first
+		struct Bench_Stats_t CopyStats;
+		struct Work_t Work = { NULL, Src, Buf, Tmp, N };
+		Bench_Measure(&CopyStats, &Opt, DoWork, &Work);
+
+		for(t=0;t<N_TRANSFORMS;t++) {
+			struct Bench_Stats_t Stats;
+			if(!Pow2 && !Transforms[t].MixedRadix) continue;
+			Work.Transform = &Transforms[t];
+			Bench_Measure(&Stats, &Opt, DoWork, &Work);
+			double Median = Stats.Median - CopyStats.Median;
+			double P99    = Stats.P99    - CopyStats.Median;
+			if(Median < 0.0) Median = 0.0;
+			if(P99    < 0.0) P99    = 0.0;
+
+			//! GFLOP-equivalents use the usual 2.5*N*log2(N) for a real
+			//! transform of N points, whatever the actual operation count
+			double Flops    = 2.5 * N * log2(N);
+			double GFlops   = (Median > 0.0) ? (Flops / Median * 1.0e-9) : 0.0;
+			double MSamples = (Median > 0.0) ? (N / Median * 1.0e-6) : 0.0;
+			char Counters[128];
+			Bench_FormatCounters(Counters, sizeof(Counters), &Stats);
+			printf("%-12s %6d %11.1f %11.1f %9.3f %11.2f%s\n", Transforms[t].Name, N, Median*1.0e9, P99*1.0e9, GFlops, MSamples, Counters);
+
+			Bench_Output_Begin(&Out);
+			Bench_Output_Str(&Out, "transform",  Transforms[t].Name);
+			Bench_Output_Int(&Out, "n",          N);
+			Bench_Output_Num(&Out, "median_ns",  Median * 1.0e9);
+			Bench_Output_Num(&Out, "p99_ns",     P99    * 1.0e9);
+			Bench_Output_Num(&Out, "min_ns",     (Stats.Min - CopyStats.Median) * 1.0e9);
+			Bench_Output_Num(&Out, "copy_ns",    CopyStats.Median * 1.0e9);
+			Bench_Output_Num(&Out, "gflops",     GFlops);
+			Bench_Output_Num(&Out, "samples_per_sec", MSamples * 1.0e6);
+			Bench_Output_Counters(&Out, &Stats);
+			Bench_Output_End(&Out);
+		}
+	}
+
+	Bench_AlignedFree(Tmp);
+	Bench_AlignedFree(Buf);
+	Bench_AlignedFree(Src);
+	Bench_Output_Close(&Out);
+	return 0;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
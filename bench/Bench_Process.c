@@ -0,0 +1,235 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/**************************************/
+#include "Bench.h"
+#include "Signal.h"
+#include "Spectrice.h"
+/**************************************/
+#define SAMPLE_RATE     48000
+#define DEFAULT_SECONDS 2.0
+#define DEFAULT_REPS    3
+#define MAX_LIST        16
+/**************************************/
+
+//! Freezing modes
+#define MODE_NONE     0 //! Freeze factor 0 (plain STFT round trip)
+#define MODE_AMP      1 //! Freeze amplitude
+#define MODE_PHASE    2 //! Freeze amplitude and phase step
+#define MODE_PARTIAL  3 //! Freeze amplitude, factor 0.5
+#define MODE_SNAPSHOT 4 //! Freeze amplitude towards a snapshot
+#define MODE_BAND     5 //! Freeze amplitude below BAND_HZ only
+#define MODE_COUNT    6
+
+//! Upper edge of the frozen band for MODE_BAND
+#define BAND_HZ 4000
+
+static const char *const ModeNames[MODE_COUNT] = { "none", "amp", "phase", "partial", "snapshot", "band" };
+static const char *const WindowNames[] = { "sine", "hann", "hamming", "blackman", "nuttall", "sqrtcos", "kbd" };
+#define N_WINDOWS (int)(sizeof(WindowNames) / sizeof(WindowNames[0]))
+
+/**************************************/
+
+//! Parse a comma-separated list of integers or names
+//! Names are looked up in Names[nNames] (NULL to parse integers).
+//! Returns the number of items, or 0 on error.
+static int ParseList(int *List, const char *Str, const char *const *Names, int nNames) {
+	int nItems = 0;
+	while(*Str) {
+		int Len = strcspn(Str, ",");
+		if(nItems == MAX_LIST || Len == 0) return 0;
+		if(Names) {
+			int i;
+			for(i=0;i<nNames;i++) if((int)strlen(Names[i]) == Len && !memcmp(Str, Names[i], Len)) break;
+			if(i == nNames) return 0;
+			List[nItems++] = i;
+		} else {
+			int x = atoi(Str);
+			if(x <= 0) return 0;
+			List[nItems++] = x;
+		}
+		Str += Len;
+		if(*Str == ',') Str++;
+	}
+	return nItems;
+}
+
+//! Work descriptor
+struct Work_t {
+	struct Spectrice_t *State;
+	int    WindowType;
+	const float *Input;
+	const float *Snapshot;
+	float *Output;
+	int    nBlocks;
+	int    Ok;
+};
+
+static void DoWork(void *User, int nCalls) {
+	struct Work_t *Work = (struct Work_t*)User;
+	struct Spectrice_t *State = Work->State;
+	int n, Block;
+	int BlockFloats = State->BlockSize * State->nChan;
+	for(n=0;n<nCalls;n++) {
+		if(!Spectrice_Reinit(State, Work->WindowType, NULL, Work->Snapshot)) {
+			Work->Ok = 0;
+			return;
+		}
+		for(Block=0;Block<Work->nBlocks;Block++) {
+			Spectrice_Process(State, Work->Output, Work->Input + Block*BlockFloats);
+		}
+	}
+}
+
+/**************************************/
+
+int main(int argc, const char *argv[]) {
+	int n;
+	int BlockSizes[MAX_LIST] = { 256, 1024, 4096, 16384 }, nBlockSizes = 4;
+	int HopCounts [MAX_LIST] = { 4, 8 },                   nHopCounts  = 2;
+	int Windows   [MAX_LIST] = { SPECTRICE_WINDOW_TYPE_HANN, SPECTRICE_WINDOW_TYPE_NUTTALL }, nWindows = 2;
+	int ChanCounts[MAX_LIST] = { 1, 2, 6 },                nChanCounts = 3;
+	int Modes     [MAX_LIST] = { MODE_NONE, MODE_AMP, MODE_PHASE, MODE_PARTIAL, MODE_SNAPSHOT, MODE_BAND }, nModes = MODE_COUNT;
+	int Signals   [MAX_LIST] = { SIGNAL_TYPE_MIX },        nSignals    = 1;
+	double Seconds = DEFAULT_SECONDS;
+	struct Bench_Options_t Opt;
+	Bench_DefaultOptions(&Opt);
+	Opt.nReps = DEFAULT_REPS;
+	for(n=1;n<argc;n++) {
+		const char *Arg = argv[n];
+		int Ok = 1;
+		if(Bench_ParseOption(&Opt, Arg)) continue;
+		if     (!memcmp(Arg, "-blocksize:", 11)) Ok = (nBlockSizes = ParseList(BlockSizes, Arg + 11, NULL, 0)) > 0;
+		else if(!memcmp(Arg, "-nhops:",      7)) Ok = (nHopCounts  = ParseList(HopCounts,  Arg +  7, NULL, 0)) > 0;
+		else if(!memcmp(Arg, "-window:",     8)) Ok = (nWindows    = ParseList(Windows,    Arg +  8, WindowNames, N_WINDOWS)) > 0;
+		else if(!memcmp(Arg, "-chan:",       6)) Ok = (nChanCounts = ParseList(ChanCounts, Arg +  6, NULL, 0)) > 0;
+		else if(!memcmp(Arg, "-mode:",       6)) Ok = (nModes      = ParseList(Modes,      Arg +  6, ModeNames, MODE_COUNT)) > 0;
+		else if(!memcmp(Arg, "-seconds:",    9)) Ok = (Seconds = atof(Arg + 9)) > 0.0;
+		else if(!memcmp(Arg, "-signal:",     8)) {
+			int Type;
+			nSignals = 0;
+			if(!strcmp(Arg + 8, "all")) for(Type=0;Type<SIGNAL_TYPE_COUNT;Type++) Signals[nSignals++] = Type;
+			else {
+				const char *Names[SIGNAL_TYPE_COUNT];
+				for(Type=0;Type<SIGNAL_TYPE_COUNT;Type++) Names[Type] = Signal_GetName(Type);
+				nSignals = ParseList(Signals, Arg + 8, Names, SIGNAL_TYPE_COUNT);
+			}
+			Ok = (nSignals > 0);
+		} else Ok = 0;
+		if(!Ok) {
+			printf(
+				"Bench_Process - End-to-end processing benchmark\n"
+				"Usage: Bench_Process [Opt]\n"
+				"Every combination of the listed parameters is measured on a\n"
+				"synthetic signal (combinations the library rejects are skipped).\n"
+				"Options (lists are comma-separated):\n"
+				" -blocksize:256,1024,4096,16384 - Set block sizes.\n"
+				" -nhops:4,8          - Set hop counts.\n"
+				" -window:hann,nuttall - Set windows (sine, hann, hamming, blackman, nuttall,\n"
+				"                        sqrtcos, kbd).\n"
+				" -chan:1,2,6         - Set channel counts.\n"
+				" -mode:none,amp,phase,partial,snapshot,band - Set freezing modes.\n"
+				" -signal:mix         - Set signals (sweep, noise, decay, silence, mix, or all).\n"
+				" -seconds:%-10g - Set signal length (at %dHz).\n",
+				DEFAULT_SECONDS, SAMPLE_RATE
+			);
+			Bench_PrintOptionsUsage();
+			return 1;
+		}
+	}
+	if(!Bench_PinCPU(Opt.CPU)) printf("WARNING: Unable to pin to CPU %d.\n", Opt.CPU);
+
+	//! Allocate for the largest configuration
+	int MaxBlockSize = 0, MaxChan = 0;
+	for(n=0;n<nBlockSizes;n++) if(BlockSizes[n] > MaxBlockSize) MaxBlockSize = BlockSizes[n];
+	for(n=0;n<nChanCounts;n++) if(ChanCounts[n] > MaxChan)      MaxChan      = ChanCounts[n];
+	int nSmpMax = (int)(Seconds * SAMPLE_RATE) + MaxBlockSize;
+	float *Input  = malloc(sizeof(float) * nSmpMax * MaxChan);
+	float *Output = malloc(sizeof(float) * MaxBlockSize * MaxChan);
+	struct Bench_Output_t Out;
+	if(!Input || !Output) {
+		printf("ERROR: Couldn't allocate buffers.\n");
+		return -1;
+	}
+	if(!Bench_Output_Open(&Out, &Opt, "process")) return -1;
+
+	printf("%-7s %5s %5s %-8s %4s %-8s %10s %12s %9s\n", "Signal", "Block", "Hops", "Window", "Chan", "Mode", "Median(ms)", "MSamples/s", "Realtime");
+	int iSig, iBlk, iHop, iWin, iChn, iMod;
+	for(iSig=0;iSig<nSignals;iSig++) for(iChn=0;iChn<nChanCounts;iChn++) {
+		int nChan = ChanCounts[iChn];
+		Signal_Generate(Input, Signals[iSig], nChan, nSmpMax, SAMPLE_RATE, 1);
+		for(iBlk=0;iBlk<nBlockSizes;iBlk++) for(iHop=0;iHop<nHopCounts;iHop++) for(iWin=0;iWin<nWindows;iWin++) for(iMod=0;iMod<nModes;iMod++) {
+			int BlockSize = BlockSizes[iBlk];
+			int Mode      = Modes[iMod];
+
+			//! Freeze across the middle half of the signal
+			int nBlocks = (int)(Seconds * SAMPLE_RATE + BlockSize-1) / BlockSize;
+			int nSmp    = nBlocks * BlockSize;
+			struct Spectrice_t State;
+			State.nChan        = nChan;
+			State.BlockSize    = BlockSize;
+			State.nHops        = HopCounts[iHop];
+			State.FreezeStart  = nSmp / 4;
+			State.FreezePoint  = nSmp / 2;
+			State.FreezeFactor = (Mode == MODE_NONE) ? 0.0f : (Mode == MODE_PARTIAL) ? 0.5f : 1.0f;
+			State.FreezeAmp    = 1;
+			State.FreezePhase  = (Mode == MODE_PHASE);
+			State.FastMath     = 0;
+			State.SilenceThreshold = 0.0f;
+			State.FreezeBinLo  = 0;
+			State.FreezeBinHi  = (Mode == MODE_BAND) ? (BlockSize * BAND_HZ / SAMPLE_RATE) : BlockSize/2;
+			struct Work_t Work;
+			Work.State      = &State;
+			Work.WindowType = Windows[iWin];
+			Work.Input      = Input;
+			Work.Snapshot   = (Mode == MODE_SNAPSHOT) ? (Input + (nSmp/2)*nChan) : NULL;
+			Work.Output     = Output;
+			Work.nBlocks    = nBlocks;
+			Work.Ok         = 1;
+			if(!Spectrice_Init(&State, Work.WindowType, NULL, Work.Snapshot)) continue;
+
+			struct Bench_Stats_t Stats;
+			Bench_Measure(&Stats, &Opt, DoWork, &Work);
+			Spectrice_Destroy(&State);
+			if(!Work.Ok) continue;
+			double SmpPerSec = nSmp / Stats.Median;
+			double Realtime  = SmpPerSec / SAMPLE_RATE;
+			char Counters[128];
+			Bench_FormatCounters(Counters, sizeof(Counters), &Stats);
+			printf(
+				"%-7s %5d %5d %-8s %4d %-8s %10.2f %12.3f %8.1fx%s\n",
+				Signal_GetName(Signals[iSig]), BlockSize, HopCounts[iHop], WindowNames[Work.WindowType],
+				nChan, ModeNames[Mode], Stats.Median*1.0e3, SmpPerSec*1.0e-6, Realtime, Counters
+			);
+
+			Bench_Output_Begin(&Out);
+			Bench_Output_Str(&Out, "signal",    Signal_GetName(Signals[iSig]));
+			Bench_Output_Int(&Out, "blocksize", BlockSize);
+			Bench_Output_Int(&Out, "nhops",     HopCounts[iHop]);
+			Bench_Output_Str(&Out, "window",    WindowNames[Work.WindowType]);
+			Bench_Output_Int(&Out, "nchan",     nChan);
+			Bench_Output_Str(&Out, "mode",      ModeNames[Mode]);
+			Bench_Output_Int(&Out, "nsamples",  nSmp);
+			Bench_Output_Num(&Out, "median_ms", Stats.Median * 1.0e3);
+			Bench_Output_Num(&Out, "p99_ms",    Stats.P99    * 1.0e3);
+			Bench_Output_Num(&Out, "samples_per_sec", SmpPerSec);
+			Bench_Output_Num(&Out, "realtime",  Realtime);
+			Bench_Output_Counters(&Out, &Stats);
+			Bench_Output_End(&Out);
+		}
+	}
+
+	Bench_Output_Close(&Out);
+	free(Output);
+	free(Input);
+	return 0;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
@@ -0,0 +1,425 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/**************************************/
+#include "Bench.h"
+#include "Signal.h"
+#include "Spectrice.h"
+#include "ThreadPool.h"
+/**************************************/
+#define SAMPLE_RATE     48000
+#define DEFAULT_SECONDS 1.0
+#define DEFAULT_REPS    3
+#define MAX_LIST        16
+#define WINDOW_TYPE     SPECTRICE_WINDOW_TYPE_NUTTALL
+
+//! Segment sizing, as in CLI_RenderSegments()
+#define WINDOW_MEMORY_BUDGET (64*1024*1024)
+#define MIN_SEGMENT_BLOCKS    4
+#define MAX_SEGMENT_BLOCKS   64
+
+//! Throughput must drop by more than this before adding threads is
+//! flagged as making things slower (to ignore timing noise)
+#define SLOWDOWN_TOLERANCE 0.98
+/**************************************/
+
+//! Parallel modes
+#define MODE_SEGMENTS 0 //! One signal, split into segments after the freeze point
+#define MODE_BATCH    1 //! Several independent signals at once
+#define MODE_COUNT    2
+
+static const char *const ModeNames[MODE_COUNT] = { "segments", "batch" };
+
+/**************************************/
+
+//! Parse a comma-separated list of integers or names
+//! Names are looked up in Names[nNames] (NULL to parse integers).
+//! Returns the number of items, or 0 on error.
+static int ParseList(int *List, const char *Str, const char *const *Names, int nNames) {
+	int nItems = 0;
+	while(*Str) {
+		int Len = strcspn(Str, ",");
+		if(nItems == MAX_LIST || Len == 0) return 0;
+		if(Names) {
+			int i;
+			for(i=0;i<nNames;i++) if((int)strlen(Names[i]) == Len && !memcmp(Str, Names[i], Len)) break;
+			if(i == nNames) return 0;
+			List[nItems++] = i;
+		} else {
+			int x = atoi(Str);
+			if(x <= 0) return 0;
+			List[nItems++] = x;
+		}
+		Str += Len;
+		if(*Str == ',') Str++;
+	}
+	return nItems;
+}
+
+/**************************************/
+
+//! Shared work descriptor
+struct Work_t {
+	struct ThreadPool_t *Pool;
+	int    Mode;
+	int    nThreads;
+	int    BlockFloats;
+	int    nBlocks;     //! Blocks per signal
+	const float *Input; //! Input[nBlocks*BlockFloats]
+	int    Ok;
+
+	//! MODE_SEGMENTS
+	const struct Spectrice_t *Primed; //! State that has reached FirstBlock
+	int    FirstBlock;
+	int    nSegmentBlocks;
+	float *Output;      //! Output[nBlocks*BlockFloats]
+	struct SegmentTask_t *Segments;
+
+	//! MODE_BATCH
+	int    nJobs;
+	struct Spectrice_t *Workers; //! Per-worker state, re-initialized per job
+	float **WorkerOutput;        //! Per-worker output block
+	struct JobTask_t *Jobs;
+};
+
+//! Segment task (see CLI_Segments.c)
+struct SegmentTask_t {
+	struct Work_t *Work;
+	int BlockIdx;
+	int nBlocks;
+	int Error;
+};
+
+static void SegmentTask(void *User, int WorkerIdx) {
+	(void)WorkerIdx;
+	struct SegmentTask_t *Task = (struct SegmentTask_t*)User;
+	struct Work_t *Work = Task->Work;
+	struct Spectrice_t State;
+	int Block, BlockFloats = Work->BlockFloats;
+	if(!Spectrice_Fork(&State, Work->Primed, Task->BlockIdx, Work->Input + (Task->BlockIdx-2)*BlockFloats)) {
+		Task->Error = 1;
+		return;
+	}
+	for(Block=Task->BlockIdx;Block<Task->BlockIdx+Task->nBlocks;Block++) {
+		Spectrice_Process(&State, Work->Output + Block*BlockFloats, Work->Input + Block*BlockFloats);
+	}
+	Spectrice_Destroy(&State);
+	Task->Error = 0;
+}
+
+//! Batch job task (see CLI_Batch.c)
+struct JobTask_t {
+	struct Work_t *Work;
+	int Error;
+};
+
+static void JobTask(void *User, int WorkerIdx) {
+	struct JobTask_t *Task = (struct JobTask_t*)User;
+	struct Work_t *Work = Task->Work;
+	struct Spectrice_t *State = &Work->Workers[WorkerIdx];
+	int Block, BlockFloats = Work->BlockFloats;
+	if(!Spectrice_Reinit(State, WINDOW_TYPE, NULL, NULL)) {
+		Task->Error = 1;
+		return;
+	}
+	for(Block=0;Block<Work->nBlocks;Block++) {
+		Spectrice_Process(State, Work->WorkerOutput[WorkerIdx], Work->Input + Block*BlockFloats);
+	}
+	Task->Error = 0;
+}
+
+static void DoWork(void *User, int nCalls) {
+	struct Work_t *Work = (struct Work_t*)User;
+	int n, Call;
+	for(Call=0;Call<nCalls;Call++) {
+		if(Work->Mode == MODE_SEGMENTS) {
+			//! Window-by-window, with a barrier after each window
+			int Block = Work->FirstBlock;
+			int nWindowBlocksMax = Work->nThreads * Work->nSegmentBlocks;
+			while(Block < Work->nBlocks) {
+				int nWindowBlocks = Work->nBlocks - Block;
+				if(nWindowBlocks > nWindowBlocksMax) nWindowBlocks = nWindowBlocksMax;
+				int nTasks = (nWindowBlocks + Work->nSegmentBlocks-1) / Work->nSegmentBlocks;
+				int SegBeg = 0;
+				for(n=0;n<nTasks;n++) {
+					int SegEnd = (nWindowBlocks * (n+1)) / nTasks;
+					struct SegmentTask_t *Task = &Work->Segments[n];
+					Task->Work     = Work;
+					Task->BlockIdx = Block + SegBeg;
+					Task->nBlocks  = SegEnd - SegBeg;
+					Task->Error    = 1;
+					if(!ThreadPool_Submit(Work->Pool, SegmentTask, Task)) SegmentTask(Task, 0);
+					SegBeg = SegEnd;
+				}
+				ThreadPool_Wait(Work->Pool);
+				for(n=0;n<nTasks;n++) if(Work->Segments[n].Error) Work->Ok = 0;
+				Block += nWindowBlocks;
+			}
+		} else {
+			//! Per-worker state is only safe to run inline once the pool is idle
+			for(n=0;n<Work->nJobs;n++) {
+				Work->Jobs[n].Work  = Work;
+				Work->Jobs[n].Error = 1;
+				if(!ThreadPool_Submit(Work->Pool, JobTask, &Work->Jobs[n])) Work->Jobs[n].Error = -1;
+			}
+			ThreadPool_Wait(Work->Pool);
+			for(n=0;n<Work->nJobs;n++) if(Work->Jobs[n].Error == -1) JobTask(&Work->Jobs[n], 0);
+			for(n=0;n<Work->nJobs;n++) if(Work->Jobs[n].Error) Work->Ok = 0;
+		}
+	}
+}
+
+/**************************************/
+
+//! Measure a single configuration
+//! Returns the median time per call, or a negative value on failure.
+//! nBlocksOut receives the number of blocks processed per call.
+static double MeasureConfig(
+	const struct Bench_Options_t *Opt,
+	int Mode,
+	int nThreads,
+	int nJobs,
+	struct Spectrice_t *Base,
+	const float *Input,
+	int nBlocks,
+	int *nBlocksOut
+) {
+	int n;
+	double Result = -1.0;
+	int BlockFloats = Base->BlockSize * Base->nChan;
+	struct ThreadPool_t Pool;
+	struct Work_t Work;
+	memset(&Work, 0, sizeof(Work));
+	Work.Pool        = &Pool;
+	Work.Mode        = Mode;
+	Work.nThreads    = nThreads;
+	Work.BlockFloats = BlockFloats;
+	Work.nBlocks     = nBlocks;
+	Work.Input       = Input;
+	Work.Ok          = 1;
+	if(!ThreadPool_Create(&Pool, nThreads)) return -1.0;
+
+	int nWorkers = 0;
+	struct Spectrice_t State;
+	int HaveState = 0;
+	if(Mode == MODE_SEGMENTS) {
+		//! Prime a state up to the first frozen block
+		State = *Base;
+		if(!Spectrice_Init(&State, WINDOW_TYPE, NULL, NULL)) goto Exit;
+		HaveState = 1;
+		int FirstBlock = Spectrice_GetFrozenBlockIdx(&State);
+		if(FirstBlock < 2) FirstBlock = 2;
+		float *Tmp = malloc(sizeof(float) * BlockFloats);
+		if(!Tmp) goto Exit;
+		for(n=0;n<FirstBlock;n++) Spectrice_Process(&State, Tmp, Input + n*BlockFloats);
+		free(Tmp);
+		Work.Primed     = &State;
+		Work.FirstBlock = FirstBlock;
+		*nBlocksOut     = nBlocks - FirstBlock;
+		Work.nSegmentBlocks = WINDOW_MEMORY_BUDGET / (int)(sizeof(float) * BlockFloats * 2) / nThreads;
+		if(Work.nSegmentBlocks < MIN_SEGMENT_BLOCKS) Work.nSegmentBlocks = MIN_SEGMENT_BLOCKS;
+		if(Work.nSegmentBlocks > MAX_SEGMENT_BLOCKS) Work.nSegmentBlocks = MAX_SEGMENT_BLOCKS;
+		Work.Output   = malloc(sizeof(float) * BlockFloats * nBlocks);
+		Work.Segments = malloc(sizeof(struct SegmentTask_t) * nThreads);
+		if(!Work.Output || !Work.Segments) goto Exit;
+	} else {
+		Work.nJobs        = nJobs;
+		*nBlocksOut       = nBlocks * nJobs;
+		Work.Workers      = malloc(sizeof(struct Spectrice_t) * nThreads);
+		Work.WorkerOutput = calloc(nThreads, sizeof(float*));
+		Work.Jobs         = malloc(sizeof(struct JobTask_t) * nJobs);
+		if(!Work.Workers || !Work.WorkerOutput || !Work.Jobs) goto Exit;
+		for(nWorkers=0;nWorkers<nThreads;nWorkers++) {
+			Work.Workers[nWorkers] = *Base;
+			if(!Spectrice_Init(&Work.Workers[nWorkers], WINDOW_TYPE, NULL, NULL)) break;
+			Work.WorkerOutput[nWorkers] = malloc(sizeof(float) * BlockFloats);
+			if(!Work.WorkerOutput[nWorkers]) {
+				Spectrice_Destroy(&Work.Workers[nWorkers]);
+				break;
+			}
+		}
+		if(nWorkers < nThreads) goto Exit;
+	}
+
+	struct Bench_Stats_t Stats;
+	Bench_Measure(&Stats, Opt, DoWork, &Work);
+	if(Work.Ok) Result = Stats.Median;
+
+Exit:
+	for(n=0;n<nWorkers;n++) {
+		Spectrice_Destroy(&Work.Workers[n]);
+		free(Work.WorkerOutput[n]);
+	}
+	if(HaveState) Spectrice_Destroy(&State);
+	free(Work.Jobs);
+	free(Work.WorkerOutput);
+	free(Work.Workers);
+	free(Work.Segments);
+	free(Work.Output);
+	ThreadPool_Destroy(&Pool);
+	return Result;
+}
+
+/**************************************/
+
+int main(int argc, const char *argv[]) {
+	int n;
+	int nCPUs = ThreadPool_GetCPUCount();
+	int ThreadCounts[MAX_LIST], nThreadCounts = 0;
+	int BlockSizes[MAX_LIST] = { 1024, 4096 },         nBlockSizes = 2;
+	int ChanCounts[MAX_LIST] = { 1, 2, 8, 32, 64 },    nChanCounts = 5;
+	int Modes     [MAX_LIST] = { MODE_SEGMENTS, MODE_BATCH }, nModes = MODE_COUNT;
+	int nHops = 8, nJobs = 0;
+	double Seconds = DEFAULT_SECONDS;
+	struct Bench_Options_t Opt;
+	Bench_DefaultOptions(&Opt);
+	Opt.nReps = DEFAULT_REPS;
+	Opt.CPU   = -1;
+	Opt.Perf  = 0; //! Counters would only see the main thread
+
+	//! Default to powers of two up to the CPU count, plus the CPU count
+	for(n=1;n<nCPUs && nThreadCounts<MAX_LIST-1;n*=2) ThreadCounts[nThreadCounts++] = n;
+	ThreadCounts[nThreadCounts++] = nCPUs;
+
+	for(n=1;n<argc;n++) {
+		const char *Arg = argv[n];
+		int Ok = 1;
+		if(Bench_ParseOption(&Opt, Arg)) continue;
+		if     (!memcmp(Arg, "-threads:",   9)) Ok = (nThreadCounts = ParseList(ThreadCounts, Arg +  9, NULL, 0)) > 0;
+		else if(!memcmp(Arg, "-blocksize:",11)) Ok = (nBlockSizes   = ParseList(BlockSizes,   Arg + 11, NULL, 0)) > 0;
+		else if(!memcmp(Arg, "-chan:",      6)) Ok = (nChanCounts   = ParseList(ChanCounts,   Arg +  6, NULL, 0)) > 0;
+		else if(!memcmp(Arg, "-mode:",      6)) Ok = (nModes        = ParseList(Modes,        Arg +  6, ModeNames, MODE_COUNT)) > 0;
+		else if(!memcmp(Arg, "-nhops:",     7)) Ok = (nHops   = atoi(Arg + 7)) > 0;
+		else if(!memcmp(Arg, "-jobs:",      6)) Ok = (nJobs   = atoi(Arg + 6)) > 0;
+		else if(!memcmp(Arg, "-seconds:",   9)) Ok = (Seconds = atof(Arg + 9)) > 0.0;
+		else Ok = 0;
+		if(!Ok) {
+			printf(
+				"Bench_Scaling - Thread and channel scaling benchmark\n"
+				"Usage: Bench_Scaling [Opt]\n"
+				"Every combination of mode, block size and channel count is measured\n"
+				"over each thread count. Speedup is relative to the per-thread throughput\n"
+				"of the first thread count, and configurations that got slower than with\n"
+				"fewer threads are flagged.\n"
+				"Options (lists are comma-separated):\n"
+				" -threads:1,2,4,..   - Set thread counts (default: powers of two up to %d CPUs).\n"
+				" -blocksize:1024,4096 - Set block sizes.\n"
+				" -chan:1,2,8,32,64   - Set channel counts.\n"
+				" -mode:segments,batch - Set parallel modes.\n"
+				" -nhops:8            - Set hop count.\n"
+				" -jobs:N             - Set files per batch (default: twice the largest thread count).\n"
+				" -seconds:%-10g - Set signal length per file (at %dHz).\n",
+				nCPUs, DEFAULT_SECONDS, SAMPLE_RATE
+			);
+			Bench_PrintOptionsUsage();
+			return 1;
+		}
+	}
+	if(!Bench_PinCPU(Opt.CPU)) printf("WARNING: Unable to pin to CPU %d.\n", Opt.CPU);
+
+	//! Keep the amount of work constant over thread counts
+	int MaxThreads = 0, MaxBlockSize = 0, MaxChan = 0;
+	for(n=0;n<nThreadCounts;n++) if(ThreadCounts[n] > MaxThreads)   MaxThreads   = ThreadCounts[n];
+	for(n=0;n<nBlockSizes;n++)   if(BlockSizes[n]   > MaxBlockSize) MaxBlockSize = BlockSizes[n];
+	for(n=0;n<nChanCounts;n++)   if(ChanCounts[n]   > MaxChan)      MaxChan      = ChanCounts[n];
+	if(nJobs == 0) nJobs = MaxThreads * 2;
+	if(MaxThreads > nCPUs) printf("WARNING: Thread counts above the %d available CPUs will be oversubscribed.\n", nCPUs);
+
+	int nSmpMax = (int)(Seconds * SAMPLE_RATE) + MaxBlockSize*3;
+	float *Input = malloc(sizeof(float) * nSmpMax * MaxChan);
+	struct Bench_Output_t Out;
+	if(!Input) {
+		printf("ERROR: Couldn't allocate buffers.\n");
+		return -1;
+	}
+	if(!Bench_Output_Open(&Out, &Opt, "scaling")) {
+		free(Input);
+		return -1;
+	}
+
+	printf("%-8s %5s %4s %7s %10s %12s %8s %10s %9s\n", "Mode", "Block", "Chan", "Threads", "Median(ms)", "MSamples/s", "Speedup", "Efficiency", "IO(GB/s)");
+	int iMod, iBlk, iChn, iThr;
+	for(iChn=0;iChn<nChanCounts;iChn++) {
+		int nChan = ChanCounts[iChn];
+		Signal_Generate(Input, SIGNAL_TYPE_MIX, nChan, nSmpMax, SAMPLE_RATE, 1);
+		for(iMod=0;iMod<nModes;iMod++) for(iBlk=0;iBlk<nBlockSizes;iBlk++) {
+			int Mode      = Modes[iMod];
+			int BlockSize = BlockSizes[iBlk];
+
+			//! Freeze from the start, so that segments can start early
+			struct Spectrice_t Base;
+			Base.nChan        = nChan;
+			Base.BlockSize    = BlockSize;
+			Base.nHops        = nHops;
+			Base.FreezeStart  = 0;
+			Base.FreezePoint  = BlockSize;
+			Base.FreezeFactor = 1.0f;
+			Base.FreezeAmp    = 1;
+			Base.FreezePhase  = 0;
+			Base.FastMath     = 0;
+			Base.SilenceThreshold = 0.0f;
+			Base.FreezeBinLo  = 0;
+			Base.FreezeBinHi  = BlockSize/2;
+			int nBlocks = (int)(Seconds * SAMPLE_RATE + BlockSize-1) / BlockSize;
+			if(nBlocks < 3) nBlocks = 3;
+
+			double BaseThroughput = 0.0, BestThroughput = 0.0;
+			int    BestThreads = 0;
+			for(iThr=0;iThr<nThreadCounts;iThr++) {
+				int nThreads = ThreadCounts[iThr];
+				int    nBlocksDone = 0;
+				double Time = MeasureConfig(&Opt, Mode, nThreads, nJobs, &Base, Input, nBlocks, &nBlocksDone);
+				if(Time <= 0.0) {
+					printf("%-8s %5d %4d %7d (failed)\n", ModeNames[Mode], BlockSize, nChan, nThreads);
+					continue;
+				}
+
+				//! IO counts the input read and output written by the
+				//! processing loop, which is a lower bound on memory traffic
+				double Throughput = (double)nBlocksDone * BlockSize * nChan / Time;
+				double IO         = Throughput * sizeof(float) * 2.0;
+				if(BaseThroughput == 0.0) BaseThroughput = Throughput / (double)nThreads;
+				double Speedup    = Throughput / BaseThroughput;
+				double Efficiency = Speedup / nThreads;
+				int    Slower     = (Throughput < BestThroughput * SLOWDOWN_TOLERANCE);
+				if(Throughput > BestThroughput) {
+					BestThroughput = Throughput;
+					BestThreads    = nThreads;
+				}
+				printf(
+					"%-8s %5d %4d %7d %10.2f %12.3f %7.2fx %9.1f%% %9.3f%s\n",
+					ModeNames[Mode], BlockSize, nChan, nThreads, Time*1.0e3, Throughput*1.0e-6,
+					Speedup, Efficiency*100.0, IO*1.0e-9, Slower ? "  SLOWER" : ""
+				);
+
+				Bench_Output_Begin(&Out);
+				Bench_Output_Str(&Out, "mode",       ModeNames[Mode]);
+				Bench_Output_Int(&Out, "blocksize",  BlockSize);
+				Bench_Output_Int(&Out, "nhops",      nHops);
+				Bench_Output_Int(&Out, "nchan",      nChan);
+				Bench_Output_Int(&Out, "nthreads",   nThreads);
+				Bench_Output_Num(&Out, "median_ms",  Time * 1.0e3);
+				Bench_Output_Num(&Out, "samples_per_sec", Throughput);
+				Bench_Output_Num(&Out, "speedup",    Speedup);
+				Bench_Output_Num(&Out, "efficiency", Efficiency);
+				Bench_Output_Num(&Out, "io_bytes_per_sec", IO);
+				Bench_Output_Int(&Out, "slower",     Slower);
+				Bench_Output_End(&Out);
+			}
+			if(BestThreads) printf("%-8s %5d %4d    best: %d threads\n", ModeNames[Mode], BlockSize, nChan, BestThreads);
+		}
+	}
+
+	Bench_Output_Close(&Out);
+	free(Input);
+	return 0;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
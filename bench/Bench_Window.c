@@ -0,0 +1,348 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/**************************************/
+#include "Bench.h"
+#include "Fourier.h"
+#include "Spectrice.h"
+/**************************************/
+#define SAMPLE_RATE     48000
+#define DEFAULT_SECONDS 4.0
+#define DEFAULT_REPS    3
+#define MAX_LIST        16
+#define MAX_XFORM_SIZE  65536
+/**************************************/
+
+//! Test tones (Hz and amplitude), spread over 60dB, and placed away from
+//! the centres of the lines at any block size
+static const struct {
+	double Freq;
+	double Amp;
+} Tones[] = {
+	{  220.7, 0.25    },
+	{ 1003.3, 0.025   },
+	{ 4517.9, 0.0025  },
+	{ 9871.1, 0.00025 },
+};
+#define N_TONES (int)(sizeof(Tones) / sizeof(Tones[0]))
+
+//! Tremolo on the input of the amplitude freezing test
+#define TREMOLO_HZ    5.0
+#define TREMOLO_DEPTH 0.5
+
+//! Freezing tests
+#define TEST_SUSTAIN 0 //! Freeze amplitude and phase step of steady tones
+#define TEST_TREMOLO 1 //! Freeze amplitude of tones with a tremolo
+#define TEST_COUNT   2
+
+static const char *const WindowNames[] = { "sine", "hann", "hamming", "blackman", "nuttall", "sqrtcos", "kbd" };
+#define N_WINDOWS (int)(sizeof(WindowNames) / sizeof(WindowNames[0]))
+
+/**************************************/
+
+//! Parse a comma-separated list of integers or names
+//! Names are looked up in Names[nNames] (NULL to parse integers).
+//! Returns the number of items, or 0 on error.
+static int ParseList(int *List, const char *Str, const char *const *Names, int nNames) {
+	int nItems = 0;
+	while(*Str) {
+		int Len = strcspn(Str, ",");
+		if(nItems == MAX_LIST || Len == 0) return 0;
+		if(Names) {
+			int i;
+			for(i=0;i<nNames;i++) if((int)strlen(Names[i]) == Len && !memcmp(Str, Names[i], Len)) break;
+			if(i == nNames) return 0;
+			List[nItems++] = i;
+		} else {
+			int x = atoi(Str);
+			if(x <= 0) return 0;
+			List[nItems++] = x;
+		}
+		Str += Len;
+		if(*Str == ',') Str++;
+	}
+	return nItems;
+}
+
+/**************************************/
+
+//! Window shape measurements
+struct WindowShape_t {
+	double PeakSidelobe; //! Highest sidelobe, relative to the main lobe (dB)
+	double MainLobe;     //! Half-width of the main lobe, to its first minimum (in lines)
+	double ENBW;         //! Equivalent noise bandwidth (in lines)
+};
+
+//! Measure the shape of State's window, using Buf[MAX_XFORM_SIZE*2]
+//! The window is zero-padded by as much as fits, so that the spectrum is
+//! sampled between the lines as well.
+static void MeasureWindow(struct WindowShape_t *Shape, const struct Spectrice_t *State, float *Buf) {
+	int n;
+	int N  = State->BlockSize;
+	int OS = 1; while(OS < 16 && N*OS*2 <= MAX_XFORM_SIZE) OS *= 2;
+	int M  = N * OS;
+	double Sum = 0.0, SumSq = 0.0;
+	for(n=0;n<M;n++) Buf[n] = 0.0f;
+	for(n=0;n<N/2;n++) {
+		Buf[n] = Buf[N-1-n] = State->Window[n];
+		Sum   += 2.0*State->Window[n];
+		SumSq += 2.0*(double)State->Window[n]*State->Window[n];
+	}
+	Fourier_FFTReCenter(Buf, Buf+M, M);
+
+	//! Lines of the padded transform are at (k+0.5)/OS lines of the window,
+	//! so the main lobe peaks at k=0; find its end, then the highest peak
+	//! beyond that (up to Nyquist)
+	int k = 0;
+	double Peak = (double)Buf[0]*Buf[0] + (double)Buf[1]*Buf[1];
+	double Prev = Peak, Highest = 0.0;
+	for(k=1;k<M/2;k++) {
+		double x = (double)Buf[k*2+0]*Buf[k*2+0] + (double)Buf[k*2+1]*Buf[k*2+1];
+		if(x > Prev) break;
+		Prev = x;
+	}
+	Shape->MainLobe = (k-1 + 0.5) / OS;
+	for(;k<M/2;k++) {
+		double x = (double)Buf[k*2+0]*Buf[k*2+0] + (double)Buf[k*2+1]*Buf[k*2+1];
+		if(x > Highest) Highest = x;
+	}
+	Shape->PeakSidelobe = 10.0*log10(Highest / Peak + 1.0e-30);
+	Shape->ENBW = N * SumSq / (Sum*Sum);
+}
+
+/**************************************/
+
+//! Generate the test tones
+static void GenerateTones(float *Out, int nSmp, int Tremolo) {
+	int n, t;
+	for(n=0;n<nSmp;n++) {
+		double Time = (double)n / SAMPLE_RATE;
+		double Gain = Tremolo ? (1.0 - TREMOLO_DEPTH*0.5*(1.0 - cos(2*M_PI*TREMOLO_HZ*Time))) : 1.0;
+		double x = 0.0;
+		for(t=0;t<N_TONES;t++) x += Tones[t].Amp * sin(2*M_PI*Tones[t].Freq*Time);
+		Out[n] = (float)(Gain * x);
+	}
+}
+
+//! Get the signal-to-noise ratio of x[N] against steady test tones (dB)
+//! The tones are fitted by projecting onto each of them, which is as good
+//! as a least-squares fit for tones this far apart over a long enough
+//! span. Anything that doesn't fit (distortion, leakage between lines,
+//! left-over modulation) counts as noise.
+static double GetToneSNR(const float *x, int N) {
+	int n, t;
+	double a[N_TONES], b[N_TONES];
+	for(t=0;t<N_TONES;t++) {
+		double w = 2*M_PI*Tones[t].Freq / SAMPLE_RATE;
+		a[t] = b[t] = 0.0;
+		for(n=0;n<N;n++) {
+			a[t] += x[n] * cos(w*n);
+			b[t] += x[n] * sin(w*n);
+		}
+		a[t] *= 2.0 / N;
+		b[t] *= 2.0 / N;
+	}
+	double Signal = 0.0, Noise = 0.0;
+	for(n=0;n<N;n++) {
+		double Fit = 0.0;
+		for(t=0;t<N_TONES;t++) {
+			double w = 2*M_PI*Tones[t].Freq / SAMPLE_RATE;
+			Fit += a[t]*cos(w*n) + b[t]*sin(w*n);
+		}
+		Signal += Fit*Fit;
+		Noise  += (x[n] - Fit)*(x[n] - Fit);
+	}
+	return 10.0*log10(Signal / (Noise + 1.0e-30));
+}
+
+/**************************************/
+
+//! Work descriptor
+struct Work_t {
+	struct Spectrice_t *State;
+	int    WindowType;
+	const float *Input;
+	float *Output;
+	int    nBlocks;
+	int    Ok;
+};
+
+static void DoWork(void *User, int nCalls) {
+	struct Work_t *Work = (struct Work_t*)User;
+	struct Spectrice_t *State = Work->State;
+	int n, Block;
+	int BlockSize = State->BlockSize;
+	for(n=0;n<nCalls;n++) {
+		if(!Spectrice_Reinit(State, Work->WindowType, NULL, NULL)) {
+			Work->Ok = 0;
+			return;
+		}
+		for(Block=0;Block<Work->nBlocks;Block++) {
+			Spectrice_Process(State, Work->Output + Block*BlockSize, Work->Input + Block*BlockSize);
+		}
+	}
+}
+
+//! Set up a mono state that freezes fully at FreezePoint
+static void SetupState(struct Spectrice_t *State, int BlockSize, int nHops, int FreezePoint, int FreezePhase) {
+	State->nChan        = 1;
+	State->BlockSize    = BlockSize;
+	State->nHops        = nHops;
+	State->FreezeStart  = FreezePoint;
+	State->FreezePoint  = FreezePoint;
+	State->FreezeFactor = 1.0f;
+	State->FreezeAmp    = 1;
+	State->FreezePhase  = FreezePhase;
+	State->FastMath     = 0;
+	State->SilenceThreshold = 0.0f;
+	State->FreezeBinLo  = 0;
+	State->FreezeBinHi  = BlockSize/2;
+}
+
+/**************************************/
+
+int main(int argc, const char *argv[]) {
+	int n, i;
+	int BlockSizes[MAX_LIST] = { 4096 },      nBlockSizes = 1;
+	int HopCounts [MAX_LIST] = { 2, 4, 8 },   nHopCounts  = 3;
+	int Windows   [MAX_LIST] = { 0, 1, 2, 3, 4, 5, 6 }, nWindows = N_WINDOWS;
+	double Seconds = DEFAULT_SECONDS;
+	struct Bench_Options_t Opt;
+	Bench_DefaultOptions(&Opt);
+	Opt.nReps = DEFAULT_REPS;
+	for(n=1;n<argc;n++) {
+		const char *Arg = argv[n];
+		int Ok = 1;
+		if(Bench_ParseOption(&Opt, Arg)) continue;
+		if     (!memcmp(Arg, "-blocksize:", 11)) Ok = (nBlockSizes = ParseList(BlockSizes, Arg + 11, NULL, 0)) > 0;
+		else if(!memcmp(Arg, "-nhops:",      7)) Ok = (nHopCounts  = ParseList(HopCounts,  Arg +  7, NULL, 0)) > 0;
+		else if(!memcmp(Arg, "-window:",     8)) Ok = (nWindows    = ParseList(Windows,    Arg +  8, WindowNames, N_WINDOWS)) > 0;
+		else if(!memcmp(Arg, "-seconds:",    9)) Ok = (Seconds = atof(Arg + 9)) > 0.0;
+		else Ok = 0;
+		for(i=0;Ok && i<nBlockSizes;i++) if(BlockSizes[i] > MAX_XFORM_SIZE/2) Ok = 0;
+		if(!Ok) {
+			printf(
+				"Bench_Window - Window quality and cost benchmark\n"
+				"Usage: Bench_Window [Opt]\n"
+				"Every window is measured at every hop count it supports: the shape\n"
+				"of its spectrum, the quality of freezing a set of test tones, and\n"
+				"the processing speed.\n"
+				"Options (lists are comma-separated):\n"
+				" -blocksize:4096     - Set block sizes (at most %d).\n"
+				" -nhops:2,4,8        - Set hop counts.\n"
+				" -window:X,Y         - Set windows (sine, hann, hamming, blackman, nuttall,\n"
+				"                       sqrtcos, kbd; default: all).\n"
+				" -seconds:%-10g - Set signal length (at %dHz).\n",
+				MAX_XFORM_SIZE/2, DEFAULT_SECONDS, SAMPLE_RATE
+			);
+			Bench_PrintOptionsUsage();
+			return 1;
+		}
+	}
+	if(!Bench_PinCPU(Opt.CPU)) printf("WARNING: Unable to pin to CPU %d.\n", Opt.CPU);
+
+	//! Allocate for the largest block size
+	int MaxBlockSize = 0;
+	for(n=0;n<nBlockSizes;n++) if(BlockSizes[n] > MaxBlockSize) MaxBlockSize = BlockSizes[n];
+	int nSmpMax = (int)(Seconds * SAMPLE_RATE) + MaxBlockSize;
+	float *Input[TEST_COUNT], *Output;
+	float *XformBuf = Bench_AlignedAlloc(sizeof(float) * MAX_XFORM_SIZE * 2);
+	Input[TEST_SUSTAIN] = malloc(sizeof(float) * nSmpMax);
+	Input[TEST_TREMOLO] = malloc(sizeof(float) * nSmpMax);
+	Output = malloc(sizeof(float) * nSmpMax);
+	struct Bench_Output_t Out;
+	if(!XformBuf || !Input[TEST_SUSTAIN] || !Input[TEST_TREMOLO] || !Output) {
+		printf("ERROR: Couldn't allocate buffers.\n");
+		return -1;
+	}
+	GenerateTones(Input[TEST_SUSTAIN], nSmpMax, 0);
+	GenerateTones(Input[TEST_TREMOLO], nSmpMax, 1);
+	if(!Bench_Output_Open(&Out, &Opt, "window")) return -1;
+
+	printf(
+		"%-8s %5s %4s %9s %9s %6s %11s %11s %10s %9s\n",
+		"Window", "Block", "Hops", "Sidelobe", "MainLobe", "ENBW", "Sustain(dB)", "Tremolo(dB)", "Median(ms)", "Realtime"
+	);
+	int iBlk, iHop, iWin;
+	for(iBlk=0;iBlk<nBlockSizes;iBlk++) for(iWin=0;iWin<nWindows;iWin++) for(iHop=0;iHop<nHopCounts;iHop++) {
+		int BlockSize  = BlockSizes[iBlk];
+		int nHops      = HopCounts[iHop];
+		int WindowType = Windows[iWin];
+
+		//! Freeze a quarter of the way in, and measure over everything
+		//! from two blocks after that (once the frozen blocks are all that
+		//! is left in the output) to the end
+		int nBlocks     = (int)(Seconds * SAMPLE_RATE + BlockSize-1) / BlockSize;
+		int nSmp        = nBlocks * BlockSize;
+		int FreezePoint = (nBlocks / 4) * BlockSize;
+		int TailStart   = FreezePoint + 3*BlockSize;
+		if(TailStart >= nSmp) continue;
+
+		//! Freeze each test signal, keeping the state of the tremolo test
+		//! for timing
+		int Test;
+		double SNR[TEST_COUNT];
+		struct Spectrice_t State;
+		for(Test=0;Test<TEST_COUNT;Test++) {
+			struct Work_t Work;
+			SetupState(&State, BlockSize, nHops, FreezePoint, (Test == TEST_SUSTAIN));
+			if(!Spectrice_Init(&State, WindowType, NULL, NULL)) break;
+			Work.State      = &State;
+			Work.WindowType = WindowType;
+			Work.Input      = Input[Test];
+			Work.Output     = Output;
+			Work.nBlocks    = nBlocks;
+			Work.Ok         = 1;
+			DoWork(&Work, 1);
+			SNR[Test] = GetToneSNR(Output + TailStart, nSmp - TailStart);
+			if(Test != TEST_COUNT-1) Spectrice_Destroy(&State);
+		}
+		if(Test != TEST_COUNT) continue;
+
+		struct WindowShape_t Shape;
+		MeasureWindow(&Shape, &State, XformBuf);
+		struct Work_t Work = { &State, WindowType, Input[TEST_TREMOLO], Output, nBlocks, 1 };
+		struct Bench_Stats_t Stats;
+		Bench_Measure(&Stats, &Opt, DoWork, &Work);
+		Spectrice_Destroy(&State);
+		if(!Work.Ok) continue;
+		double SmpPerSec = nSmp / Stats.Median;
+		double Realtime  = SmpPerSec / SAMPLE_RATE;
+		printf(
+			"%-8s %5d %4d %9.1f %9.2f %6.3f %11.1f %11.1f %10.2f %8.1fx\n",
+			WindowNames[WindowType], BlockSize, nHops,
+			Shape.PeakSidelobe, Shape.MainLobe, Shape.ENBW,
+			SNR[TEST_SUSTAIN], SNR[TEST_TREMOLO], Stats.Median*1.0e3, Realtime
+		);
+
+		Bench_Output_Begin(&Out);
+		Bench_Output_Str(&Out, "window",        WindowNames[WindowType]);
+		Bench_Output_Int(&Out, "blocksize",     BlockSize);
+		Bench_Output_Int(&Out, "nhops",         nHops);
+		Bench_Output_Num(&Out, "sidelobe_db",   Shape.PeakSidelobe);
+		Bench_Output_Num(&Out, "mainlobe",      Shape.MainLobe);
+		Bench_Output_Num(&Out, "enbw",          Shape.ENBW);
+		Bench_Output_Num(&Out, "sustain_snr_db", SNR[TEST_SUSTAIN]);
+		Bench_Output_Num(&Out, "tremolo_snr_db", SNR[TEST_TREMOLO]);
+		Bench_Output_Num(&Out, "median_ms",     Stats.Median * 1.0e3);
+		Bench_Output_Num(&Out, "realtime",      Realtime);
+		Bench_Output_End(&Out);
+	}
+
+	Bench_Output_Close(&Out);
+	free(Output);
+	free(Input[TEST_TREMOLO]);
+	free(Input[TEST_SUSTAIN]);
+	Bench_AlignedFree(XformBuf);
+	return 0;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
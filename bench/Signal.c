@@ -0,0 +1,130 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <math.h>
+#include <string.h>
+/**************************************/
+#include "Signal.h"
+/**************************************/
+#define PEAK_LEVEL 0.5f //! -6dBFS
+
+#define SWEEP_MIN_FREQ 20.0
+
+#define DECAY_RETRIGGER 0.5   //! Seconds between notes
+#define DECAY_TIME      0.15  //! Seconds to decay by 1/e
+#define DECAY_N_TONES   3
+#define DECAY_MIN_FREQ  50.0
+#define DECAY_MAX_FREQ  5000.0
+/**************************************/
+
+void Signal_RandomSeed(struct Signal_Random_t *Rand, uint64_t Seed) {
+	//! Scramble the seed so that nearby seeds give unrelated sequences
+	Seed += 0x9E3779B97F4A7C15ull;
+	Seed  = (Seed ^ (Seed >> 30)) * 0xBF58476D1CE4E5B9ull;
+	Seed  = (Seed ^ (Seed >> 27)) * 0x94D049BB133111EBull;
+	Seed ^= Seed >> 31;
+	Rand->State = Seed ? Seed : 1;
+}
+
+float Signal_RandomFloat(struct Signal_Random_t *Rand) {
+	//! xorshift64*, top 24 bits
+	uint64_t x = Rand->State;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	Rand->State = x;
+	x *= 0x2545F4914F6CDD1Dull;
+	return (int32_t)(x >> 40) * (1.0f / (1 << 23)) - 1.0f;
+}
+
+/**************************************/
+
+static const char *const SignalNames[SIGNAL_TYPE_COUNT] = {
+	"sweep",
+	"noise",
+	"decay",
+	"silence",
+	"mix",
+};
+
+const char *Signal_GetName(int Type) {
+	return (Type >= 0 && Type < SIGNAL_TYPE_COUNT) ? SignalNames[Type] : NULL;
+}
+
+int Signal_FromName(const char *Name) {
+	int Type;
+	for(Type=0;Type<SIGNAL_TYPE_COUNT;Type++) if(!strcmp(Name, SignalNames[Type])) return Type;
+	return -1;
+}
+
+/**************************************/
+
+//! Add a single-channel signal to Out[n*Stride]
+static void AddMono(float *Out, int Stride, int Type, int nSmp, int SampleRate, uint64_t Seed, float Gain) {
+	int n;
+	struct Signal_Random_t Rand;
+	Signal_RandomSeed(&Rand, Seed);
+	switch(Type) {
+		case SIGNAL_TYPE_SWEEP: {
+			//! Logarithmic sweep over the whole signal, with the phase
+			//! integrated analytically so that it doesn't drift
+			double f0 = SWEEP_MIN_FREQ;
+			double f1 = SampleRate * 0.5;
+			double T  = (double)nSmp / SampleRate;
+			double k  = log(f1 / f0);
+			for(n=0;n<nSmp;n++) {
+				double t = (double)n / SampleRate;
+				double Phase = 2.0*M_PI * f0 * T / k * (exp(k * t / T) - 1.0);
+				Out[n*Stride] += Gain * (float)sin(Phase);
+			}
+		} break;
+
+		case SIGNAL_TYPE_NOISE: {
+			for(n=0;n<nSmp;n++) Out[n*Stride] += Gain * Signal_RandomFloat(&Rand);
+		} break;
+
+		case SIGNAL_TYPE_DECAY: {
+			//! Every note is a few tones at random (log-spaced) frequencies
+			int i, NoteLen = (int)(DECAY_RETRIGGER * SampleRate);
+			double Freq[DECAY_N_TONES];
+			for(n=0;n<nSmp;n++) {
+				int t = n % NoteLen;
+				if(t == 0) for(i=0;i<DECAY_N_TONES;i++) {
+					double r = Signal_RandomFloat(&Rand) * 0.5 + 0.5;
+					Freq[i] = DECAY_MIN_FREQ * pow(DECAY_MAX_FREQ / DECAY_MIN_FREQ, r);
+				}
+				double Sum = 0.0;
+				double Env = exp(-t / (DECAY_TIME * SampleRate));
+				for(i=0;i<DECAY_N_TONES;i++) Sum += sin(2.0*M_PI * Freq[i] * t / SampleRate);
+				Out[n*Stride] += Gain * (float)(Sum * Env / DECAY_N_TONES);
+			}
+		} break;
+
+		case SIGNAL_TYPE_SILENCE:
+		default: break;
+	}
+}
+
+void Signal_Generate(float *Out, int Type, int nChan, int nSmp, int SampleRate, uint64_t Seed) {
+	int Chan;
+	memset(Out, 0, sizeof(float) * nSmp * nChan);
+	for(Chan=0;Chan<nChan;Chan++) {
+		uint64_t ChanSeed = Seed * 0x100000001B3ull + Chan;
+		if(Type == SIGNAL_TYPE_MIX) {
+			//! Cycle through sweep/noise/decay as the main signal of each
+			//! channel, with the next one in the cycle 6dB under it, and
+			//! leave every fourth channel silent
+			if(Chan % 4 == 3) continue;
+			int Main = SIGNAL_TYPE_SWEEP + (Chan % 3);
+			int Side = SIGNAL_TYPE_SWEEP + (Chan + 1) % 3;
+			AddMono(Out + Chan, nChan, Main, nSmp, SampleRate, ChanSeed,   PEAK_LEVEL * (2.0f/3.0f));
+			AddMono(Out + Chan, nChan, Side, nSmp, SampleRate, ChanSeed+1, PEAK_LEVEL * (1.0f/3.0f));
+		} else AddMono(Out + Chan, nChan, Type, nSmp, SampleRate, ChanSeed, PEAK_LEVEL);
+	}
+}
+
+/**************************************/
+//! EOF
+/**************************************/
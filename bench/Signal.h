@@ -0,0 +1,53 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#pragma once
+/**************************************/
+#include <stdint.h>
+/**************************************/
+
+//! Available test signals
+#define SIGNAL_TYPE_SWEEP   0 //! Logarithmic sine sweep, 20Hz..Nyquist
+#define SIGNAL_TYPE_NOISE   1 //! Uniform white noise
+#define SIGNAL_TYPE_DECAY   2 //! Exponentially-decaying tones, retriggered
+#define SIGNAL_TYPE_SILENCE 3 //! Digital silence
+#define SIGNAL_TYPE_MIX     4 //! A different mix of the above in every channel
+#define SIGNAL_TYPE_COUNT   5
+
+/**************************************/
+
+//! Deterministic random number generator
+//! This is used instead of rand() so that signals are identical on every
+//! platform and C library.
+struct Signal_Random_t {
+	uint64_t State;
+};
+
+void  Signal_RandomSeed (struct Signal_Random_t *Rand, uint64_t Seed);
+float Signal_RandomFloat(struct Signal_Random_t *Rand); //! Uniform, [-1.0, +1.0)
+
+/**************************************/
+
+//! Signal_GetName(Type), Signal_FromName(Name)
+//! Description: Convert between signal types and names.
+//! Returns: Name of signal (or NULL), or signal type (or -1).
+const char *Signal_GetName (int Type);
+int         Signal_FromName(const char *Name);
+
+//! Signal_Generate(Out, Type, nChan, nSmp, SampleRate, Seed)
+//! Description: Generate a test signal.
+//! Arguments:
+//!   Out:        Output buffer (Out[nSmp*nChan], interleaved).
+//!   Type:       Signal type (SIGNAL_TYPE_*).
+//!   nChan:      Number of channels.
+//!   nSmp:       Number of sample points.
+//!   SampleRate: Sample rate (only affects frequencies and durations).
+//!   Seed:       Random seed. The output only depends on the arguments.
+//! Peak level is at most -6dBFS.
+void Signal_Generate(float *Out, int Type, int nChan, int nSmp, int SampleRate, uint64_t Seed);
+
+/**************************************/
+//! EOF
+/**************************************/
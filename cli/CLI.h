@@ -0,0 +1,501 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#pragma once
+/**************************************/
+#include <stdint.h>
+/**************************************/
+#include "MapFile.h"
+#include "Spectrice.h"
+#include "WavIO.h"
+/**************************************/
+
+//! Possible output formats
+#define FORMAT_PCM8    0
+#define FORMAT_PCM16   1
+#define FORMAT_PCM24   2
+#define FORMAT_FLOAT32 3
+#define FORMAT_DEFAULT 4
+
+//! Freeze point search (see CLI_FindFreezePoints())
+#define FREEZEPOINT_AUTO (-1)
+
+//! Spectrum dump formats (see CLI_SpectrumDump_Open())
+#define DUMPFORMAT_F16  0
+#define DUMPFORMAT_LOG8 1
+
+/**************************************/
+
+//! Processing options
+struct CLI_Options_t {
+	int   BlockSize;
+	int   nHops;
+	int   FreezeAmp;
+	int   FreezePhase;
+	int   WindowType;
+	int   FreezeXFade;
+	int   FreezePoint;  //! 0 = loop start, FREEZEPOINT_AUTO = loop start or search
+	int   SnapshotPos;
+	int   SnapshotEnd;  //! End of averaged snapshot range (-1 = single block)
+	int   SnapshotHop;  //! Hop between averaged frames (0 = BlockSize/2)
+	float SnapshotGain;
+	const char *SnapshotBank;     //! Snapshot bank file (NULL = none)
+	const char *SnapshotName;     //! Snapshot to use from the bank (NULL = none)
+	int   LoopProcess;
+	float FreezeFactor;
+	float FreezeBandLo; //! Lowest frequency to freeze (in Hz)
+	float FreezeBandHi; //! Highest frequency to freeze (in Hz; 0 = Nyquist)
+	int   FormatType;
+	int   nThreads;     //! Worker threads (0 = one per CPU)
+	int   Quiet;        //! Suppress progress output
+	const char *AnalysisCacheDir; //! Directory for analysis cache files (NULL = none)
+	int   Preview;      //! Only render around the freeze point
+	int   PreviewPre;   //! Samples before FreezeStart to render (-1 = 1 second)
+	int   PreviewPost;  //! Samples after FreezePoint to render (-1 = 1 second)
+	int   PreviewFast;  //! Trade accuracy for speed in preview
+	float SilenceThreshold; //! Input level treated as silence (0.0 = exact silence only)
+	const char *ResultCacheDir;   //! Directory for cached output files (NULL = none)
+	const char *CheckpointFile;   //! File to checkpoint rendering into (NULL = none)
+	int   CheckpointInterval;     //! Seconds between checkpoints
+	const char *TraceFile;        //! File to write a timeline trace to (NULL = none)
+	const char *StatsJsonFile;    //! File to write run statistics to (NULL = none)
+	const char *TelemetryFile;    //! File to write per-block telemetry to (NULL = none)
+	const char *DumpFile;         //! File to dump spectra to (NULL = none)
+	int   DumpFormat;   //! DUMPFORMAT_x
+	int   DumpPhase;    //! Also dump the phase step
+};
+
+//! Input stream (handles loop wrap-around)
+struct CLI_InputStream_t {
+	struct WAV_State_t *File;
+	int LoopProcess;
+	int LoopLen;
+	int nLoopSamplesRem;
+};
+
+//! Mapped analysis cache
+struct CLI_AnalysisCache_t {
+	struct MapFile_t Map;
+	const float *Spectra; //! Spectra[nBlocks][BlockFloats]
+	int BlockFloats;
+	int nBlocks;
+};
+
+//! Render checkpoint
+//! History, StateData and StateSize are only set by CLI_Checkpoint_Load(),
+//! and point into the mapped checkpoint file.
+struct CLI_Checkpoint_t {
+	uint64_t Key;             //! From CLI_Checkpoint_GetKey()
+	int      ProcStart;       //! Sample point where processing started
+	int      Block;           //! Next block to render
+	int      nSamplesRem;     //! Sample points left to render from Block
+	uint32_t nOutputSmpTotal; //! Sample points already in the output file
+	uint32_t InputPosition;   //! Input file read position
+	int      nLoopSamplesRem; //! Input stream loop state
+	int      nHistory;        //! Floats in History (last two blocks of input)
+	const float *History;
+	const void  *StateData;
+	size_t       StateSize;
+	struct MapFile_t Map;
+};
+
+//! Per-thread processing context
+//! The Spectrice state and the I/O buffers are kept between files, so that
+//! a worker only re-allocates when it meets a file that needs more memory.
+struct CLI_Worker_t {
+	int    HaveState;
+	struct Spectrice_t State;
+	float *Buffer;
+	int    BufferSize;
+};
+
+//! Render statistics
+struct CLI_RenderStats_t {
+	int      nChan;
+	uint32_t SampleRate;
+	uint32_t nInputSamplePoints;
+	uint32_t nOutputSamplePoints;
+	int      CacheHit;  //! Output was copied from the result cache
+	uint64_t nBytesRead;    //! Input actually read (eg. only part of it for previews)
+	uint64_t nBytesWritten;
+	uint64_t nClipped;  //! Output samples clipped (all variants)
+	int      HaveStageStats;
+	struct Spectrice_Stats_t StageStats; //! Only when HaveStageStats
+};
+
+//! Statistics for a whole run (see CLI_RunStats_Write())
+struct CLI_RunStats_t {
+	double   StartWallTime;
+	double   StartCPUTime;
+	int      nThreads;
+	int      nFiles;
+	int      nFailed;
+	int      nCacheHits;
+	uint64_t nInputSamplePoints;
+	uint64_t nOutputSamplePoints;
+	uint64_t nOutputSamples;      //! Over all channels
+	double   AudioTime;           //! Seconds of output
+	uint64_t nBytesRead;
+	uint64_t nBytesWritten;
+	uint64_t nClipped;
+	int      HaveStageStats;
+	struct Spectrice_Stats_t StageStats;
+};
+
+//! Per-block telemetry output (see CLI_Telemetry_Write())
+struct CLI_Telemetry_t {
+	FILE    *File;
+	int      nChan;
+	int      BlockSize;
+	uint32_t PositionBase; //! Output position of block 0
+	struct Spectrice_Telemetry_t *Chans; //! [nChan], for the current block
+};
+
+//! Spectrum dump output (see CLI_SpectrumDump_Open())
+struct CLI_SpectrumDump_t {
+	FILE    *File;
+	int      Format;
+	int      Phase;
+	int      nChan;
+	int      nHops;
+	int      nBins;
+	int      ElemSize;   //! Bytes per bin
+	size_t   FrameSize;  //! Bytes per frame
+	float    Scale;      //! Normalization for magnitudes
+	uint8_t *Frames;     //! [nHops][FrameSize], for the current block
+	float   *PrevArg;    //! [nChan][nBins] (only with Phase)
+	uint64_t nFrames;    //! Frames written so far
+};
+
+//! Progress display state (see CLI_Progress_Update())
+struct CLI_Progress_t {
+	int    Quiet;
+	int    LastBlock; //! Last block that was displayed
+	double NextTime;
+};
+
+/**************************************/
+
+//! Set default options
+void CLI_DefaultOptions(struct CLI_Options_t *Opt);
+
+//! Parse a single option
+//! Returns 0 on a fatal error (a message is printed), or 1 otherwise.
+//! Invalid or unknown arguments are ignored with a warning.
+int CLI_ParseOption(struct CLI_Options_t *Opt, const char *Arg);
+
+//! Check whether two sets of options can share the same analysis (ie. they
+//! only differ in the freezing parameters and output format)
+int CLI_OptionsShareAnalysis(const struct CLI_Options_t *a, const struct CLI_Options_t *b);
+
+//! Hash all options that affect the output (for caching results)
+//! NOTE: This must be kept up to date when adding new options.
+uint64_t CLI_HashOptions(uint64_t Hash, const struct CLI_Options_t *Opt);
+
+//! Split a line into tokens (in-place)
+//! Tokens are separated by whitespace, and may be enclosed in double quotes.
+//! Lines starting with '#' are comments, and have no tokens.
+//! Returns the number of tokens, or -1 if there are more than MaxTokens.
+int CLI_TokenizeLine(char *Line, char **Tokens, int MaxTokens);
+
+/**************************************/
+
+//! Initialize/destroy worker context
+void CLI_WorkerInit   (struct CLI_Worker_t *Worker);
+void CLI_WorkerDestroy(struct CLI_Worker_t *Worker);
+
+//! Process a single file
+//! Returns 0 on success, or -1 on failure (a message is printed).
+//! Stats may be NULL.
+int CLI_RenderFile(
+	struct CLI_Worker_t *Worker,
+	const char *InFilename,
+	const char *OutFilename,
+	const struct CLI_Options_t *Opt,
+	struct CLI_RenderStats_t *Stats
+);
+
+//! Process a single file, going through the result cache (Opt->ResultCacheDir)
+//! Results are keyed by the contents of the input file, all options that
+//! affect the output, and the library version. On a hit, the cached output
+//! is copied (or reflinked, where supported); on a miss, the file is
+//! rendered and then published to the cache atomically.
+//! Returns 0 on success, or -1 on failure (a message is printed).
+int CLI_ResultCache_Render(
+	struct CLI_Worker_t *Worker,
+	const char *InFilename,
+	const char *OutFilename,
+	const struct CLI_Options_t *Opt,
+	struct CLI_RenderStats_t *Stats
+);
+
+//! Process a single file into several variants (Opts[nVariants]) that
+//! share the same analysis; see CLI_OptionsShareAnalysis(). The input is
+//! only decoded and analyzed once, and each variant only does its own
+//! freezing and re-synthesis. The output of each variant is identical to
+//! what CLI_RenderFile() would produce with the same options.
+//! Returns 0 on success, or -1 on failure (a message is printed).
+int CLI_RenderVariants(
+	struct CLI_Worker_t *Worker,
+	const char *InFilename,
+	const char *const *OutFilenames,
+	const struct CLI_Options_t *Opts,
+	int nVariants,
+	struct CLI_RenderStats_t *Stats
+);
+
+//! Read nSmp sample points from stream, then pad with silence up to nSmpTotal
+void CLI_ReadStream(struct CLI_InputStream_t *Stream, float *Dst, int nSmp, int nSmpTotal);
+
+/**************************************/
+
+//! Initialize a state that is only used for analysis (the window, the
+//! forward transform and scratch memory), with no freezing
+//! Returns 1 on success, or 0 on failure (no message is printed).
+int CLI_InitAnalysisState(struct Spectrice_t *State, int nChan, int BlockSize, int nHops, int WindowType);
+
+//! Open the analysis cache for a file, building it if it doesn't exist or
+//! doesn't match. Stream must describe the input file from its beginning
+//! (ie. nLoopSamplesRem is the loop end point); it is not modified.
+//! Block k of the cache holds the spectra that Spectrice_Analyze() would
+//! output for the stream block starting at sample point GridOffset +
+//! k*BlockSize (0 <= GridOffset < BlockSize).
+//! Returns 1 on success, or 0 on failure (a warning is printed, and the
+//! caller should fall back to processing without the cache).
+int CLI_AnalysisCache_Open(
+	struct CLI_AnalysisCache_t *Cache,
+	const char *CacheDir,
+	const char *InFilename,
+	const struct CLI_InputStream_t *Stream,
+	int BlockSize,
+	int nHops,
+	int WindowType,
+	int GridOffset,
+	int Quiet
+);
+void CLI_AnalysisCache_Close(struct CLI_AnalysisCache_t *Cache);
+
+/**************************************/
+
+//! Get the key identifying a render job, so that a checkpoint is only ever
+//! resumed by the same job (input file, output file and options)
+uint64_t CLI_Checkpoint_GetKey(const char *InFilename, const char *OutFilename, const struct CLI_Options_t *Opt);
+
+//! Save a checkpoint (atomically replacing any previous one)
+//! History[Ckpt->nHistory] must hold the last two blocks of input.
+//! Returns 1 on success, or 0 on failure (a warning is printed).
+int CLI_Checkpoint_Save(
+	const char *Filename,
+	const struct CLI_Checkpoint_t *Ckpt,
+	const float *History,
+	const struct Spectrice_t *State
+);
+
+//! Load a checkpoint, if it exists and matches Key and nHistory
+//! Returns 1 on success, or 0 if there is nothing to resume from (a
+//! warning is printed if the file exists but doesn't match).
+int  CLI_Checkpoint_Load (struct CLI_Checkpoint_t *Ckpt, const char *Filename, uint64_t Key, int nHistory);
+void CLI_Checkpoint_Close(struct CLI_Checkpoint_t *Ckpt);
+
+/**************************************/
+
+//! Build a snapshot bank from a list of snapshots
+//! Each line of the list contains a name, an input file, and optionally the
+//! sample position to capture the snapshot from (default: 0), which may also
+//! be a range to average over (Start,End[,Hop]; see -snapshot). All spectra
+//! are made with the block size, hops and window from Opt.
+//! Returns 0 on success, or -1 on failure (a message is printed).
+int CLI_SnapshotBank_Build(const char *BankFilename, const char *ListFilename, const struct CLI_Options_t *Opt);
+
+//! Map a snapshot bank and find a snapshot in it
+//! Returns the spectrum (Abs[nChan][BlockSize/2], for use with
+//! Spectrice_SetSnapshotSpectrum()), or NULL on failure (a message is
+//! printed). The spectrum stays valid until MapFile_Close(Map).
+const float *CLI_SnapshotBank_Open(
+	struct MapFile_t *Map,
+	const char *Filename,
+	const char *Name,
+	int nChan,
+	int BlockSize,
+	int nHops,
+	int WindowType
+);
+
+/**************************************/
+
+//! Capture a snapshot averaged over several frames
+//! Frames of BlockSize sample points are taken every Hop sample points from
+//! File, starting at Start and ending no later than End (but always at least
+//! one frame). Their power spectra are averaged (Welch's method) on nThreads
+//! worker threads (0 = one per CPU), and the resulting magnitudes are stored
+//! to Abs[nChan][BlockSize/2] for use with Spectrice_SetSnapshotSpectrum().
+//! The result does not depend on nThreads.
+//! Returns 1 on success, or 0 on failure (a message is printed).
+int CLI_CaptureSnapshot(
+	const struct Spectrice_t *State,
+	float *Abs,
+	struct WAV_State_t *File,
+	int Start,
+	int End,
+	int Hop,
+	int nThreads
+);
+
+/**************************************/
+
+//! Search a file for freeze points
+//! Proposes up to nPoints freeze points (best first) at or past MinPoint,
+//! where the spectrum is most stationary: the spectral flux around the
+//! point is low, and the spectrum at the point is close to those around it.
+//! Silent parts of the file are never proposed. Scores (if not NULL)
+//! receives the score of each point (lower is better). The position of
+//! File is preserved. Uses the block size, hops, window and number of
+//! threads from Opt.
+//! Returns the number of points found, or -1 on failure (a message is
+//! printed).
+int CLI_FindFreezePoints(
+	struct WAV_State_t *File,
+	const struct CLI_Options_t *Opt,
+	int MinPoint,
+	int *Points,
+	float *Scores,
+	int nPoints
+);
+
+//! Print the best freeze point candidates for a file
+//! Returns 0 if any were found, or -1 otherwise.
+int CLI_RunFindFreeze(const char *InFilename, const struct CLI_Options_t *Opt);
+
+/**************************************/
+
+//! Progress display
+//! CLI_Progress_Update() prints "Block x/y" for Block (0-based), at most a
+//! few times per second (and always for the last block), so that small
+//! blocks don't flood the terminal. Nothing is printed if Quiet.
+//! CLI_Progress_Finish() shows the last block, if it wasn't already.
+void CLI_Progress_Init  (struct CLI_Progress_t *Progress, int Quiet);
+void CLI_Progress_Update(struct CLI_Progress_t *Progress, int Block, int nBlocks);
+void CLI_Progress_Finish(struct CLI_Progress_t *Progress, int nBlocks);
+
+/**************************************/
+
+//! Run statistics
+//! CLI_RunStats_Begin() notes the starting wall and CPU times, and
+//! CLI_RunStats_Add() adds the result of rendering one file (Stats may be
+//! NULL on failure). CLI_RunStats_Write() then writes everything, along
+//! with the peak memory use of the process, to Filename as JSON.
+//! Returns (CLI_RunStats_Write()): 1 on success, or 0 on failure.
+void CLI_RunStats_Begin(struct CLI_RunStats_t *Run, int nThreads);
+void CLI_RunStats_Add  (struct CLI_RunStats_t *Run, const struct CLI_RenderStats_t *Stats, int ExitCode);
+int  CLI_RunStats_Write(const struct CLI_RunStats_t *Run, const char *Filename);
+
+/**************************************/
+
+//! Per-block telemetry
+//! CLI_Telemetry_Open() creates a CSV file with a row for every block and
+//! a group of columns for every channel, and allocates Chans[nChan], which
+//! may be passed to Spectrice_SetTelemetry(). Returns 1 on success, or 0 on
+//! failure (a message is printed).
+//! CLI_Telemetry_Write() writes a row for Block from Chans[nChan] (as
+//! filled in by the library) and the number of samples clipped in that
+//! block. Levels are in dB (RMS and peak relative to full scale, and the
+//! freeze distance and gain relative to the spectral power of the input).
+//! CLI_Telemetry_Clear() clears Chans[nChan] for the next block.
+//! CLI_Telemetry_AddInput() adds the input levels of a block of nSmp sample
+//! points (Input[nSmp*nChan], interleaved) to Chans[nChan], for when the
+//! library never sees the input (ie. with cached analysis).
+int  CLI_Telemetry_Open (struct CLI_Telemetry_t *Tm, const char *Filename, int nChan, int BlockSize, uint32_t PositionBase);
+void CLI_Telemetry_Close(struct CLI_Telemetry_t *Tm);
+void CLI_Telemetry_Clear(struct Spectrice_Telemetry_t *Chans, int nChan);
+void CLI_Telemetry_AddInput(struct Spectrice_Telemetry_t *Chans, const float *Input, int nChan, int nSmp);
+void CLI_Telemetry_Write(struct CLI_Telemetry_t *Tm, int Block, const struct Spectrice_Telemetry_t *Chans, uint64_t nClipped);
+
+/**************************************/
+
+//! Spectrum dumps
+//! CLI_SpectrumDump_Open() creates a binary file holding the spectrum
+//! (after freezing) of every hop that State synthesizes, starting from
+//! output sample point Position, and allocates Frames for one block.
+//! Magnitudes are stored as float16 (DUMPFORMAT_F16; normalized so that a
+//! full-scale sine is about 1.0) or as 8-bit log magnitudes
+//! (DUMPFORMAT_LOG8). With Phase, the phase step of every bin (which gives
+//! its instantaneous frequency) is stored as well. Returns 1 on success, or 0 on
+//! failure (a message is printed).
+//! CLI_SpectrumDump_Capture() is the Spectrice_SetSpectrumFunc() callback
+//! (User = Dump), which stores hop Hop into Dump->Frames.
+//! CLI_SpectrumDump_Write() writes nBlocks blocks of frames (as captured).
+//! CLI_SpectrumDump_Close() completes the header and closes the file.
+int  CLI_SpectrumDump_Open(
+	struct CLI_SpectrumDump_t *Dump,
+	const char *Filename,
+	int Format,
+	int Phase,
+	const struct Spectrice_t *State,
+	uint32_t SampleRate,
+	uint32_t Position
+);
+void CLI_SpectrumDump_Capture(void *User, int Chan, int Hop, const float *Abs, const float *Arg);
+void CLI_SpectrumDump_Write  (struct CLI_SpectrumDump_t *Dump, const uint8_t *Frames, int nBlocks);
+int  CLI_SpectrumDump_Close  (struct CLI_SpectrumDump_t *Dump);
+
+/**************************************/
+
+//! Render the rest of a file (nSamplesRem sample points) in parallel
+//! segments, once State has reached Spectrice_GetFrozenBlockIdx().
+//! History[BlockSize*2*nChan] must contain the last two blocks of input that
+//! were passed to Spectrice_Process() (or to Spectrice_Init() for priming).
+//! Each segment is forked from State and primed with the two blocks that
+//! precede it, so the output is bit-exact with sequential processing.
+//! BlockBase and nBlocksTotal are only used for progress display (with
+//! Progress; may be NULL for none).
+//! The timing statistics of every segment are added to Stats (may be NULL),
+//! a row for every block is written to Telemetry (may be NULL), and the
+//! spectra of every block are written to Dump (may be NULL; must not have
+//! Phase, as segments don't have the hops before them).
+//! With CheckpointFile (may be NULL), a checkpoint is saved between windows
+//! every CheckpointInterval seconds. Ckpt must then have Key, ProcStart,
+//! nHistory and nOutputSmpTotal (up to where segments begin) filled out;
+//! the rest is filled out here.
+//! Returns 0 on success, or -1 on failure (a message is printed).
+int CLI_RenderSegments(
+	const struct Spectrice_t *State,
+	struct CLI_InputStream_t *Stream,
+	struct WAV_State_t *FileOut,
+	const float *History,
+	int nSamplesRem,
+	int nThreads,
+	struct CLI_Progress_t *Progress,
+	int BlockBase,
+	int nBlocksTotal,
+	struct Spectrice_Stats_t *Stats,
+	struct CLI_Telemetry_t *Telemetry,
+	struct CLI_SpectrumDump_t *Dump,
+	const char *CheckpointFile,
+	int CheckpointInterval,
+	struct CLI_Checkpoint_t *Ckpt
+);
+
+/**************************************/
+
+//! Process all the files listed in a manifest
+//! Each line of the manifest contains an input filename, an output filename,
+//! and optionally any options to apply to that file only (on top of Opt).
+//! Blank lines and lines starting with '#' are ignored, and filenames may be
+//! enclosed in double quotes.
+//! Every file is added to Run (may be NULL).
+//! Returns 0 if all files were processed, or -1 otherwise.
+int CLI_RunBatch(const char *ManifestFilename, const struct CLI_Options_t *Opt, struct CLI_RunStats_t *Run);
+
+//! Render all the variants listed in a file from a single input file
+//! Each line of the file contains an output filename, and optionally any
+//! options to apply to that variant only (on top of Opt). Only options that
+//! keep CLI_OptionsShareAnalysis() true may be used.
+//! The whole render is added to Run as one file (Run may be NULL).
+//! Returns 0 on success, or -1 on failure.
+int CLI_RunSweep(const char *InFilename, const char *VariantsFilename, const struct CLI_Options_t *Opt, struct CLI_RunStats_t *Run);
+
+/**************************************/
+//! EOF
+/**************************************/
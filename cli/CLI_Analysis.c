@@ -0,0 +1,240 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+# include <direct.h>
+# include <process.h>
+# define getpid _getpid
+# define mkdir(Path, Mode) _mkdir(Path)
+#else
+# include <unistd.h>
+#endif
+/**************************************/
+#include "CLI.h"
+#include "Hash.h"
+/**************************************/
+
+//! Cache file layout:
+//!  AnalysisHeader_t Header;
+//!  char  _Padding[ANALYSIS_DATA_OFFSET - sizeof(Header)];
+//!  float Spectra[nBlocks][SPECTRICE_SPECTRA_SIZE(nChan, BlockSize, nHops)];
+//! Spectra[k] is the analysis of the input stream block starting at sample
+//! point GridOffset + k*BlockSize (with loops unrolled), with silence before
+//! the start of the file. Data starts on a page boundary so it can be mapped
+//! as-is.
+#define ANALYSIS_MAGIC       "SPXA"
+#define ANALYSIS_VERSION     3
+#define ANALYSIS_DATA_OFFSET 4096
+
+struct AnalysisHeader_t {
+	char     Magic[4];
+	uint32_t Version;
+	uint32_t BlockSize;
+	uint32_t nHops;
+	uint32_t WindowType;
+	uint32_t nChan;
+	uint32_t nSamplePoints;
+	uint32_t LoopProcess;
+	uint32_t LoopEnd;
+	uint32_t LoopLen;
+	uint32_t nBlocks;
+	uint32_t GridOffset;
+	uint64_t FileSize;
+	int64_t  FileTime;
+};
+
+/**************************************/
+
+int CLI_InitAnalysisState(struct Spectrice_t *State, int nChan, int BlockSize, int nHops, int WindowType) {
+	State->nChan        = nChan;
+	State->BlockSize    = BlockSize;
+	State->nHops        = nHops;
+	State->FreezeStart  = 0;
+	State->FreezePoint  = 0;
+	State->FreezeFactor = 0.0f;
+	State->FreezeAmp    = 0;
+	State->FreezePhase  = 0;
+	State->FastMath     = 0;
+	State->SilenceThreshold = 0.0f;
+	State->FreezeBinLo  = 0;
+	State->FreezeBinHi  = BlockSize/2;
+	return Spectrice_Init(State, WindowType, NULL, NULL);
+}
+
+/**************************************/
+
+//! Check that a mapped cache file matches what we expect
+static int CheckCache(const struct MapFile_t *Map, const struct AnalysisHeader_t *Expected) {
+	const struct AnalysisHeader_t *Header = (const struct AnalysisHeader_t*)Map->Data;
+	size_t BlockFloats = SPECTRICE_SPECTRA_SIZE(Expected->nChan, Expected->BlockSize, Expected->nHops);
+	if(Map->Size < ANALYSIS_DATA_OFFSET) return 0;
+	if(memcmp(Header, Expected, sizeof(struct AnalysisHeader_t)) != 0) return 0;
+	return Map->Size == ANALYSIS_DATA_OFFSET + sizeof(float) * BlockFloats * Expected->nBlocks;
+}
+
+//! Analyze the whole input stream and write it to a new cache file
+static int BuildCache(
+	const char *Filename,
+	const struct AnalysisHeader_t *Header,
+	struct CLI_InputStream_t *Stream,
+	int Quiet
+) {
+	int ExitCode = 1;
+	int nChan       = Header->nChan;
+	int BlockSize   = Header->BlockSize;
+	int BlockFloats = SPECTRICE_SPECTRA_SIZE(nChan, BlockSize, Header->nHops);
+
+	//! Set up an analysis-only state
+	struct Spectrice_t State;
+	if(!CLI_InitAnalysisState(&State, nChan, BlockSize, Header->nHops, Header->WindowType)) {
+		printf("ERROR: Unable to initialize analysis.\n");
+		return 0;
+	}
+	float *ReadBuffer = malloc(sizeof(float) * (BlockSize*nChan + BlockFloats));
+	float *Spectra    = ReadBuffer + BlockSize*nChan;
+	FILE  *File       = fopen(Filename, "wb");
+	if(!ReadBuffer || !File) {
+		printf("WARNING: Unable to create analysis cache file (%s).\n", Filename);
+		ExitCode = 0; goto Exit;
+	}
+
+	//! Write header, then spectra for every block
+	{
+		char Padding[ANALYSIS_DATA_OFFSET] = {0};
+		memcpy(Padding, Header, sizeof(struct AnalysisHeader_t));
+		if(fwrite(Padding, ANALYSIS_DATA_OFFSET, 1, File) != 1) ExitCode = 0;
+	}
+
+	//! Run the samples before the start of the grid through the analysis
+	//! so that the first block sees them as its history
+	int GridOffset = Header->GridOffset;
+	if(GridOffset) {
+		int n, nPad = (BlockSize - GridOffset) * nChan;
+		for(n=0;n<nPad;n++) ReadBuffer[n] = 0.0f;
+		CLI_ReadStream(Stream, ReadBuffer + nPad, GridOffset, GridOffset);
+		Spectrice_Analyze(&State, Spectra, ReadBuffer);
+	}
+	uint32_t Block, nBlocks = Header->nBlocks;
+	int nSmpEnd = Header->nSamplePoints - GridOffset + BlockSize;
+	for(Block=0;Block<nBlocks && ExitCode;Block++) {
+		if(!Quiet) printf("\rAnalyzing block %u/%u (%.2f%%)", Block+1, nBlocks, Block*100.0f/nBlocks);
+		int nSmp = nSmpEnd - Block*BlockSize;
+		if(nSmp > BlockSize) nSmp = BlockSize;
+		CLI_ReadStream(Stream, ReadBuffer, nSmp, BlockSize);
+		Spectrice_Analyze(&State, Spectra, ReadBuffer);
+		if(fwrite(Spectra, sizeof(float) * BlockFloats, 1, File) != 1) ExitCode = 0;
+	}
+	if(!Quiet) printf("\n");
+	if(fclose(File) != 0) ExitCode = 0;
+	File = NULL;
+	if(!ExitCode) {
+		printf("WARNING: Unable to write analysis cache file (%s).\n", Filename);
+		remove(Filename);
+	}
+
+Exit:
+	if(File) fclose(File);
+	free(ReadBuffer);
+	Spectrice_Destroy(&State);
+	return ExitCode;
+}
+
+/**************************************/
+
+int CLI_AnalysisCache_Open(
+	struct CLI_AnalysisCache_t *Cache,
+	const char *CacheDir,
+	const char *InFilename,
+	const struct CLI_InputStream_t *Stream,
+	int BlockSize,
+	int nHops,
+	int WindowType,
+	int GridOffset,
+	int Quiet
+) {
+	struct WAV_State_t *File = Stream->File;
+	Cache->Map.Data = NULL;
+
+	//! Fill out the header we expect to find
+	struct AnalysisHeader_t Header;
+	memset(&Header, 0, sizeof(Header));
+	{
+		struct stat st;
+		if(stat(InFilename, &st) != 0) return 0;
+		memcpy(Header.Magic, ANALYSIS_MAGIC, 4);
+		Header.Version       = ANALYSIS_VERSION;
+		Header.BlockSize     = BlockSize;
+		Header.nHops         = nHops;
+		Header.WindowType    = WindowType;
+		Header.nChan         = File->fmt->nChannels;
+		Header.nSamplePoints = File->nSamplePoints;
+		Header.LoopProcess   = Stream->LoopProcess;
+		Header.LoopEnd       = Stream->LoopProcess ? Stream->nLoopSamplesRem : 0;
+		Header.LoopLen       = Stream->LoopProcess ? Stream->LoopLen : 0;
+		Header.nBlocks       = (File->nSamplePoints - GridOffset + BlockSize-1) / BlockSize + 1;
+		Header.GridOffset    = GridOffset;
+		Header.FileSize      = (uint64_t)st.st_size;
+		Header.FileTime      = (int64_t)st.st_mtime;
+	}
+
+	//! Cache files are named after the input filename and the analysis
+	//! parameters; the header catches everything else (including stale
+	//! entries for modified files, which are just rebuilt).
+	char Filename[4096];
+	{
+		uint64_t Hash = HASH_FNV1A64_INIT;
+		Hash = Hash_FNV1a64(Hash, InFilename, strlen(InFilename));
+		Hash = Hash_FNV1a64(Hash, &Header.BlockSize,  sizeof(Header.BlockSize));
+		Hash = Hash_FNV1a64(Hash, &Header.nHops,      sizeof(Header.nHops));
+		Hash = Hash_FNV1a64(Hash, &Header.WindowType, sizeof(Header.WindowType));
+		Hash = Hash_FNV1a64(Hash, &Header.GridOffset, sizeof(Header.GridOffset));
+		snprintf(Filename, sizeof(Filename), "%s/%016llx.stft", CacheDir, (unsigned long long)Hash);
+	}
+
+	//! Try to use an existing cache file, and build one if that fails.
+	//! NOTE: We build into a temporary file and rename it into place, so
+	//! that concurrent processes never see a partial file.
+	if(!MapFile_Open(&Cache->Map, Filename) || !CheckCache(&Cache->Map, &Header)) {
+		MapFile_Close(&Cache->Map);
+		mkdir(CacheDir, 0777); //! Ignore errors; fopen() will complain
+		char TempFilename[4096 + 64];
+		snprintf(TempFilename, sizeof(TempFilename), "%s.%d.%p.tmp", Filename, (int)getpid(), (void*)Cache);
+
+		struct CLI_InputStream_t TempStream = *Stream;
+		uint32_t OldPos = File->SamplePosition;
+		File->SamplePosition = 0;
+		int Ok = BuildCache(TempFilename, &Header, &TempStream, Quiet);
+		File->SamplePosition = OldPos;
+		if(!Ok) return 0;
+		if(!MapFile_Rename(TempFilename, Filename)) {
+			printf("WARNING: Unable to create analysis cache file (%s).\n", Filename);
+			remove(TempFilename);
+			return 0;
+		}
+		if(!MapFile_Open(&Cache->Map, Filename) || !CheckCache(&Cache->Map, &Header)) {
+			MapFile_Close(&Cache->Map);
+			printf("WARNING: Unable to read analysis cache file (%s).\n", Filename);
+			return 0;
+		}
+	} else if(!Quiet) printf("Using cached analysis (%s).\n", Filename);
+
+	Cache->Spectra     = (const float*)((const char*)Cache->Map.Data + ANALYSIS_DATA_OFFSET);
+	Cache->BlockFloats = SPECTRICE_SPECTRA_SIZE(Header.nChan, BlockSize, nHops);
+	Cache->nBlocks     = Header.nBlocks;
+	return 1;
+}
+
+void CLI_AnalysisCache_Close(struct CLI_AnalysisCache_t *Cache) {
+	MapFile_Close(&Cache->Map);
+}
+
+/**************************************/
+//! EOF
+/**************************************/
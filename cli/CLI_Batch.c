@@ -0,0 +1,277 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+/**************************************/
+#include "CLI.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+/**************************************/
+#define MAX_LINE_LENGTH  4096
+#define MAX_LINE_TOKENS  64
+/**************************************/
+
+//! Batch job
+struct BatchJob_t {
+	char    *Line;        //! Manifest line (owned); filenames and options point into it
+	const char *InFilename;
+	const char *OutFilename;
+	long long FileSize;
+	int      ExitCode;
+	double   Time;
+	struct CLI_Options_t     Opt;
+	struct CLI_RenderStats_t Stats;
+};
+
+//! Batch state (shared by all tasks)
+struct Batch_t {
+	struct BatchJob_t   *Jobs;
+	struct CLI_Worker_t *Workers;
+	pthread_mutex_t      PrintLock;
+	int nJobs;
+	int nJobsDone;
+};
+
+//! Task argument
+struct BatchTask_t {
+	struct Batch_t    *Batch;
+	struct BatchJob_t *Job;
+};
+
+/**************************************/
+
+static double GetTime(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1.0e-9;
+}
+
+/**************************************/
+
+//! Read the manifest into a list of jobs
+static int ReadManifest(const char *Filename, const struct CLI_Options_t *Opt, struct BatchJob_t **JobsOut) {
+	FILE *File = fopen(Filename, "r");
+	if(!File) {
+		printf("ERROR: Unable to open manifest (%s).\n", Filename);
+		return -1;
+	}
+
+	int nJobs = 0, Capacity = 0, LineIdx = 0;
+	struct BatchJob_t *Jobs = NULL;
+	char  Line[MAX_LINE_LENGTH];
+	char *Tokens[MAX_LINE_TOKENS];
+	while(fgets(Line, sizeof(Line), File)) {
+		LineIdx++;
+		int n, nTokens = CLI_TokenizeLine(Line, Tokens, MAX_LINE_TOKENS);
+		if(nTokens == 0) continue;
+		if(nTokens < 2) {
+			printf("ERROR: Manifest line %d: Expected input and output filenames.\n", LineIdx);
+			goto Error;
+		}
+
+		//! Grow job list as needed
+		if(nJobs == Capacity) {
+			int NewCapacity = Capacity ? (Capacity*2) : 256;
+			struct BatchJob_t *NewJobs = realloc(Jobs, NewCapacity * sizeof(struct BatchJob_t));
+			if(!NewJobs) {
+				printf("ERROR: Out of memory reading manifest.\n");
+				goto Error;
+			}
+			Jobs     = NewJobs;
+			Capacity = NewCapacity;
+		}
+
+		//! Fill out job, applying per-file options on top of the globals
+		//! NOTE: The job keeps a copy of the tokenized line, as the filenames
+		//! and any string options point into it. A global checkpoint,
+		//! telemetry or dump file would be shared by every job, so only
+		//! per-file ones are used.
+		struct BatchJob_t *Job = &Jobs[nJobs];
+		size_t LineSize = Tokens[nTokens-1] + strlen(Tokens[nTokens-1]) + 1 - Line;
+		Job->Line = malloc(LineSize);
+		if(!Job->Line) {
+			printf("ERROR: Out of memory reading manifest.\n");
+			goto Error;
+		}
+		memcpy(Job->Line, Line, LineSize);
+		for(n=0;n<nTokens;n++) Tokens[n] = Job->Line + (Tokens[n] - Line);
+		nJobs++;
+		Job->Opt = *Opt;
+		Job->Opt.CheckpointFile = NULL;
+		Job->Opt.TelemetryFile  = NULL;
+		Job->Opt.DumpFile       = NULL;
+		for(n=2;n<nTokens;n++) {
+			if(!CLI_ParseOption(&Job->Opt, Tokens[n])) {
+				printf("ERROR: Manifest line %d: Invalid options.\n", LineIdx);
+				goto Error;
+			}
+		}
+		Job->Opt.Quiet    = 1;
+		Job->Opt.nThreads = 1; //! Parallelism comes from the batch pool
+		Job->InFilename  = Tokens[0];
+		Job->OutFilename = Tokens[1];
+		Job->ExitCode    = -1;
+		Job->Time        = 0.0;
+		memset(&Job->Stats, 0, sizeof(Job->Stats));
+		{
+			struct stat st;
+			Job->FileSize = (stat(Job->InFilename, &st) == 0) ? (long long)st.st_size : 0;
+		}
+	}
+	fclose(File);
+	*JobsOut = Jobs;
+	return nJobs;
+
+Error:
+	while(nJobs) free(Jobs[--nJobs].Line);
+	free(Jobs);
+	fclose(File);
+	return -1;
+}
+
+/**************************************/
+
+//! Sort jobs largest-first, so that the big files don't end up as stragglers
+static int CompareJobs(const void *a, const void *b) {
+	const struct BatchJob_t *JobA = (const struct BatchJob_t*)a;
+	const struct BatchJob_t *JobB = (const struct BatchJob_t*)b;
+	if(JobA->FileSize > JobB->FileSize) return -1;
+	if(JobA->FileSize < JobB->FileSize) return +1;
+	return 0;
+}
+
+/**************************************/
+
+static void BatchTask(void *User, int WorkerIdx) {
+	struct BatchTask_t *Task  = (struct BatchTask_t*)User;
+	struct Batch_t     *Batch = Task->Batch;
+	struct BatchJob_t  *Job   = Task->Job;
+
+	//! Render using this worker's context
+	if(Trace_Enabled) Trace_SetThreadName("Worker %d", WorkerIdx);
+	uint64_t TraceTime = Trace_Begin();
+	double t0 = GetTime();
+	Job->ExitCode = CLI_RenderFile(&Batch->Workers[WorkerIdx], Job->InFilename, Job->OutFilename, &Job->Opt, &Job->Stats);
+	Job->Time = GetTime() - t0;
+	Trace_End("Render", TraceTime, "job", (int)(Job - Batch->Jobs));
+
+	//! Report progress
+	pthread_mutex_lock(&Batch->PrintLock);
+	Batch->nJobsDone++;
+	printf(
+		"[%d/%d] %s -> %s: %s (%.2fs)\n",
+		Batch->nJobsDone, Batch->nJobs, Job->InFilename, Job->OutFilename,
+		Job->ExitCode ? "FAILED" : Job->Stats.CacheHit ? "Ok (cached)" : "Ok", Job->Time
+	);
+	pthread_mutex_unlock(&Batch->PrintLock);
+}
+
+/**************************************/
+
+int CLI_RunBatch(const char *ManifestFilename, const struct CLI_Options_t *Opt, struct CLI_RunStats_t *Run) {
+	int n;
+	int ExitCode = 0;
+
+	//! Read manifest
+	struct Batch_t Batch;
+	if(Opt->CheckpointFile) printf("WARNING: -checkpoint is ignored in batch mode, except as a per-file option.\n");
+	if(Opt->TelemetryFile)  printf("WARNING: -telemetry is ignored in batch mode, except as a per-file option.\n");
+	if(Opt->DumpFile)       printf("WARNING: -dumpspectra is ignored in batch mode, except as a per-file option.\n");
+	Batch.nJobs = ReadManifest(ManifestFilename, Opt, &Batch.Jobs);
+	if(Batch.nJobs < 0) return -1;
+	if(Batch.nJobs == 0) {
+		printf("WARNING: Manifest is empty.\n");
+		free(Batch.Jobs);
+		return 0;
+	}
+	Batch.nJobsDone = 0;
+	qsort(Batch.Jobs, Batch.nJobs, sizeof(struct BatchJob_t), CompareJobs);
+
+	//! Create the pool and per-worker contexts
+	struct ThreadPool_t Pool;
+	int nThreads = Opt->nThreads ? Opt->nThreads : ThreadPool_GetCPUCount();
+	if(nThreads > Batch.nJobs) nThreads = Batch.nJobs;
+	struct BatchTask_t *Tasks = malloc(Batch.nJobs * sizeof(struct BatchTask_t));
+	Batch.Workers = malloc(nThreads * sizeof(struct CLI_Worker_t));
+	if(!Tasks || !Batch.Workers) {
+		printf("ERROR: Couldn't allocate batch state.\n");
+		ExitCode = -1; goto Exit_FailAlloc;
+	}
+	for(n=0;n<nThreads;n++) CLI_WorkerInit(&Batch.Workers[n]);
+	pthread_mutex_init(&Batch.PrintLock, NULL);
+	if(!ThreadPool_Create(&Pool, nThreads)) {
+		printf("ERROR: Unable to create thread pool.\n");
+		ExitCode = -1; goto Exit_FailCreatePool;
+	}
+
+	//! Run all jobs
+	printf("Processing %d files on %d threads...\n", Batch.nJobs, nThreads);
+	double t0 = GetTime();
+	for(n=0;n<Batch.nJobs;n++) {
+		Tasks[n].Batch = &Batch;
+		Tasks[n].Job   = &Batch.Jobs[n];
+		if(!ThreadPool_Submit(&Pool, BatchTask, &Tasks[n])) {
+			//! Couldn't queue the task, so run it here instead
+			//! NOTE: Worker 0's state is only free once the pool is idle
+			ThreadPool_Wait(&Pool);
+			BatchTask(&Tasks[n], 0);
+		}
+	}
+	ThreadPool_Wait(&Pool);
+	double WallTime = GetTime() - t0;
+	ThreadPool_Destroy(&Pool);
+
+	//! Print summary
+	{
+		int    nFailed = 0, nCacheHits = 0;
+		double nSamplePoints = 0.0, nSamples = 0.0, AudioTime = 0.0, CPUTime = 0.0;
+		for(n=0;n<Batch.nJobs;n++) {
+			const struct BatchJob_t *Job = &Batch.Jobs[n];
+			if(Run) CLI_RunStats_Add(Run, &Job->Stats, Job->ExitCode);
+			CPUTime += Job->Time;
+			if(Job->ExitCode) {
+				nFailed++;
+				continue;
+			}
+			nCacheHits    += Job->Stats.CacheHit;
+			nSamplePoints += Job->Stats.nOutputSamplePoints;
+			nSamples      += (double)Job->Stats.nOutputSamplePoints * Job->Stats.nChan;
+			AudioTime     += (double)Job->Stats.nOutputSamplePoints / Job->Stats.SampleRate;
+		}
+		printf(
+			"Batch summary:\n"
+			" Files:       %d processed (%d from result cache), %d failed\n"
+			" Audio:       %.0f sample points (%.0f samples, %.2fs)\n"
+			" Wall time:   %.2fs (%.2fs of worker time, %.2fx parallel)\n"
+			" Throughput:  %.0f samples/s (%.2fx realtime)\n",
+			Batch.nJobs - nFailed, nCacheHits, nFailed,
+			nSamplePoints, nSamples, AudioTime,
+			WallTime, CPUTime, (WallTime > 0.0) ? (CPUTime / WallTime) : 0.0,
+			(WallTime > 0.0) ? (nSamples / WallTime) : 0.0,
+			(WallTime > 0.0) ? (AudioTime / WallTime) : 0.0
+		);
+		if(nFailed) ExitCode = -1;
+	}
+
+	//! Exit points
+Exit_FailCreatePool:
+	pthread_mutex_destroy(&Batch.PrintLock);
+	for(n=0;n<nThreads;n++) CLI_WorkerDestroy(&Batch.Workers[n]);
+Exit_FailAlloc:
+	free(Batch.Workers);
+	free(Tasks);
+	for(n=0;n<Batch.nJobs;n++) free(Batch.Jobs[n].Line);
+	free(Batch.Jobs);
+	return ExitCode;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
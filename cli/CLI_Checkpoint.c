@@ -0,0 +1,169 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+/**************************************/
+#include "CLI.h"
+#include "Hash.h"
+/**************************************/
+
+//! Checkpoint file layout:
+//!  CheckpointHeader_t Header;
+//!  char  _Padding[CHECKPOINT_DATA_OFFSET - sizeof(Header)];
+//!  float History[Header.nHistory];
+//!  char  _Padding[];                   //! Up to Header.StateOffset
+//!  char  State[Header.StateSize];      //! From Spectrice_SaveState()
+//! The state starts on a page boundary so it can be used straight from
+//! the mapped file.
+#define CHECKPOINT_MAGIC       "SPXK"
+#define CHECKPOINT_VERSION     1
+#define CHECKPOINT_DATA_OFFSET 4096
+
+struct CheckpointHeader_t {
+	char     Magic[4];
+	uint32_t Version;
+	uint64_t Key;
+	int32_t  ProcStart;
+	int32_t  Block;
+	int32_t  nSamplesRem;
+	uint32_t nOutputSmpTotal;
+	uint32_t InputPosition;
+	int32_t  nLoopSamplesRem;
+	uint32_t nHistory;
+	uint32_t StateOffset;
+	uint64_t StateSize;
+};
+
+/**************************************/
+
+uint64_t CLI_Checkpoint_GetKey(const char *InFilename, const char *OutFilename, const struct CLI_Options_t *Opt) {
+	//! The input file is identified by name, size and modification time
+	//! (as with the analysis cache); hashing the whole file would take too
+	//! long for the files that need checkpointing in the first place.
+	uint64_t Hash = HASH_FNV1A64_INIT;
+	int Version = SPECTRICE_VERSION;
+	Hash = Hash_FNV1a64(Hash, &Version, sizeof(Version));
+	Hash = CLI_HashOptions(Hash, Opt);
+	Hash = Hash_FNV1a64(Hash, InFilename,  strlen(InFilename)  + 1);
+	Hash = Hash_FNV1a64(Hash, OutFilename, strlen(OutFilename) + 1);
+	{
+		struct stat st;
+		if(stat(InFilename, &st) == 0) {
+			int64_t FileSize = (int64_t)st.st_size;
+			int64_t FileTime = (int64_t)st.st_mtime;
+			Hash = Hash_FNV1a64(Hash, &FileSize, sizeof(FileSize));
+			Hash = Hash_FNV1a64(Hash, &FileTime, sizeof(FileTime));
+		}
+	}
+	return Hash;
+}
+
+/**************************************/
+
+int CLI_Checkpoint_Save(
+	const char *Filename,
+	const struct CLI_Checkpoint_t *Ckpt,
+	const float *History,
+	const struct Spectrice_t *State
+) {
+	int Ok = 1;
+	char TempFilename[4096 + 16];
+	snprintf(TempFilename, sizeof(TempFilename), "%s.tmp", Filename);
+
+	//! Fill out header
+	struct CheckpointHeader_t Header;
+	memset(&Header, 0, sizeof(Header));
+	memcpy(Header.Magic, CHECKPOINT_MAGIC, 4);
+	Header.Version         = CHECKPOINT_VERSION;
+	Header.Key             = Ckpt->Key;
+	Header.ProcStart       = Ckpt->ProcStart;
+	Header.Block           = Ckpt->Block;
+	Header.nSamplesRem     = Ckpt->nSamplesRem;
+	Header.nOutputSmpTotal = Ckpt->nOutputSmpTotal;
+	Header.InputPosition   = Ckpt->InputPosition;
+	Header.nLoopSamplesRem = Ckpt->nLoopSamplesRem;
+	Header.nHistory        = Ckpt->nHistory;
+	Header.StateSize       = Spectrice_GetStateSize(State);
+	size_t HistoryEnd = CHECKPOINT_DATA_OFFSET + sizeof(float) * Header.nHistory;
+	Header.StateOffset = (HistoryEnd + CHECKPOINT_DATA_OFFSET-1) & ~(size_t)(CHECKPOINT_DATA_OFFSET-1);
+
+	//! Write everything to a temporary file, then rename it into place, so
+	//! that being killed half-way through leaves the last checkpoint intact
+	char *Padding   = calloc(1, CHECKPOINT_DATA_OFFSET);
+	void *StateData = malloc(Header.StateSize);
+	FILE *File      = fopen(TempFilename, "wb");
+	if(!Padding || !StateData || !File) {
+		Ok = 0; goto Exit;
+	}
+	Spectrice_SaveState(State, StateData);
+	if(fwrite(&Header, sizeof(Header), 1, File) != 1) Ok = 0;
+	if(fwrite(Padding, CHECKPOINT_DATA_OFFSET - sizeof(Header), 1, File) != 1) Ok = 0;
+	if(fwrite(History, sizeof(float), Header.nHistory, File) != Header.nHistory) Ok = 0;
+	if(Header.StateOffset > HistoryEnd && fwrite(Padding, Header.StateOffset - HistoryEnd, 1, File) != 1) Ok = 0;
+	if(fwrite(StateData, Header.StateSize, 1, File) != 1) Ok = 0;
+	if(fclose(File) != 0) Ok = 0;
+	File = NULL;
+	if(Ok) Ok = MapFile_Rename(TempFilename, Filename);
+
+Exit:
+	if(File) fclose(File);
+	if(!Ok) {
+		printf("\nWARNING: Unable to write checkpoint (%s).\n", Filename);
+		remove(TempFilename);
+	}
+	free(StateData);
+	free(Padding);
+	return Ok;
+}
+
+/**************************************/
+
+int CLI_Checkpoint_Load(struct CLI_Checkpoint_t *Ckpt, const char *Filename, uint64_t Key, int nHistory) {
+	struct MapFile_t *Map = &Ckpt->Map;
+	if(!MapFile_Open(Map, Filename)) return 0;
+
+	//! Check that this checkpoint belongs to the same job
+	const struct CheckpointHeader_t *Header = (const struct CheckpointHeader_t*)Map->Data;
+	int Valid = (
+		Map->Size >= CHECKPOINT_DATA_OFFSET &&
+		!memcmp(Header->Magic, CHECKPOINT_MAGIC, 4) &&
+		Header->Version  == CHECKPOINT_VERSION &&
+		Header->Key      == Key &&
+		Header->nHistory == (uint32_t)nHistory &&
+		Header->StateOffset >= CHECKPOINT_DATA_OFFSET + sizeof(float) * (size_t)nHistory &&
+		Header->StateOffset <= Map->Size &&
+		Header->StateSize   == Map->Size - Header->StateOffset
+	);
+	if(!Valid) {
+		printf("WARNING: Checkpoint doesn't match this job; starting from the beginning (%s).\n", Filename);
+		MapFile_Close(Map);
+		return 0;
+	}
+
+	Ckpt->Key             = Header->Key;
+	Ckpt->ProcStart       = Header->ProcStart;
+	Ckpt->Block           = Header->Block;
+	Ckpt->nSamplesRem     = Header->nSamplesRem;
+	Ckpt->nOutputSmpTotal = Header->nOutputSmpTotal;
+	Ckpt->InputPosition   = Header->InputPosition;
+	Ckpt->nLoopSamplesRem = Header->nLoopSamplesRem;
+	Ckpt->nHistory        = Header->nHistory;
+	Ckpt->History   = (const float*)((const char*)Map->Data + CHECKPOINT_DATA_OFFSET);
+	Ckpt->StateData = (const char*)Map->Data + Header->StateOffset;
+	Ckpt->StateSize = Header->StateSize;
+	return 1;
+}
+
+void CLI_Checkpoint_Close(struct CLI_Checkpoint_t *Ckpt) {
+	MapFile_Close(&Ckpt->Map);
+}
+
+/**************************************/
+//! EOF
+/**************************************/
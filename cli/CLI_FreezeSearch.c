@@ -0,0 +1,349 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__AVX__)
+# include <immintrin.h>
+#elif defined(__SSE__)
+# include <xmmintrin.h>
+#endif
+/**************************************/
+#include "CLI.h"
+#include "ThreadPool.h"
+/**************************************/
+
+//! Each frame is reduced to a feature vector of at most this many bands
+//! (pooled magnitudes, normalized to unit length), so that distances are
+//! cheap and independent of level. Must be a multiple of 8.
+#define MAX_FEATURE_BANDS 256
+
+//! Frames read and transformed per pass (bounds memory use)
+#define FRAMES_PER_PASS   256
+#define FRAMES_PER_TASK   16
+
+//! Frames quieter than this (relative to the loudest frame) are never
+//! proposed, as silence is perfectly stationary but useless to freeze
+#define MIN_RELATIVE_ENERGY 1.0e-3f
+
+//! Neighbourhood (each side of a frame) over which stationarity is judged,
+//! in seconds and frames
+#define NEIGHBOURHOOD_SECONDS 0.25f
+#define MIN_NEIGHBOURHOOD     2
+#define MAX_NEIGHBOURHOOD     32
+
+//! Alignment of scratch buffers (matches the library)
+#define SCRATCH_ALIGNMENT 64
+
+//! Number of candidates shown by CLI_RunFindFreeze()
+#define FIND_FREEZE_CANDIDATES 5
+
+/**************************************/
+
+//! Squared Euclidean distance between two feature vectors
+static float FeatureDist2(const float *a, const float *b, int N) {
+	int n;
+#if defined(__AVX__)
+	__m256 Sum = _mm256_setzero_ps();
+	for(n=0;n<N;n+=8) {
+		__m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + n), _mm256_loadu_ps(b + n));
+		Sum = _mm256_add_ps(Sum, _mm256_mul_ps(d, d));
+	}
+	__m128 s = _mm_add_ps(_mm256_castps256_ps128(Sum), _mm256_extractf128_ps(Sum, 1));
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	return _mm_cvtss_f32(s);
+#elif defined(__SSE__)
+	__m128 Sum = _mm_setzero_ps();
+	for(n=0;n<N;n+=4) {
+		__m128 d = _mm_sub_ps(_mm_loadu_ps(a + n), _mm_loadu_ps(b + n));
+		Sum = _mm_add_ps(Sum, _mm_mul_ps(d, d));
+	}
+	Sum = _mm_add_ps(Sum, _mm_movehl_ps(Sum, Sum));
+	Sum = _mm_add_ss(Sum, _mm_shuffle_ps(Sum, Sum, 1));
+	return _mm_cvtss_f32(Sum);
+#else
+	float Sum = 0.0f;
+	for(n=0;n<N;n++) Sum += (a[n] - b[n]) * (a[n] - b[n]);
+	return Sum;
+#endif
+}
+
+/**************************************/
+
+//! Search state shared by all tasks
+struct FreezeSearch_t {
+	const struct Spectrice_t *State;
+	int    nBands;      //! Band k covers bins k*nBins/nBands until the next band
+	int    Hop;
+	int    nFrames;
+	int    Neighbourhood;
+	float *Features;    //! Features[nFrames][nBands]
+	float *Energy;      //! Energy[nFrames]
+	float *Scores;      //! Scores[nFrames]
+	float **Power;      //! Per-worker Power[nChan][BlockSize/2]
+	float **Scratch;    //! Per-worker scratch buffers
+};
+
+//! Feature extraction task
+struct FeatureTask_t {
+	struct FreezeSearch_t *Search;
+	const float *Input; //! First frame of this task
+	int FrameBeg, FrameEnd;
+};
+
+static void FeatureTask(void *User, int WorkerIdx) {
+	struct FeatureTask_t *Task = (struct FeatureTask_t*)User;
+	struct FreezeSearch_t *Search = Task->Search;
+	const struct Spectrice_t *State = Search->State;
+	int n, Band, Chan, Frame;
+	int nChan  = State->nChan;
+	int nBins  = State->BlockSize/2;
+	int nBands = Search->nBands;
+	float *Power = Search->Power[WorkerIdx];
+	for(Frame=Task->FrameBeg;Frame<Task->FrameEnd;Frame++) {
+		memset(Power, 0, sizeof(float) * nBins * nChan);
+		Spectrice_AccumulateSnapshotPower(State, Power, Task->Input + (Frame-Task->FrameBeg)*Search->Hop*nChan, Search->Scratch[WorkerIdx]);
+
+		//! Pool into bands (summing channels), then normalize
+		float *Feature = Search->Features + (size_t)Frame*nBands;
+		float Energy = 0.0f;
+		//! NOTE: Mixed-radix block sizes don't divide evenly into bands, so
+		//! the band edges are rounded to make sure every bin is covered.
+		for(Band=0;Band<nBands;Band++) {
+			float Sum = 0.0f;
+			int BinBeg = Band*nBins / nBands;
+			int BinEnd = (Band+1)*nBins / nBands;
+			for(Chan=0;Chan<nChan;Chan++) {
+				const float *Src = Power + Chan*nBins;
+				for(n=BinBeg;n<BinEnd;n++) Sum += Src[n];
+			}
+			Feature[Band] = sqrtf(Sum);
+			Energy += Sum;
+		}
+		if(Energy > 0.0f) {
+			float Scale = 1.0f / sqrtf(Energy);
+			for(Band=0;Band<nBands;Band++) Feature[Band] *= Scale;
+		}
+		Search->Energy[Frame] = Energy;
+	}
+}
+
+//! Scoring task
+//! The score is the mean spectral flux around a frame (how much the
+//! spectrum moves about), plus the mean distance from the frame to its
+//! neighbours (how well the frozen spectrum stands in for them). Lower
+//! scores are more stationary, and so freeze and loop more cleanly.
+struct ScoreTask_t {
+	struct FreezeSearch_t *Search;
+	int FrameBeg, FrameEnd;
+};
+
+static void ScoreTask(void *User, int WorkerIdx) {
+	struct ScoreTask_t *Task = (struct ScoreTask_t*)User;
+	struct FreezeSearch_t *Search = Task->Search;
+	int j, Frame;
+	int nBands = Search->nBands;
+	int W      = Search->Neighbourhood;
+	(void)WorkerIdx;
+	for(Frame=Task->FrameBeg;Frame<Task->FrameEnd;Frame++) {
+		const float *Feature = Search->Features + (size_t)Frame*nBands;
+		float Flux = 0.0f, Dist = 0.0f;
+		for(j=Frame-W;j<Frame+W;j++) {
+			const float *a = Search->Features + (size_t)j*nBands;
+			Flux += FeatureDist2(a, a + nBands, nBands);
+			Dist += FeatureDist2(Feature, (j < Frame) ? a : (a + nBands), nBands);
+		}
+		Search->Scores[Frame] = (Flux + Dist) / (2*W);
+	}
+}
+
+/**************************************/
+
+int CLI_FindFreezePoints(
+	struct WAV_State_t *File,
+	const struct CLI_Options_t *Opt,
+	int MinPoint,
+	int *Points,
+	float *Scores,
+	int nPoints
+) {
+	int n, Frame, Task;
+	int nFound    = -1;
+	int nChan     = File->fmt->nChannels;
+	int BlockSize = Opt->BlockSize;
+	int nBins     = BlockSize/2;
+	int nThreads  = Opt->nThreads ? Opt->nThreads : ThreadPool_GetCPUCount();
+	if(nThreads > FRAMES_PER_PASS / FRAMES_PER_TASK) nThreads = FRAMES_PER_PASS / FRAMES_PER_TASK;
+
+	struct FreezeSearch_t Search;
+	memset(&Search, 0, sizeof(Search));
+	Search.Hop       = BlockSize/2;
+	Search.nBands    = (nBins < MAX_FEATURE_BANDS) ? nBins : MAX_FEATURE_BANDS;
+	Search.nFrames   = ((int)File->nSamplePoints - BlockSize) / Search.Hop + 1;
+	{
+		int W = (int)(NEIGHBOURHOOD_SECONDS * File->fmt->nSamplesPerSec) / Search.Hop;
+		if(W < MIN_NEIGHBOURHOOD) W = MIN_NEIGHBOURHOOD;
+		if(W > MAX_NEIGHBOURHOOD) W = MAX_NEIGHBOURHOOD;
+		Search.Neighbourhood = W;
+	}
+
+	//! Set up a state just for the window and transform
+	struct Spectrice_t State;
+	if(!CLI_InitAnalysisState(&State, nChan, BlockSize, Opt->nHops, Opt->WindowType)) {
+		printf("ERROR: Unable to initialize analysis.\n");
+		return -1;
+	}
+	Search.State = &State;
+
+	int nPassSmp = (FRAMES_PER_PASS-1)*Search.Hop + BlockSize;
+	float *Input       = malloc(sizeof(float) * nPassSmp * nChan);
+	float *Features    = malloc(sizeof(float) * ((size_t)Search.nFrames*(Search.nBands + 2) + nBins*nChan*nThreads));
+	char  *ScratchData = malloc(SCRATCH_ALIGNMENT-1 + sizeof(float) * BlockSize*2 * nThreads);
+	float **Buffers    = malloc(sizeof(float*) * nThreads * 2);
+	struct FeatureTask_t *Tasks = malloc(sizeof(struct FeatureTask_t) * (FRAMES_PER_PASS / FRAMES_PER_TASK));
+	struct ScoreTask_t *ScoreTasks = NULL;
+	if(!Input || !Features || !ScratchData || !Buffers || !Tasks) {
+		printf("ERROR: Couldn't allocate freeze point search buffers.\n");
+		goto Exit;
+	}
+	Search.Features = Features;
+	Search.Energy   = Search.Features + (size_t)Search.nFrames*Search.nBands;
+	Search.Scores   = Search.Energy   + Search.nFrames;
+	Search.Power    = Buffers;
+	Search.Scratch  = Buffers + nThreads;
+	{
+		char *Buf = ScratchData + ((-(uintptr_t)ScratchData) & (SCRATCH_ALIGNMENT-1));
+		for(n=0;n<nThreads;n++) {
+			Search.Power  [n] = Search.Scores + Search.nFrames + n*nBins*nChan;
+			Search.Scratch[n] = (float*)Buf + n*BlockSize*2;
+		}
+	}
+
+	struct ThreadPool_t Pool;
+	int HavePool = (nThreads > 1) && ThreadPool_Create(&Pool, nThreads);
+
+	//! Get features for every frame, a pass at a time
+	uint32_t OldPos = File->SamplePosition;
+	for(Frame=0;Frame<Search.nFrames;Frame+=FRAMES_PER_PASS) {
+		int nPassFrames = Search.nFrames - Frame;
+		if(nPassFrames > FRAMES_PER_PASS) nPassFrames = FRAMES_PER_PASS;
+		File->SamplePosition = Frame*Search.Hop;
+		WAV_ReadAsFloat(File, Input, (nPassFrames-1)*Search.Hop + BlockSize);
+		for(Task=0;Task*FRAMES_PER_TASK<nPassFrames;Task++) {
+			struct FeatureTask_t *t = &Tasks[Task];
+			t->Search   = &Search;
+			t->FrameBeg = Frame + Task*FRAMES_PER_TASK;
+			t->FrameEnd = t->FrameBeg + FRAMES_PER_TASK;
+			t->Input    = Input + Task*FRAMES_PER_TASK*Search.Hop*nChan;
+			if(t->FrameEnd > Frame + nPassFrames) t->FrameEnd = Frame + nPassFrames;
+			if(!HavePool || !ThreadPool_Submit(&Pool, FeatureTask, t)) {
+				//! NOTE: Worker 0's buffers are only free once the pool is idle
+				if(HavePool) ThreadPool_Wait(&Pool);
+				FeatureTask(t, 0);
+			}
+		}
+		if(HavePool) ThreadPool_Wait(&Pool);
+	}
+	File->SamplePosition = OldPos;
+
+	//! Score every frame whose neighbourhood lies inside the file, and
+	//! whose centre is at or past MinPoint
+	float MaxEnergy = 0.0f;
+	for(Frame=0;Frame<Search.nFrames;Frame++) if(Search.Energy[Frame] > MaxEnergy) MaxEnergy = Search.Energy[Frame];
+	int ScoreBeg = (MinPoint - BlockSize/2 + Search.Hop-1) / Search.Hop;
+	int ScoreEnd = Search.nFrames - Search.Neighbourhood;
+	if(ScoreBeg < Search.Neighbourhood) ScoreBeg = Search.Neighbourhood;
+	if(ScoreBeg < ScoreEnd) {
+		int nScoreTasks = (ScoreEnd - ScoreBeg + FRAMES_PER_PASS-1) / FRAMES_PER_PASS;
+		ScoreTasks = malloc(sizeof(struct ScoreTask_t) * nScoreTasks);
+		if(!ScoreTasks) {
+			printf("ERROR: Couldn't allocate freeze point search buffers.\n");
+			if(HavePool) ThreadPool_Destroy(&Pool);
+			goto Exit;
+		}
+		for(Task=0;Task<nScoreTasks;Task++) {
+			struct ScoreTask_t *t = &ScoreTasks[Task];
+			t->Search   = &Search;
+			t->FrameBeg = ScoreBeg + Task*FRAMES_PER_PASS;
+			t->FrameEnd = t->FrameBeg + FRAMES_PER_PASS;
+			if(t->FrameEnd > ScoreEnd) t->FrameEnd = ScoreEnd;
+			if(!HavePool || !ThreadPool_Submit(&Pool, ScoreTask, t)) ScoreTask(t, 0);
+		}
+		if(HavePool) ThreadPool_Wait(&Pool);
+	}
+	if(HavePool) ThreadPool_Destroy(&Pool);
+
+	//! Pick the best candidates, keeping them at least a neighbourhood apart
+	//! NOTE: Picked and unusable frames are marked by a negative score.
+	for(Frame=0;Frame<Search.nFrames;Frame++) {
+		if(Frame < ScoreBeg || Frame >= ScoreEnd || Search.Energy[Frame] < MaxEnergy*MIN_RELATIVE_ENERGY) {
+			Search.Scores[Frame] = -1.0f;
+		}
+	}
+	for(nFound=0;nFound<nPoints;nFound++) {
+		int Best = -1;
+		for(Frame=ScoreBeg;Frame<ScoreEnd;Frame++) {
+			if(Search.Scores[Frame] >= 0.0f && (Best < 0 || Search.Scores[Frame] < Search.Scores[Best])) Best = Frame;
+		}
+		if(Best < 0) break;
+		Points[nFound] = Best*Search.Hop + BlockSize/2;
+		if(Scores) Scores[nFound] = Search.Scores[Best];
+		for(Frame=Best-Search.Neighbourhood;Frame<=Best+Search.Neighbourhood;Frame++) {
+			if(Frame >= 0 && Frame < Search.nFrames) Search.Scores[Frame] = -1.0f;
+		}
+	}
+
+Exit:
+	free(ScoreTasks);
+	free(Tasks);
+	free(Buffers);
+	free(ScratchData);
+	free(Features);
+	free(Input);
+	Spectrice_Destroy(&State);
+	return nFound;
+}
+
+/**************************************/
+
+int CLI_RunFindFreeze(const char *InFilename, const struct CLI_Options_t *Opt) {
+	int n;
+	struct WAV_State_t File;
+	int Error = WAV_OpenR(&File, InFilename);
+	if(Error < 0) {
+		printf("ERROR: Unable to open input file (%s); error %s.\n", InFilename, WAV_ErrorCodeToString(Error));
+		return -1;
+	}
+	if((int)File.nSamplePoints < Opt->BlockSize) {
+		printf("ERROR: Input file has less sample points than BlockSize (%s).\n", InFilename);
+		WAV_Close(&File);
+		return -1;
+	}
+
+	int   Points[FIND_FREEZE_CANDIDATES];
+	float Scores[FIND_FREEZE_CANDIDATES];
+	int MinPoint = Opt->BlockSize + Opt->BlockSize/2 + Opt->FreezeXFade;
+	int nFound = CLI_FindFreezePoints(&File, Opt, MinPoint, Points, Scores, FIND_FREEZE_CANDIDATES);
+	if(nFound == 0) printf("No suitable freeze points found in %s.\n", InFilename);
+	else if(nFound > 0) {
+		printf("Freeze point candidates for %s (best first):\n", InFilename);
+		for(n=0;n<nFound;n++) {
+			printf(
+				" %2d: -freezepoint:%-10d (%.3fs, score %.4f)\n",
+				n+1, Points[n], Points[n] / (double)File.fmt->nSamplesPerSec, Scores[n]
+			);
+		}
+	}
+	WAV_Close(&File);
+	return (nFound > 0) ? 0 : -1;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
@@ -0,0 +1,356 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/**************************************/
+#include "CLI.h"
+#include "Fourier.h"
+#include "Hash.h"
+/**************************************/
+
+//! Read gain in linear form, or dB form
+static double ReadGain(const char *Str) {
+	double Gain;
+	int IsDecibel = 0;
+	int nArg = sscanf(Str, "%lf %*1[dD]%*1[bB]%n", &Gain, &IsDecibel);
+	if(nArg == 0) return NAN;
+	return IsDecibel ? pow(10.0, Gain/20.0) : Gain;
+}
+
+/**************************************/
+
+void CLI_DefaultOptions(struct CLI_Options_t *Opt) {
+	Opt->BlockSize    = 1024;
+	Opt->nHops        = 8;
+	Opt->FreezeAmp    = 1;
+	Opt->FreezePhase  = 0;
+	Opt->WindowType   = SPECTRICE_WINDOW_TYPE_NUTTALL;
+	Opt->FreezeXFade  = 0;
+	Opt->FreezePoint  = 0;
+	Opt->SnapshotPos  = -1;
+	Opt->SnapshotEnd  = -1;
+	Opt->SnapshotHop  = 0;
+	Opt->SnapshotGain = 1.0f;
+	Opt->SnapshotBank = NULL;
+	Opt->SnapshotName = NULL;
+	Opt->LoopProcess  = 1;
+	Opt->FreezeFactor = 1.0f;
+	Opt->FreezeBandLo = 0.0f;
+	Opt->FreezeBandHi = 0.0f;
+	Opt->FormatType   = FORMAT_DEFAULT;
+	Opt->nThreads     = 0;
+	Opt->Quiet        = 0;
+	Opt->AnalysisCacheDir = NULL;
+	Opt->Preview      = 0;
+	Opt->PreviewPre   = -1;
+	Opt->PreviewPost  = -1;
+	Opt->PreviewFast  = 0;
+	Opt->SilenceThreshold = 0.0f;
+	Opt->ResultCacheDir = NULL;
+	Opt->CheckpointFile = NULL;
+	Opt->CheckpointInterval = 60;
+	Opt->TraceFile    = NULL;
+	Opt->StatsJsonFile = NULL;
+	Opt->TelemetryFile = NULL;
+	Opt->DumpFile      = NULL;
+	Opt->DumpFormat    = DUMPFORMAT_F16;
+	Opt->DumpPhase     = 0;
+}
+
+/**************************************/
+
+int CLI_ParseOption(struct CLI_Options_t *Opt, const char *Arg) {
+	if(!memcmp(Arg, "-blocksize:", 11)) {
+		int x = atoi(Arg + 11);
+		if(x <= 65536 && Fourier_IsFFTSize(x)) Opt->BlockSize = x;
+		else printf("WARNING: Ignoring invalid parameter to block size (%d)\n", x);
+	}
+
+	else if(!memcmp(Arg, "-nhops:", 7)) {
+		int x = atoi(Arg + 7);
+		if(x >= 2) Opt->nHops = x;
+		else printf("WARNING: Ignoring invalid parameter to number of hops (%d)\n", x);
+	}
+
+	else if(!memcmp(Arg, "-window:", 8)) {
+		const char *x = Arg + 8;
+		     if(!strcmp(x, "sine"))     Opt->WindowType = SPECTRICE_WINDOW_TYPE_SINE;
+		else if(!strcmp(x, "hann"))     Opt->WindowType = SPECTRICE_WINDOW_TYPE_HANN;
+		else if(!strcmp(x, "hamming"))  Opt->WindowType = SPECTRICE_WINDOW_TYPE_HAMMING;
+		else if(!strcmp(x, "blackman")) Opt->WindowType = SPECTRICE_WINDOW_TYPE_BLACKMAN;
+		else if(!strcmp(x, "nuttall"))  Opt->WindowType = SPECTRICE_WINDOW_TYPE_NUTTALL;
+		else if(!strcmp(x, "sqrtcos"))  Opt->WindowType = SPECTRICE_WINDOW_TYPE_SQRTCOS;
+		else if(!strcmp(x, "kbd"))      Opt->WindowType = SPECTRICE_WINDOW_TYPE_KBD;
+		else printf("WARNING: Ignoring invalid parameter to window type (%s)\n", x);
+	}
+
+	else if(!memcmp(Arg, "-freezexfade:", 13)) {
+		int x = atoi(Arg + 13);
+		if(x >= 0) Opt->FreezeXFade = x;
+		else printf("WARNING: Ignoring invalid parameter to freeze crossfade (%d)\n", x);
+	}
+
+	else if(!memcmp(Arg, "-freezepoint:", 13)) {
+		int x = atoi(Arg + 13);
+		if(!strcmp(Arg + 13, "auto")) Opt->FreezePoint = FREEZEPOINT_AUTO;
+		else if(x > 0) Opt->FreezePoint = x;
+		else printf("WARNING: Ignoring invalid parameter to freeze point (%d)\n", x);
+	}
+
+	else if(!memcmp(Arg, "-freezefactor:", 14)) {
+		float x = atof(Arg + 14);
+		if(x >= 0.0f && x <= 1.0f) Opt->FreezeFactor = x;
+		else printf("WARNING: Ignoring invalid parameter to freeze factor (%f)\n", x);
+	}
+
+	else if(!memcmp(Arg, "-freezeband:", 12)) {
+		float Lo, Hi;
+		if(sscanf(Arg + 12, "%f,%f", &Lo, &Hi) == 2 && Lo >= 0.0f && (Hi == 0.0f || Hi > Lo)) {
+			Opt->FreezeBandLo = Lo;
+			Opt->FreezeBandHi = Hi;
+		} else printf("WARNING: Ignoring invalid parameter to freeze band (%s)\n", Arg + 12);
+	}
+
+	else if(!strcmp(Arg, "-nofreezeamp")) {
+		Opt->FreezeAmp = 0;
+	}
+
+	else if(!strcmp(Arg, "-freezephase")) {
+		Opt->FreezePhase = 1;
+	}
+
+	else if(!memcmp(Arg, "-snapshot:", 10)) {
+		char x = Arg[10];
+		Opt->SnapshotEnd = -1;
+		Opt->SnapshotHop = 0;
+		if(x == 'n' || x == 'N') Opt->SnapshotPos = -1, Opt->SnapshotName = NULL;
+		else {
+			int Pos, End, Hop = 0;
+			int nArgs = sscanf(Arg + 10, "%d,%d,%d", &Pos, &End, &Hop);
+			if(nArgs < 1 || Pos < 0 || (nArgs >= 2 && End <= Pos) || Hop < 0) {
+				printf("WARNING: Ignoring invalid parameter to snapshot (%s)\n", Arg + 10);
+			} else {
+				Opt->SnapshotPos = Pos;
+				if(nArgs >= 2) Opt->SnapshotEnd = End, Opt->SnapshotHop = Hop;
+			}
+		}
+	}
+
+	else if(!memcmp(Arg, "-snapshotgain:", 14)) {
+		const char *Str = Arg + 14;
+		double x = ReadGain(Str);
+		if(x == NAN) printf("WARNING: Ignoring invalid parameter to snapshot gain (%s)\n", Str);
+		else Opt->SnapshotGain = (float)x;
+	}
+
+	else if(!memcmp(Arg, "-snapshotbank:", 14)) {
+		const char *x = Arg + 14;
+		if(*x) Opt->SnapshotBank = x;
+		else   Opt->SnapshotBank = NULL;
+	}
+
+	else if(!memcmp(Arg, "-snapshotname:", 14)) {
+		const char *x = Arg + 14;
+		if(*x) Opt->SnapshotName = x;
+		else   Opt->SnapshotName = NULL;
+	}
+
+	else if(!memcmp(Arg, "-loops:", 7)) {
+		char x = Arg[7];
+		     if(x == 'y' || x == 'Y') Opt->LoopProcess = 1;
+		else if(x == 'n' || x == 'N') Opt->LoopProcess = 0;
+		else printf("WARNING: Ignoring invalid parameter to loop processing (%c)\n", x);
+	}
+
+	else if(!memcmp(Arg, "-format:", 8)) {
+		const char *FmtStr = Arg + 8;
+		     if(!strcmp(FmtStr, "PCM8")    || !strcmp(FmtStr, "pcm8"))
+			Opt->FormatType = FORMAT_PCM8;
+		else if(!strcmp(FmtStr, "PCM16")   || !strcmp(FmtStr, "pcm16"))
+			Opt->FormatType = FORMAT_PCM16;
+		else if(!strcmp(FmtStr, "PCM24")   || !strcmp(FmtStr, "pcm24"))
+			Opt->FormatType = FORMAT_PCM24;
+		else if(!strcmp(FmtStr, "FLOAT32") || !strcmp(FmtStr, "float32"))
+			Opt->FormatType = FORMAT_FLOAT32;
+		else if(!strcmp(FmtStr, "DEFAULT") || !strcmp(FmtStr, "default"))
+			Opt->FormatType = FORMAT_DEFAULT;
+		else {
+			printf("ERROR: Invalid output format (%s).\n", FmtStr);
+			return 0;
+		}
+	}
+
+	else if(!memcmp(Arg, "-threads:", 9)) {
+		int x = atoi(Arg + 9);
+		if(x >= 0) Opt->nThreads = x;
+		else printf("WARNING: Ignoring invalid parameter to number of threads (%d)\n", x);
+	}
+
+	else if(!memcmp(Arg, "-cache:", 7)) {
+		const char *x = Arg + 7;
+		if(*x) Opt->AnalysisCacheDir = x;
+		else   Opt->AnalysisCacheDir = NULL;
+	}
+
+	else if(!strcmp(Arg, "-preview") || !memcmp(Arg, "-preview:", 9)) {
+		Opt->Preview = 1;
+		if(Arg[8] == ':') {
+			int Pre, Post;
+			if(sscanf(Arg + 9, "%d,%d", &Pre, &Post) == 2 && Pre >= 0 && Post >= 0) {
+				Opt->PreviewPre  = Pre;
+				Opt->PreviewPost = Post;
+			} else printf("WARNING: Ignoring invalid parameter to preview (%s)\n", Arg + 9);
+		}
+	}
+
+	else if(!strcmp(Arg, "-previewfast")) {
+		Opt->Preview     = 1;
+		Opt->PreviewFast = 1;
+	}
+
+	else if(!memcmp(Arg, "-silence:", 9)) {
+		float x = atof(Arg + 9);
+		if(x < 0.0f) Opt->SilenceThreshold = powf(10.0f, x / 20.0f);
+		else printf("WARNING: Ignoring invalid parameter to silence threshold (%s)\n", Arg + 9);
+	}
+
+	else if(!memcmp(Arg, "-resultcache:", 13)) {
+		const char *x = Arg + 13;
+		if(*x) Opt->ResultCacheDir = x;
+		else   Opt->ResultCacheDir = NULL;
+	}
+
+	else if(!memcmp(Arg, "-checkpoint:", 12)) {
+		const char *x = Arg + 12;
+		if(*x) Opt->CheckpointFile = x;
+		else   Opt->CheckpointFile = NULL;
+	}
+
+	else if(!memcmp(Arg, "-trace:", 7)) {
+		const char *x = Arg + 7;
+		if(*x) Opt->TraceFile = x;
+		else   Opt->TraceFile = NULL;
+	}
+
+	else if(!memcmp(Arg, "-statsjson:", 11)) {
+		const char *x = Arg + 11;
+		if(*x) Opt->StatsJsonFile = x;
+		else   Opt->StatsJsonFile = NULL;
+	}
+
+	else if(!memcmp(Arg, "-telemetry:", 11)) {
+		const char *x = Arg + 11;
+		if(*x) Opt->TelemetryFile = x;
+		else   Opt->TelemetryFile = NULL;
+	}
+
+	else if(!memcmp(Arg, "-dumpspectra:", 13)) {
+		const char *x = Arg + 13;
+		if(*x) Opt->DumpFile = x;
+		else   Opt->DumpFile = NULL;
+	}
+
+	else if(!memcmp(Arg, "-dumpformat:", 12)) {
+		const char *x = Arg + 12;
+		     if(!strcmp(x, "f16"))  Opt->DumpFormat = DUMPFORMAT_F16;
+		else if(!strcmp(x, "log8")) Opt->DumpFormat = DUMPFORMAT_LOG8;
+		else printf("WARNING: Ignoring invalid parameter to dump format (%s)\n", x);
+	}
+
+	else if(!strcmp(Arg, "-dumpphase")) {
+		Opt->DumpPhase = 1;
+	}
+
+	else if(!memcmp(Arg, "-checkpointinterval:", 20)) {
+		int x = atoi(Arg + 20);
+		if(x >= 1) Opt->CheckpointInterval = x;
+		else printf("WARNING: Ignoring invalid parameter to checkpoint interval (%d)\n", x);
+	}
+
+	else printf("WARNING: Ignoring unknown argument (%s)\n", Arg);
+	return 1;
+}
+
+int CLI_OptionsShareAnalysis(const struct CLI_Options_t *a, const struct CLI_Options_t *b) {
+	//! NOTE: The cache directory doesn't change the analysis itself, but
+	//! every variant uses the first one's cache, so it has to match as well.
+	int SameCache = (!a->AnalysisCacheDir == !b->AnalysisCacheDir);
+	if(SameCache && a->AnalysisCacheDir) SameCache = !strcmp(a->AnalysisCacheDir, b->AnalysisCacheDir);
+	return (
+		a->BlockSize   == b->BlockSize   &&
+		a->nHops       == b->nHops       &&
+		a->WindowType  == b->WindowType  &&
+		a->FreezeXFade == b->FreezeXFade &&
+		a->FreezePoint == b->FreezePoint &&
+		a->LoopProcess == b->LoopProcess &&
+		a->Preview     == b->Preview     &&
+		a->PreviewPre  == b->PreviewPre  &&
+		a->PreviewPost == b->PreviewPost &&
+		a->PreviewFast == b->PreviewFast &&
+		a->SilenceThreshold == b->SilenceThreshold &&
+		SameCache
+	);
+}
+
+/**************************************/
+
+uint64_t CLI_HashOptions(uint64_t Hash, const struct CLI_Options_t *Opt) {
+	//! NOTE: nThreads, Quiet, checkpointing, tracing, run statistics,
+	//! telemetry, spectrum dumps and the analysis cache don't change the
+	//! output. The contents of the snapshot bank must be hashed separately.
+#define HASH_FIELD(x) Hash = Hash_FNV1a64(Hash, &(x), sizeof(x))
+	HASH_FIELD(Opt->BlockSize);
+	HASH_FIELD(Opt->nHops);
+	HASH_FIELD(Opt->FreezeAmp);
+	HASH_FIELD(Opt->FreezePhase);
+	HASH_FIELD(Opt->WindowType);
+	HASH_FIELD(Opt->FreezeXFade);
+	HASH_FIELD(Opt->FreezePoint);
+	HASH_FIELD(Opt->SnapshotPos);
+	HASH_FIELD(Opt->SnapshotEnd);
+	HASH_FIELD(Opt->SnapshotHop);
+	HASH_FIELD(Opt->SnapshotGain);
+	if(Opt->SnapshotName) Hash = Hash_FNV1a64(Hash, Opt->SnapshotName, strlen(Opt->SnapshotName) + 1);
+	HASH_FIELD(Opt->LoopProcess);
+	HASH_FIELD(Opt->FreezeFactor);
+	HASH_FIELD(Opt->FreezeBandLo);
+	HASH_FIELD(Opt->FreezeBandHi);
+	HASH_FIELD(Opt->FormatType);
+	HASH_FIELD(Opt->Preview);
+	HASH_FIELD(Opt->PreviewPre);
+	HASH_FIELD(Opt->PreviewPost);
+	HASH_FIELD(Opt->PreviewFast);
+	HASH_FIELD(Opt->SilenceThreshold);
+#undef HASH_FIELD
+	return Hash;
+}
+
+/**************************************/
+
+int CLI_TokenizeLine(char *Line, char **Tokens, int MaxTokens) {
+	int nTokens = 0;
+	char *s = Line;
+	for(;;) {
+		while(*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n') s++;
+		if(!*s || (*s == '#' && nTokens == 0)) break;
+		if(nTokens == MaxTokens) return -1;
+		if(*s == '"') {
+			Tokens[nTokens++] = ++s;
+			while(*s && *s != '"') s++;
+		} else {
+			Tokens[nTokens++] = s;
+			while(*s && *s != ' ' && *s != '\t' && *s != '\r' && *s != '\n') s++;
+		}
+		if(*s) *s++ = '\0';
+	}
+	return nTokens;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
@@ -0,0 +1,832 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+/**************************************/
+#include "CLI.h"
+#include "MiniRIFF.h"
+#include "Perf.h"
+#include "Trace.h"
+#include "WavIO.h"
+/**************************************/
+
+//! Minimum number of remaining blocks for segmented rendering
+#define SEGMENTED_MIN_BLOCKS 16
+
+//! Seconds between progress updates
+#define PROGRESS_INTERVAL 0.1
+
+/**************************************/
+
+//! Counter reader for Spectrice_SetStatsCounters()
+static void ReadPerfCounters(void *User, uint64_t *Values) {
+	Perf_Read((const struct Perf_t*)User, Values);
+}
+
+//! Stage hook for Spectrice_SetStatsStageFunc(), recording each stage of
+//! every hop as a span on the timeline
+static void TraceStage(void *User, int Stage, int Chan) {
+	(void)User;
+	Trace_Lap((Stage < 0) ? NULL : Spectrice_GetStageName(Stage), "chan", Chan);
+}
+
+//! Print a per-stage timing summary
+//! Perf is the source of the extra counters (NULL = none).
+static void PrintStageStats(const struct Spectrice_Stats_t *Stats, const struct Perf_t *Perf) {
+	int Stage;
+	double Total = 0.0;
+	for(Stage=0;Stage<SPECTRICE_STAGE_COUNT;Stage++) Total += Stats->Time[Stage];
+	if(Total <= 0.0 || Stats->nHops == 0) return;
+	printf("\nStage timings (%llu hops, %.3fs):", (unsigned long long)Stats->nHops, Total);
+	for(Stage=0;Stage<SPECTRICE_STAGE_COUNT;Stage++) {
+		printf(
+			"\n %-8s %9.3fs %6.2f%% %10.1fns/hop",
+			Spectrice_GetStageName(Stage), Stats->Time[Stage],
+			Stats->Time[Stage] * 100.0 / Total, Stats->Time[Stage] * 1.0e9 / Stats->nHops
+		);
+	}
+
+	//! Hardware counters only cover the hops processed on this thread
+	if(!Perf) return;
+	if(!Perf->nOpen) {
+		printf("\nHardware counters unavailable (perf_event_paranoid = %d).", Perf_GetParanoid());
+		return;
+	}
+	if(Stats->nCounterHops == 0) return;
+	printf("\nHardware counters (%llu hops on the main thread):", (unsigned long long)Stats->nCounterHops);
+	printf("\n %-8s %6s %8s %8s %12s", "", "IPC", "L1D miss", "LLC miss", "Br.miss/hop");
+	for(Stage=0;Stage<SPECTRICE_STAGE_COUNT;Stage++) {
+		const double *c = Stats->Counters[Stage];
+		printf("\n %-8s", Spectrice_GetStageName(Stage));
+		if(Perf_Has(Perf, PERF_CYCLES) && Perf_Has(Perf, PERF_INSTRUCTIONS) && c[PERF_CYCLES] > 0.0) {
+			printf(" %6.2f", c[PERF_INSTRUCTIONS] / c[PERF_CYCLES]);
+		} else printf(" %6s", "-");
+		if(Perf_Has(Perf, PERF_L1D_LOADS) && Perf_Has(Perf, PERF_L1D_MISSES) && c[PERF_L1D_LOADS] > 0.0) {
+			printf(" %7.2f%%", c[PERF_L1D_MISSES] * 100.0 / c[PERF_L1D_LOADS]);
+		} else printf(" %8s", "-");
+		if(Perf_Has(Perf, PERF_LLC_LOADS) && Perf_Has(Perf, PERF_LLC_MISSES) && c[PERF_LLC_LOADS] > 0.0) {
+			printf(" %7.2f%%", c[PERF_LLC_MISSES] * 100.0 / c[PERF_LLC_LOADS]);
+		} else printf(" %8s", "-");
+		if(Perf_Has(Perf, PERF_BRANCH_MISSES)) {
+			printf(" %12.2f", c[PERF_BRANCH_MISSES] / Stats->nCounterHops);
+		} else printf(" %12s", "-");
+	}
+}
+
+/**************************************/
+
+void CLI_WorkerInit(struct CLI_Worker_t *Worker) {
+	Worker->HaveState  = 0;
+	Worker->Buffer     = NULL;
+	Worker->BufferSize = 0;
+}
+
+void CLI_WorkerDestroy(struct CLI_Worker_t *Worker) {
+	if(Worker->HaveState) Spectrice_Destroy(&Worker->State);
+	free(Worker->Buffer);
+	CLI_WorkerInit(Worker);
+}
+
+/**************************************/
+
+//! Get worker buffer of at least nFloats in size
+static float *GetWorkerBuffer(struct CLI_Worker_t *Worker, int nFloats) {
+	if(Worker->BufferSize < nFloats) {
+		free(Worker->Buffer);
+		Worker->Buffer = malloc(sizeof(float) * nFloats);
+		Worker->BufferSize = Worker->Buffer ? nFloats : 0;
+	}
+	return Worker->Buffer;
+}
+
+static double GetTime(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1.0e-9;
+}
+
+void CLI_Progress_Init(struct CLI_Progress_t *Progress, int Quiet) {
+	Progress->Quiet     = Quiet;
+	Progress->LastBlock = -1;
+	Progress->NextTime  = 0.0;
+}
+
+void CLI_Progress_Update(struct CLI_Progress_t *Progress, int Block, int nBlocks) {
+	if(Progress->Quiet) return;
+	double Time = GetTime();
+	if(Time < Progress->NextTime && Block+1 < nBlocks) return;
+	printf("\rBlock %u/%u (%.2f%%)", Block+1, nBlocks, Block*100.0f/nBlocks);
+	fflush(stdout);
+	Progress->LastBlock = Block;
+	Progress->NextTime  = Time + PROGRESS_INTERVAL;
+}
+
+void CLI_Progress_Finish(struct CLI_Progress_t *Progress, int nBlocks) {
+	if(Progress->LastBlock != nBlocks-1) CLI_Progress_Update(Progress, nBlocks-1, nBlocks);
+}
+
+/**************************************/
+
+void CLI_ReadStream(struct CLI_InputStream_t *Stream, float *Dst, int nSmp, int nSmpTotal) {
+	//! Make sure to wrap around at the loop point
+	int nChan = Stream->File->fmt->nChannels;
+	int nReadSmpRem = nSmp;
+	while(nReadSmpRem) {
+		if(Stream->LoopProcess && !Stream->nLoopSamplesRem) {
+			//! Rewind to loop start
+			Stream->File->SamplePosition -= Stream->LoopLen;
+			Stream->nLoopSamplesRem      += Stream->LoopLen;
+		}
+
+		int nSmpThisRun = nReadSmpRem;
+		if(Stream->LoopProcess && nSmpThisRun > Stream->nLoopSamplesRem) nSmpThisRun = Stream->nLoopSamplesRem;
+		WAV_ReadAsFloat(Stream->File, Dst, nSmpThisRun);
+
+		nReadSmpRem             -= nSmpThisRun;
+		Stream->nLoopSamplesRem -= nSmpThisRun;
+		Dst                     += nSmpThisRun * nChan;
+	}
+
+	//! Clear end of buffer if needed
+	int n, N = nSmpTotal - nSmp;
+	for(n=0;n<N*nChan;n++) *Dst++ = 0.0f;
+}
+
+/**************************************/
+
+//! Per-variant render state
+struct RenderVariant_t {
+	const struct CLI_Options_t *Opt;
+	struct Spectrice_t *State;
+	struct Spectrice_t  LocalState; //! Used by all but the first variant
+	struct WAV_State_t  FileOut;
+	float *OutBuffer;
+	int    SnapshotPos;
+	struct MapFile_t BankMap; //! Snapshot bank (when using -snapshotname)
+	int    HaveFile;
+	int    HaveState;
+};
+
+//! Set the range of lines to freeze from a band in Hz
+//! Lines are frozen when their centre frequency lies within the band.
+static void SetFreezeBins(struct Spectrice_t *State, const struct CLI_Options_t *Opt, int SampleRate) {
+	int Bins = State->BlockSize / 2;
+	double Scale = (double)State->BlockSize / SampleRate;
+	double Lo = ceil (Opt->FreezeBandLo*Scale - 0.5);
+	double Hi = floor(Opt->FreezeBandHi*Scale - 0.5) + 1.0;
+	if(Opt->FreezeBandHi == 0.0f || Hi > Bins) Hi = Bins;
+	if(Lo > Hi) Lo = Hi;
+	if(Hi <= 0.0) Lo = Hi = Bins; //! Empty (FreezeBinHi = 0 would mean all lines)
+	State->FreezeBinLo = (int)Lo;
+	State->FreezeBinHi = (int)Hi;
+}
+
+/**************************************/
+
+//! Create output file, copying all extra chunks from the source file
+//! unless CopyChunks is 0. If ResumeSmp >= 0, then the file is re-opened
+//! to carry on writing after its first ResumeSmp sample points instead.
+static int CreateOutputFile(struct WAV_State_t *FileOut, const char *OutFilename, struct WAV_State_t *FileIn, int FormatType, int CopyChunks, int64_t ResumeSmp) {
+	struct WAVE_fmt_t fmt, *fmtSrc = FileIn->fmt;
+	if(FormatType == FORMAT_DEFAULT) {
+		memcpy(&fmt, fmtSrc, sizeof(fmt));
+	} else {
+		int BytesPerSmp = 0;
+		switch(FormatType) {
+			case FORMAT_PCM8:    BytesPerSmp =  8 / 8; break;
+			case FORMAT_PCM16:   BytesPerSmp = 16 / 8; break;
+			case FORMAT_PCM24:   BytesPerSmp = 24 / 8; break;
+			case FORMAT_FLOAT32: BytesPerSmp = 32 / 8; break;
+		}
+		fmt.wFormatTag      = (FormatType == FORMAT_FLOAT32) ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+		fmt.nChannels       = fmtSrc->nChannels;
+		fmt.nSamplesPerSec  = fmtSrc->nSamplesPerSec;
+		fmt.nAvgBytesPerSec = BytesPerSmp * fmtSrc->nChannels * fmtSrc->nSamplesPerSec;
+		fmt.nBlockAlign     = BytesPerSmp * fmtSrc->nChannels;
+		fmt.wBitsPerSample  = BytesPerSmp * 8;
+	}
+	int Error;
+	if(ResumeSmp >= 0) {
+		Error = WAV_ResumeW(FileOut, OutFilename, &fmt, (uint32_t)ResumeSmp);
+		if(Error < 0) {
+			printf("ERROR: Unable to resume output file (%s); error %s.\n", OutFilename, WAV_ErrorCodeToString(Error));
+			return 0;
+		}
+	} else {
+		Error = WAV_OpenW(FileOut, OutFilename, &fmt);
+		if(Error < 0) {
+			printf("ERROR: Unable to create output file (%s); error %s.\n", OutFilename, WAV_ErrorCodeToString(Error));
+			return 0;
+		}
+	}
+
+	//! Copy all chunks from source file
+	const struct WAV_Chunk_t *SrcCk = CopyChunks ? FileIn->Chunks : NULL;
+	      struct WAV_Chunk_t *Prev  = NULL;
+	while(SrcCk) {
+		//! Ensure to exclude fmt and data
+		if(SrcCk->CkType != RIFF_FOURCC("fmt ") && SrcCk->CkType != RIFF_FOURCC("data")) {
+			//! Allocate memory for chunk header and data
+			struct WAV_Chunk_t *DstCk = malloc(sizeof(struct WAV_Chunk_t) + SrcCk->CkSize);
+			if(DstCk) {
+				//! Fille out new chunk and read from source file
+				DstCk->CkType = SrcCk->CkType;
+				DstCk->CkSize = SrcCk->CkSize;
+				DstCk->Prev   = Prev;
+				DstCk->Next   = NULL;
+				if(Prev) Prev->Next      = DstCk;
+				else     FileOut->Chunks = DstCk;
+				fseek(FileIn->File, SrcCk->FileOffs, SEEK_SET);
+				fread(DstCk+1, SrcCk->CkSize, 1, FileIn->File);
+				Prev = DstCk;
+			}
+		}
+		SrcCk = SrcCk->Next;
+	}
+	return 1;
+}
+
+//! Close output file and free its chunks
+static void CloseOutputFile(struct WAV_State_t *FileOut) {
+	//! Save pointer to chunks data and close file
+	struct WAV_Chunk_t *Ck = FileOut->Chunks;
+	WAV_Close(FileOut);
+
+	//! Delete output file chunks
+	while(Ck) {
+		struct WAV_Chunk_t *Next = Ck->Next;
+		free(Ck);
+		Ck = Next;
+	}
+}
+
+/**************************************/
+
+int CLI_RenderFile(
+	struct CLI_Worker_t *Worker,
+	const char *InFilename,
+	const char *OutFilename,
+	const struct CLI_Options_t *Opt,
+	struct CLI_RenderStats_t *Stats
+) {
+	if(Opt->ResultCacheDir) return CLI_ResultCache_Render(Worker, InFilename, OutFilename, Opt, Stats);
+	return CLI_RenderVariants(Worker, InFilename, &OutFilename, Opt, 1, Stats);
+}
+
+/**************************************/
+
+int CLI_RenderVariants(
+	struct CLI_Worker_t *Worker,
+	const char *InFilename,
+	const char *const *OutFilenames,
+	const struct CLI_Options_t *Opts,
+	int nVariants,
+	struct CLI_RenderStats_t *Stats
+) {
+	int v;
+	int ExitCode = 0;
+	struct WAV_State_t FileIn;
+	struct RenderVariant_t *Variants = NULL;
+
+	//! Get local copies of parameters that we might need to adjust
+	//! NOTE: Anything that affects the analysis is taken from the first
+	//! variant; CLI_OptionsShareAnalysis() must be true for all others.
+	const struct CLI_Options_t *Opt = &Opts[0];
+	int   BlockSize    = Opt->BlockSize;
+	int   FreezePoint  = Opt->FreezePoint;
+	int   LoopEnd      = 0;
+	int   LoopLen      = 0;
+	int   LoopProcess  = Opt->LoopProcess;
+	int   nHops        = Opt->nHops;
+	int   WindowType   = Opt->WindowType;
+	for(v=1;v<nVariants;v++) if(!CLI_OptionsShareAnalysis(Opt, &Opts[v])) {
+		printf("ERROR: Variant %d (%s) doesn't share analysis settings.\n", v+1, OutFilenames[v]);
+		return -1;
+	}
+
+	//! The fast preview tier halves the work (or better) by dropping to a
+	//! Hann window with 4 hops, and uses approximate math for the polar
+	//! conversions on top of that.
+	if(Opt->PreviewFast && nHops > 4) {
+		nHops      = 4;
+		WindowType = SPECTRICE_WINDOW_TYPE_HANN;
+	}
+	if(BlockSize % nHops != 0) {
+		printf("ERROR: Number of hops (%d) must divide the block size (%d).\n", nHops, BlockSize);
+		return -1;
+	}
+
+	//! Open input file
+	{
+		int Error = WAV_OpenR(&FileIn, InFilename);
+		if(Error < 0) {
+			printf("ERROR: Unable to open input file (%s); error %s.\n", InFilename, WAV_ErrorCodeToString(Error));
+			ExitCode = -1; goto Exit_FailOpenInFile;
+		}
+	}
+
+	//! Ensure file is at last as long the block size
+	if((int)FileIn.nSamplePoints < BlockSize) {
+		printf("ERROR: Input file has less sample points than BlockSize (%s).\n", InFilename);
+		ExitCode = -1; goto Exit_FailFileLength;
+	}
+
+	//! Set up variants
+	Variants = calloc(nVariants, sizeof(struct RenderVariant_t));
+	if(!Variants) {
+		printf("ERROR: Couldn't allocate variants.\n");
+		ExitCode = -1; goto Exit_FailFileLength;
+	}
+	for(v=0;v<nVariants;v++) {
+		struct RenderVariant_t *Variant = &Variants[v];
+		Variant->Opt         = &Opts[v];
+		Variant->State       = v ? &Variant->LocalState : &Worker->State;
+		Variant->SnapshotPos = Opts[v].SnapshotName ? -1 : Opts[v].SnapshotPos;
+
+		//! Ensure snapshot position is valid
+		if(Variant->SnapshotPos >= 0 && Variant->SnapshotPos >= (int)FileIn.nSamplePoints - BlockSize) {
+			printf("WARNING: Snapshot position too close to end of file; moving to last block.\n");
+			Variant->SnapshotPos = FileIn.nSamplePoints - BlockSize;
+		}
+	}
+
+	//! Read loop points
+	{
+		//! Find a smpl chunk
+		const struct WAV_Chunk_t *Ck = FileIn.Chunks;
+		while(Ck) {
+			if(Ck->CkType == RIFF_FOURCC("smpl")) {
+				struct WAVE_smpl_t *CkData = malloc(Ck->CkSize);
+				if(CkData) {
+					fseek(FileIn.File, Ck->FileOffs, SEEK_SET);
+					fread(CkData, Ck->CkSize, 1, FileIn.File);
+
+					//! Now find the first loop point and assign
+					uint32_t i;
+					for(i=0;i<CkData->cSampleLoops;i++) {
+						struct WAVE_smpl_loop_t *CkLoop = &CkData->loopPoints[i];
+						if(CkLoop->dwType == WAVE_SMPL_LOOP_TYPE_FOWARD) {
+							//! dwEnd is inclusive, but we need exclusive, so add 1
+							LoopEnd = CkLoop->dwEnd+1;
+							LoopLen = LoopEnd - CkLoop->dwStart;
+							break;
+						}
+					}
+					free(CkData);
+				}
+				break;
+			} else Ck = Ck->Next;
+		}
+
+		//! If we have no loops, disable loop processing
+		if(!LoopLen) LoopProcess = 0;
+	}
+
+	//! If we don't have a freeze point, set it now
+	if(FreezePoint == 0 || FreezePoint == FREEZEPOINT_AUTO) {
+		if(LoopLen) {
+			FreezePoint = LoopEnd - LoopLen;
+		} else if(FreezePoint == FREEZEPOINT_AUTO) {
+			int MinPoint = BlockSize + BlockSize/2 + Opt->FreezeXFade;
+			int nFound = CLI_FindFreezePoints(&FileIn, Opt, MinPoint, &FreezePoint, NULL, 1);
+			if(nFound < 0) {
+				ExitCode = -1; goto Exit_FailGetFreezePoint;
+			}
+			if(nFound == 0) {
+				printf("ERROR: Unable to find a suitable freeze point (%s).\n", InFilename);
+				ExitCode = -1; goto Exit_FailGetFreezePoint;
+			}
+			if(!Opt->Quiet) printf("Using freeze point %d.\n", FreezePoint);
+		} else {
+			printf("ERROR: Unable to find freeze point (%s).\n", InFilename);
+			ExitCode = -1; goto Exit_FailGetFreezePoint;
+		}
+	}
+	int FreezeStart = FreezePoint - Opt->FreezeXFade;
+
+	//! Verify that FreezeStart occurs after at least one block of data
+	//! NOTE: Further shift by BlockSize/2 to account for OLA structure.
+	int XformPrimingLength = BlockSize + BlockSize/2;
+	if(FreezeStart < XformPrimingLength) {
+		printf("WARNING: Freeze start point too early; moving to %d.\n", XformPrimingLength);
+		FreezeStart = XformPrimingLength;
+		if(FreezePoint < FreezeStart) FreezePoint = FreezeStart;
+	}
+
+	//! Open the analysis cache if requested
+	//! The cached analysis is on a grid of blocks lined up with where
+	//! processing starts, so that it matches processing without the cache.
+	struct CLI_InputStream_t Stream = {&FileIn, LoopProcess, LoopLen, LoopEnd};
+	struct CLI_AnalysisCache_t Cache;
+	int UseCache = 0;
+	int ProcStart = FreezeStart - XformPrimingLength;
+	if(Opt->AnalysisCacheDir) {
+		UseCache = CLI_AnalysisCache_Open(
+			&Cache, Opt->AnalysisCacheDir, InFilename, &Stream,
+			BlockSize, nHops, WindowType, ProcStart % BlockSize, Opt->Quiet
+		);
+	}
+
+	//! Look for a checkpoint to resume from
+	//! NOTE: Only single renders are checkpointed.
+	int nChan = FileIn.fmt->nChannels;
+	const char *CheckpointFile = Opt->CheckpointFile;
+	struct CLI_Checkpoint_t Ckpt;
+	int Resume = 0;
+	if(CheckpointFile && nVariants > 1) {
+		printf("WARNING: Checkpoints are not supported when rendering several variants.\n");
+		CheckpointFile = NULL;
+	}
+	if(CheckpointFile) {
+		Ckpt.Key      = CLI_Checkpoint_GetKey(InFilename, OutFilenames[0], Opt);
+		Ckpt.nHistory = BlockSize*2*nChan;
+		Resume = CLI_Checkpoint_Load(&Ckpt, CheckpointFile, Ckpt.Key, Ckpt.nHistory);
+		if(Resume && Ckpt.ProcStart != ProcStart) {
+			printf("WARNING: Checkpoint was made from a different processing start point; starting from the beginning.\n");
+			CLI_Checkpoint_Close(&Ckpt);
+			Resume = 0;
+		}
+		if(Resume && !Opt->Quiet) printf("Resuming from checkpoint (%s).\n", CheckpointFile);
+	}
+
+	//! Create output files
+	//! NOTE: Previews don't keep any chunks, as loop points etc. would no
+	//! longer line up with the audio.
+	for(v=0;v<nVariants;v++) {
+		int64_t ResumeSmp = Resume ? (int64_t)Ckpt.nOutputSmpTotal : -1;
+		if(!CreateOutputFile(&Variants[v].FileOut, OutFilenames[v], &FileIn, Opts[v].FormatType, !Opt->Preview, ResumeSmp)) {
+			ExitCode = -1; goto Exit_FailCreateOutFile;
+		}
+		Variants[v].HaveFile = 1;
+	}
+
+	//! Get reading buffers
+	//! NOTE: We keep the previous block of input around (PrevBuffer), as
+	//! segmented rendering needs the last two blocks for priming. Spectra
+	//! is only needed when sharing the analysis between several variants.
+	int BlockFloats = SPECTRICE_SPECTRA_SIZE(nChan, BlockSize, nHops);
+	float *PrevBuffer = GetWorkerBuffer(Worker, (2+nVariants)*BlockSize*nChan + ((nVariants > 1 || UseCache) ? BlockFloats : 0));
+	if(!PrevBuffer) {
+		printf("ERROR: Couldn't allocate reading buffer.\n");
+		ExitCode = -1; goto Exit_FailCreateAllocBuffer;
+	}
+	float *ReadBuffer = PrevBuffer + BlockSize*nChan;
+	for(v=0;v<nVariants;v++) Variants[v].OutBuffer = ReadBuffer + (1+v)*BlockSize*nChan;
+	float *SpectraBuffer = ReadBuffer + (1+nVariants)*BlockSize*nChan;
+	{
+		int n;
+		for(n=0;n<BlockSize*nChan;n++) PrevBuffer[n] = 0.0f;
+	}
+
+	//! Get the range of output to render
+	//! For previews, this is limited to around the freeze, but always
+	//! includes everything from where processing starts.
+	int OutputBeg = 0;
+	int OutputEnd = FileIn.nSamplePoints;
+	if(Opt->Preview) {
+		int SampleRate = FileIn.fmt->nSamplesPerSec;
+		int Pre  = (Opt->PreviewPre  >= 0) ? Opt->PreviewPre  : SampleRate;
+		int Post = (Opt->PreviewPost >= 0) ? Opt->PreviewPost : SampleRate;
+		OutputBeg = FreezeStart - Pre;
+		if(OutputBeg > ProcStart) OutputBeg = ProcStart;
+		if(OutputBeg < 0)         OutputBeg = 0;
+		if(FreezePoint + Post < OutputEnd) OutputEnd = FreezePoint + Post;
+		if(!Opt->Quiet) printf("Preview: Rendering sample points %d..%d.\n", OutputBeg, OutputEnd);
+	}
+
+	//! Because the freeze start point might not be block-aligned, we copy
+	//! samples directly until one block before the freeze start point; we
+	//! then use this block to prime the processor.
+	//! When resuming, all of this (and the processing up to the checkpoint)
+	//! was already done, so just restore the input position and history.
+	uint32_t nOutputSmpTotal = ProcStart - OutputBeg;
+	if(Resume) {
+		nOutputSmpTotal        = Ckpt.nOutputSmpTotal;
+		FileIn.SamplePosition  = Ckpt.InputPosition;
+		Stream.nLoopSamplesRem = Ckpt.nLoopSamplesRem;
+		memcpy(PrevBuffer, Ckpt.History, sizeof(float) * Ckpt.nHistory);
+	} else {
+		int nSmpRem = ProcStart - OutputBeg;
+		FileIn.SamplePosition = OutputBeg;
+		while(nSmpRem) {
+			int N = nSmpRem;
+			if(N > BlockSize) N = BlockSize;
+			nSmpRem -= N;
+			WAV_ReadAsFloat(&FileIn, ReadBuffer, N);
+			for(v=0;v<nVariants;v++) WAV_WriteFromFloat(&Variants[v].FileOut, ReadBuffer, N);
+		}
+		WAV_ReadAsFloat(&FileIn, ReadBuffer, BlockSize);
+		Stream.nLoopSamplesRem -= ProcStart + BlockSize;
+	}
+
+	//! Initialize states
+	//! With a single variant, Spectrice_Process() does everything, so we
+	//! can prime as usual. Otherwise, every state is primed with the shared
+	//! analysis (from the first state) below.
+	//! NOTE: If this worker already has a state from a previous file, then
+	//! re-use its memory rather than starting from scratch.
+	int SharedAnalysis = (nVariants > 1 || UseCache);
+	if(Resume) {
+		//! Carry on from the saved state instead (single variant only)
+		if(Worker->HaveState) Spectrice_Destroy(Variants[0].State);
+		Worker->HaveState = Variants[0].HaveState = Spectrice_LoadState(Variants[0].State, Ckpt.StateData, Ckpt.StateSize);
+		CLI_Checkpoint_Close(&Ckpt);
+		if(!Worker->HaveState) {
+			printf("ERROR: Unable to restore processor from checkpoint.\n");
+			ExitCode = -1; goto Exit_FailInitSpectrice;
+		}
+	} else for(v=0;v<nVariants;v++) {
+		struct RenderVariant_t *Variant = &Variants[v];
+		const struct CLI_Options_t *VarOpt = Variant->Opt;
+		struct Spectrice_t *State = Variant->State;
+
+		//! If we need to capture a single-block snapshot, do so now and put
+		//! it in OutBuffer
+		int IsRange = (Variant->SnapshotPos >= 0 && VarOpt->SnapshotEnd >= 0);
+		if(Variant->SnapshotPos >= 0 && !IsRange) {
+			uint32_t OldPos = FileIn.SamplePosition;
+			FileIn.SamplePosition = Variant->SnapshotPos;
+			WAV_ReadAsFloat(&FileIn, Variant->OutBuffer, BlockSize);
+			FileIn.SamplePosition = OldPos;
+
+			//! Apply gain
+			int n;
+			if(VarOpt->SnapshotGain != 1.0f) {
+				for(n=0;n<BlockSize*nChan;n++) Variant->OutBuffer[n] *= VarOpt->SnapshotGain;
+			}
+		}
+
+		State->nChan        = nChan;
+		State->BlockSize    = BlockSize;
+		State->nHops        = nHops;
+		State->FreezeStart  = FreezeStart - ProcStart - BlockSize/2;
+		State->FreezePoint  = FreezePoint - ProcStart - BlockSize/2;
+		State->FreezeFactor = VarOpt->FreezeFactor;
+		State->FreezeAmp    = VarOpt->FreezeAmp;
+		State->FreezePhase  = VarOpt->FreezePhase;
+		State->FastMath     = VarOpt->PreviewFast;
+		State->SilenceThreshold = VarOpt->SilenceThreshold;
+		SetFreezeBins(State, VarOpt, FileIn.fmt->nSamplesPerSec);
+		const float *Snapshot = (Variant->SnapshotPos >= 0 && !IsRange) ? Variant->OutBuffer : NULL;
+		const float *PrimingInput = SharedAnalysis ? NULL : ReadBuffer;
+
+		//! Snapshots from a bank or averaged over a range are already
+		//! transformed, so they're set after initializing, and priming has
+		//! to wait until then
+		const float *Spectrum = NULL;
+		if(VarOpt->SnapshotName) {
+			Spectrum = CLI_SnapshotBank_Open(
+				&Variant->BankMap, VarOpt->SnapshotBank, VarOpt->SnapshotName,
+				nChan, BlockSize, nHops, WindowType
+			);
+			if(!Spectrum) {
+				ExitCode = -1; goto Exit_FailInitSpectrice;
+			}
+			PrimingInput = NULL;
+		} else if(IsRange) PrimingInput = NULL;
+		int Ok;
+		if(v == 0 && Worker->HaveState) {
+			Ok = Spectrice_Reinit(State, WindowType, PrimingInput, Snapshot);
+			Worker->HaveState = Ok;
+		} else {
+			Ok = Spectrice_Init(State, WindowType, PrimingInput, Snapshot);
+			if(v == 0) Worker->HaveState = Ok;
+		}
+		Variant->HaveState = Ok;
+		if(Ok && IsRange) {
+			int End = VarOpt->SnapshotEnd;
+			int Hop = VarOpt->SnapshotHop ? VarOpt->SnapshotHop : BlockSize/2;
+			if(End > (int)FileIn.nSamplePoints) End = FileIn.nSamplePoints;
+			Ok = CLI_CaptureSnapshot(State, Variant->OutBuffer, &FileIn, Variant->SnapshotPos, End, Hop, Opt->nThreads);
+			Spectrum = Variant->OutBuffer;
+		}
+		if(Ok && Spectrum) {
+			//! Apply gain (the spectra are linear in the input)
+			int n;
+			if(VarOpt->SnapshotGain != 1.0f) {
+				for(n=0;n<(BlockSize/2)*nChan;n++) Variant->OutBuffer[n] = Spectrum[n] * VarOpt->SnapshotGain;
+				Spectrum = Variant->OutBuffer;
+			}
+			Ok = Spectrice_SetSnapshotSpectrum(State, Spectrum);
+			if(Ok && !SharedAnalysis) Spectrice_Process(State, NULL, ReadBuffer);
+		}
+		if(!Ok) {
+			printf("ERROR: Unable to initialize processor.\n");
+			ExitCode = -1; goto Exit_FailInitSpectrice;
+		}
+	}
+	//! NOTE: The priming block is analyzed even with the cache, because the
+	//! cached block has the audio before it as history, rather than silence.
+	if(SharedAnalysis && !Resume) {
+		Spectrice_Analyze(Variants[0].State, SpectraBuffer, ReadBuffer);
+		for(v=0;v<nVariants;v++) Spectrice_Synthesize(Variants[v].State, NULL, SpectraBuffer);
+	}
+
+	//! Begin processing
+	struct Spectrice_t *State = Variants[0].State;
+	struct Spectrice_Stats_t StageStats;
+	memset(&StageStats, 0, sizeof(StageStats));
+
+	//! When stats are built in, also sample hardware counters (if there
+	//! are any) for the states processed on this thread
+	struct Perf_t Perf;
+	int HavePerf = 0;
+	if(!Opt->Quiet && Spectrice_SetStatsCounters(State, NULL, NULL, 0)) {
+		HavePerf = 1;
+		if(Perf_Open(&Perf)) {
+			for(v=0;v<nVariants;v++) Spectrice_SetStatsCounters(Variants[v].State, ReadPerfCounters, &Perf, PERF_COUNTER_COUNT);
+		}
+	}
+
+	//! When recording a timeline, also record the stages of every hop
+	//! (again, only when stats are built in)
+	if(Trace_Enabled) {
+		for(v=0;v<nVariants;v++) Spectrice_SetStatsStageFunc(Variants[v].State, TraceStage, NULL);
+	}
+
+	//! Write telemetry for the first variant?
+	struct CLI_Telemetry_t Telemetry;
+	struct CLI_SpectrumDump_t Dump;
+	int HaveTelemetry = 0;
+	int HaveDump = 0;
+	if(Opt->TelemetryFile) {
+		if(!CLI_Telemetry_Open(&Telemetry, Opt->TelemetryFile, nChan, BlockSize, ProcStart - OutputBeg)) {
+			ExitCode = -1; goto Exit_FailRender;
+		}
+		HaveTelemetry = 1;
+		Spectrice_SetTelemetry(State, Telemetry.Chans);
+	}
+	int nSamplesRem = OutputEnd - ProcStart;
+	int Block, nBlocks = (nSamplesRem - 1) / BlockSize + 1;
+	Block = Resume ? Ckpt.Block : 0;
+
+	//! Dump the spectra of the first variant?
+	if(Opt->DumpFile) {
+		uint32_t Position = ProcStart - OutputBeg + (uint32_t)Block*BlockSize;
+		if(!CLI_SpectrumDump_Open(&Dump, Opt->DumpFile, Opt->DumpFormat, Opt->DumpPhase, State, FileIn.fmt->nSamplesPerSec, Position)) {
+			ExitCode = -1; goto Exit_FailRender;
+		}
+		HaveDump = 1;
+		Spectrice_SetSpectrumFunc(State, CLI_SpectrumDump_Capture, &Dump);
+	}
+
+	//! NOTE: Phase steps need the hop before them, which segments don't
+	//! have, so dumping those means rendering everything in sequence.
+	int CanSegment = (Opt->nThreads != 1 && !SharedAnalysis && !(HaveDump && Opt->DumpPhase));
+	int FrozenBlockIdx = CanSegment ? Spectrice_GetFrozenBlockIdx(State) : -1;
+	time_t NextCheckpointTime = time(NULL) + Opt->CheckpointInterval;
+	struct CLI_Progress_t Progress;
+	CLI_Progress_Init(&Progress, Opt->Quiet);
+	if(Resume) nSamplesRem = Ckpt.nSamplesRem;
+	for(;Block<nBlocks;Block++) {
+		//! Once the freezing state stops changing, render the rest of the
+		//! file in parallel segments (if it's long enough to be worth it)
+		if(FrozenBlockIdx >= 0 && State->BlockIdx > FrozenBlockIdx && nBlocks-Block >= SEGMENTED_MIN_BLOCKS) {
+			if(CheckpointFile) {
+				Ckpt.ProcStart       = ProcStart;
+				Ckpt.nOutputSmpTotal = nOutputSmpTotal;
+			}
+			if(CLI_RenderSegments(
+				State, &Stream, &Variants[0].FileOut, PrevBuffer, nSamplesRem, Opt->nThreads, &Progress, Block, nBlocks, &StageStats,
+				HaveTelemetry ? &Telemetry : NULL, HaveDump ? &Dump : NULL,
+				CheckpointFile, Opt->CheckpointInterval, &Ckpt
+			) < 0) {
+				ExitCode = -1; goto Exit_FailRender;
+			}
+			nOutputSmpTotal += nSamplesRem;
+			break;
+		}
+		CLI_Progress_Update(&Progress, Block, nBlocks);
+
+		int nOutputSmp = nSamplesRem;
+		if(nOutputSmp > BlockSize) nOutputSmp = BlockSize;
+		nSamplesRem -= nOutputSmp;
+		uint64_t nClipped = Variants[0].FileOut.nClipped;
+		if(HaveTelemetry) CLI_Telemetry_Clear(Telemetry.Chans, nChan);
+
+		//! Shift the last block into history, then read the next one
+		//! NOTE: This is still needed with cached analysis, as checkpoints
+		//! save the input position and history.
+		uint64_t TraceTime = Trace_Begin();
+		memcpy(PrevBuffer, ReadBuffer, sizeof(float) * BlockSize*nChan);
+		CLI_ReadStream(&Stream, ReadBuffer, nOutputSmp, BlockSize);
+		Trace_End("Read", TraceTime, "block", Block);
+		if(UseCache) {
+			//! Only synthesis is needed with cached analysis
+			const float *Spectra = Cache.Spectra + (size_t)(ProcStart / BlockSize + 1 + Block) * Cache.BlockFloats;
+			if(HaveTelemetry) CLI_Telemetry_AddInput(Telemetry.Chans, ReadBuffer, nChan, BlockSize);
+			TraceTime = Trace_Begin();
+			for(v=0;v<nVariants;v++) Spectrice_Synthesize(Variants[v].State, Variants[v].OutBuffer, Spectra);
+			Trace_End("Process", TraceTime, "block", Block);
+		} else {
+			TraceTime = Trace_Begin();
+			if(SharedAnalysis) {
+				//! Analyze once, then synthesize every variant from that
+				Spectrice_Analyze(State, SpectraBuffer, ReadBuffer);
+				for(v=0;v<nVariants;v++) Spectrice_Synthesize(Variants[v].State, Variants[v].OutBuffer, SpectraBuffer);
+			} else {
+				Spectrice_Process(State, Variants[0].OutBuffer, ReadBuffer);
+			}
+			Trace_End("Process", TraceTime, "block", Block);
+		}
+		TraceTime = Trace_Begin();
+		for(v=0;v<nVariants;v++) WAV_WriteFromFloat(&Variants[v].FileOut, Variants[v].OutBuffer, nOutputSmp);
+		Trace_End("Write", TraceTime, "block", Block);
+		nOutputSmpTotal += nOutputSmp;
+		if(HaveTelemetry) CLI_Telemetry_Write(&Telemetry, Block, Telemetry.Chans, Variants[0].FileOut.nClipped - nClipped);
+		if(HaveDump) CLI_SpectrumDump_Write(&Dump, Dump.Frames, 1);
+
+		//! Save a checkpoint every so often
+		//! NOTE: The output must reach the file before the checkpoint that
+		//! refers to it. Anything written after the checkpoint is cut off
+		//! again when resuming.
+		if(CheckpointFile && Block+1 < nBlocks && time(NULL) >= NextCheckpointTime) {
+			//! With cached analysis, the state hasn't seen any input since
+			//! priming, so bring its analysis side up to date first; the
+			//! checkpoint may be resumed without the cache.
+			if(UseCache) Spectrice_Analyze(State, SpectraBuffer, ReadBuffer);
+			WAV_Flush(&Variants[0].FileOut);
+			Ckpt.ProcStart       = ProcStart;
+			Ckpt.Block           = Block+1;
+			Ckpt.nSamplesRem     = nSamplesRem;
+			Ckpt.nOutputSmpTotal = nOutputSmpTotal;
+			Ckpt.InputPosition   = FileIn.SamplePosition;
+			Ckpt.nLoopSamplesRem = Stream.nLoopSamplesRem;
+			CLI_Checkpoint_Save(CheckpointFile, &Ckpt, PrevBuffer, State);
+			NextCheckpointTime = time(NULL) + Opt->CheckpointInterval;
+		}
+	}
+	CLI_Progress_Finish(&Progress, nBlocks);
+
+	//! Stage timings are only available when built with SPECTRICE_STATS
+	int HaveStageStats = 1;
+	for(v=0;v<nVariants;v++) HaveStageStats &= Spectrice_GetStats(Variants[v].State, &StageStats);
+	uint64_t nClippedTotal = 0;
+	for(v=0;v<nVariants;v++) nClippedTotal += Variants[v].FileOut.nClipped;
+	if(!Opt->Quiet) {
+		printf("\nOk.");
+		if(nClippedTotal) printf("\nWARNING: %llu samples were clipped.", (unsigned long long)nClippedTotal);
+		if(HaveStageStats) PrintStageStats(&StageStats, HavePerf ? &Perf : NULL);
+	}
+
+	//! The job is done, so there's nothing left to resume
+	if(CheckpointFile) remove(CheckpointFile);
+
+	//! Store statistics
+	//! NOTE: nDataBytes only counts what was actually read (including any
+	//! freeze point search and analysis cache build), not the file size.
+	if(Stats) {
+		Stats->nChan               = nChan;
+		Stats->SampleRate          = FileIn.fmt->nSamplesPerSec;
+		Stats->nInputSamplePoints  = FileIn.nSamplePoints;
+		Stats->nOutputSamplePoints = nOutputSmpTotal;
+		Stats->CacheHit            = 0;
+		Stats->nBytesRead          = FileIn.nDataBytes;
+		Stats->nBytesWritten       = 0;
+		for(v=0;v<nVariants;v++) Stats->nBytesWritten += Variants[v].FileOut.nDataBytes;
+		Stats->nClipped            = nClippedTotal;
+		Stats->HaveStageStats      = HaveStageStats;
+		Stats->StageStats          = StageStats;
+	}
+
+	//! Exit points
+Exit_FailRender:
+	if(HavePerf) {
+		for(v=0;v<nVariants;v++) Spectrice_SetStatsCounters(Variants[v].State, NULL, NULL, 0);
+		Perf_Close(&Perf);
+	}
+	for(v=0;v<nVariants;v++) Spectrice_SetStatsStageFunc(Variants[v].State, NULL, NULL);
+	if(HaveTelemetry) {
+		Spectrice_SetTelemetry(State, NULL);
+		CLI_Telemetry_Close(&Telemetry);
+	}
+	if(HaveDump) {
+		Spectrice_SetSpectrumFunc(State, NULL, NULL);
+		if(!CLI_SpectrumDump_Close(&Dump)) printf("\nWARNING: Unable to write spectrum dump (%s).\n", Opt->DumpFile);
+	}
+Exit_FailInitSpectrice:
+	for(v=1;v<nVariants;v++) if(Variants[v].HaveState) Spectrice_Destroy(Variants[v].State);
+	for(v=0;v<nVariants;v++) MapFile_Close(&Variants[v].BankMap);
+Exit_FailCreateAllocBuffer:
+Exit_FailCreateOutFile:
+	for(v=0;v<nVariants;v++) if(Variants[v].HaveFile) CloseOutputFile(&Variants[v].FileOut);
+	if(Resume) CLI_Checkpoint_Close(&Ckpt);
+	if(UseCache) CLI_AnalysisCache_Close(&Cache);
+Exit_FailGetFreezePoint:
+	free(Variants);
+Exit_FailFileLength:
+	WAV_Close(&FileIn);
+Exit_FailOpenInFile:
+	return ExitCode;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
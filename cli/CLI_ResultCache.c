@@ -0,0 +1,149 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+# include <direct.h>
+# include <process.h>
+# define getpid _getpid
+# define mkdir(Path, Mode) _mkdir(Path)
+#else
+# include <unistd.h>
+# include <sys/stat.h>
+#endif
+#ifdef __linux__
+# include <fcntl.h>
+# include <sys/ioctl.h>
+# include <linux/fs.h>
+#endif
+/**************************************/
+#include "CLI.h"
+#include "Hash.h"
+/**************************************/
+#define COPY_CHUNK_SIZE (1024*1024)
+/**************************************/
+
+//! Copy a file, sharing its data blocks (reflink) where the filesystem
+//! supports it
+static int CopyFileData(const char *SrcFilename, const char *DstFilename) {
+	int Ok = 0;
+#ifdef __linux__
+	{
+		int Src = open(SrcFilename, O_RDONLY);
+		if(Src < 0) return 0;
+		int Dst = open(DstFilename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		if(Dst < 0) {
+			close(Src);
+			return 0;
+		}
+		Ok = (ioctl(Dst, FICLONE, Src) == 0);
+		close(Dst);
+		close(Src);
+		if(Ok) return 1;
+	}
+#endif
+	FILE *Src = fopen(SrcFilename, "rb");
+	if(!Src) return 0;
+	FILE *Dst = fopen(DstFilename, "wb");
+	char *Buf = malloc(COPY_CHUNK_SIZE);
+	if(Dst && Buf) {
+		size_t Size;
+		Ok = 1;
+		while((Size = fread(Buf, 1, COPY_CHUNK_SIZE, Src)) > 0) {
+			if(fwrite(Buf, 1, Size, Dst) != Size) {
+				Ok = 0;
+				break;
+			}
+		}
+		if(ferror(Src)) Ok = 0;
+	}
+	free(Buf);
+	if(Dst && fclose(Dst) != 0) Ok = 0;
+	fclose(Src);
+	return Ok;
+}
+
+//! Fill out stats from input and output files
+static void GetStats(struct CLI_RenderStats_t *Stats, const char *InFilename, const char *OutFilename) {
+	struct WAV_State_t File;
+	memset(Stats, 0, sizeof(struct CLI_RenderStats_t));
+	if(WAV_OpenR(&File, InFilename) >= 0) {
+		Stats->nInputSamplePoints = File.nSamplePoints;
+		WAV_Close(&File);
+	}
+	if(WAV_OpenR(&File, OutFilename) >= 0) {
+		Stats->nChan               = File.fmt->nChannels;
+		Stats->SampleRate          = File.fmt->nSamplesPerSec;
+		Stats->nOutputSamplePoints = File.nSamplePoints;
+		WAV_Close(&File);
+	}
+	Stats->CacheHit = 1;
+}
+
+/**************************************/
+
+int CLI_ResultCache_Render(
+	struct CLI_Worker_t *Worker,
+	const char *InFilename,
+	const char *OutFilename,
+	const struct CLI_Options_t *Opt,
+	struct CLI_RenderStats_t *Stats
+) {
+	int ExitCode;
+	const char *CacheDir = Opt->ResultCacheDir;
+
+	//! Get the key for this result
+	//! NOTE: We hash the whole input file rather than just the audio data,
+	//! as all the other chunks (including loop points) go into the output.
+	char CacheFilename[4096];
+	{
+		uint64_t Hash = HASH_FNV1A64_INIT;
+		int Version = SPECTRICE_VERSION;
+		Hash = Hash_FNV1a64(Hash, &Version, sizeof(Version));
+		Hash = CLI_HashOptions(Hash, Opt);
+		if(Opt->SnapshotName && Opt->SnapshotBank && !Hash_FNV1a64File(&Hash, Opt->SnapshotBank)) {
+			//! Let the renderer report the problem
+			return CLI_RenderVariants(Worker, InFilename, &OutFilename, Opt, 1, Stats);
+		}
+		if(!Hash_FNV1a64File(&Hash, InFilename)) {
+			//! Let the renderer report the problem
+			return CLI_RenderVariants(Worker, InFilename, &OutFilename, Opt, 1, Stats);
+		}
+		snprintf(CacheFilename, sizeof(CacheFilename), "%s/%016llx.wav", CacheDir, (unsigned long long)Hash);
+	}
+
+	//! Try to use a cached result
+	//! NOTE: Telemetry and spectrum dumps come from the processing itself, so
+	//! when either is asked for, we always render (but still store the result).
+	int WantsProcessing = (Opt->TelemetryFile || Opt->DumpFile);
+	if(!WantsProcessing && CopyFileData(CacheFilename, OutFilename)) {
+		if(!Opt->Quiet) printf("Using cached result (%s).\n", CacheFilename);
+		if(Stats) GetStats(Stats, InFilename, OutFilename);
+		return 0;
+	}
+
+	//! Render as normal, then publish the result
+	//! NOTE: We copy to a temporary file and rename it into place, so that
+	//! concurrent workers never see a partial file. If two workers render
+	//! the same result at once, the last one to finish just replaces it.
+	ExitCode = CLI_RenderVariants(Worker, InFilename, &OutFilename, Opt, 1, Stats);
+	if(ExitCode == 0) {
+		char TempFilename[4096 + 64];
+		snprintf(TempFilename, sizeof(TempFilename), "%s.%d.%p.tmp", CacheFilename, (int)getpid(), (void*)Worker);
+		mkdir(CacheDir, 0777); //! Ignore errors; CopyFileData() will fail
+		if(!CopyFileData(OutFilename, TempFilename) || !MapFile_Rename(TempFilename, CacheFilename)) {
+			printf("WARNING: Unable to store result in cache (%s).\n", CacheFilename);
+			remove(TempFilename);
+		}
+	}
+	return ExitCode;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
@@ -0,0 +1,163 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+# include <windows.h>
+# include <psapi.h>
+#else
+# include <sys/resource.h>
+#endif
+/**************************************/
+#include "CLI.h"
+/**************************************/
+
+static double GetWallTime(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1.0e-9;
+}
+
+//! Get CPU time (user + system) used by all threads of the process
+static double GetCPUTime(void) {
+#ifdef _WIN32
+	FILETIME Creation, Exit, Kernel, User;
+	if(!GetProcessTimes(GetCurrentProcess(), &Creation, &Exit, &Kernel, &User)) return 0.0;
+	ULARGE_INTEGER k = { .u = { Kernel.dwLowDateTime, Kernel.dwHighDateTime } };
+	ULARGE_INTEGER u = { .u = { User  .dwLowDateTime, User  .dwHighDateTime } };
+	return (k.QuadPart + u.QuadPart) * 1.0e-7;
+#else
+	struct rusage Usage;
+	if(getrusage(RUSAGE_SELF, &Usage) != 0) return 0.0;
+	return Usage.ru_utime.tv_sec + Usage.ru_utime.tv_usec*1.0e-6 +
+	       Usage.ru_stime.tv_sec + Usage.ru_stime.tv_usec*1.0e-6;
+#endif
+}
+
+//! Get peak resident set size in bytes (0 = unknown)
+static uint64_t GetPeakRSS(void) {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS Counters;
+	if(!K32GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters))) return 0;
+	return Counters.PeakWorkingSetSize;
+#else
+	struct rusage Usage;
+	if(getrusage(RUSAGE_SELF, &Usage) != 0) return 0;
+# ifdef __APPLE__
+	return (uint64_t)Usage.ru_maxrss;
+# else
+	return (uint64_t)Usage.ru_maxrss * 1024;
+# endif
+#endif
+}
+
+/**************************************/
+
+void CLI_RunStats_Begin(struct CLI_RunStats_t *Run, int nThreads) {
+	memset(Run, 0, sizeof(struct CLI_RunStats_t));
+	Run->StartWallTime  = GetWallTime();
+	Run->StartCPUTime   = GetCPUTime();
+	Run->nThreads       = nThreads;
+	Run->HaveStageStats = 1;
+}
+
+void CLI_RunStats_Add(struct CLI_RunStats_t *Run, const struct CLI_RenderStats_t *Stats, int ExitCode) {
+	int Stage;
+	Run->nFiles++;
+	if(ExitCode || !Stats) {
+		Run->nFailed++;
+		return;
+	}
+	Run->nCacheHits          += Stats->CacheHit;
+	Run->nInputSamplePoints  += Stats->nInputSamplePoints;
+	Run->nOutputSamplePoints += Stats->nOutputSamplePoints;
+	Run->nOutputSamples      += (uint64_t)Stats->nOutputSamplePoints * Stats->nChan;
+	Run->nBytesRead          += Stats->nBytesRead;
+	Run->nBytesWritten       += Stats->nBytesWritten;
+	Run->nClipped            += Stats->nClipped;
+	if(Stats->SampleRate) Run->AudioTime += (double)Stats->nOutputSamplePoints / Stats->SampleRate;
+
+	//! Cached results weren't processed, so have nothing to add here
+	if(Stats->CacheHit) return;
+	if(!Stats->HaveStageStats) {
+		Run->HaveStageStats = 0;
+		return;
+	}
+	Run->StageStats.nHops += Stats->StageStats.nHops;
+	for(Stage=0;Stage<SPECTRICE_STAGE_COUNT;Stage++) Run->StageStats.Time[Stage] += Stats->StageStats.Time[Stage];
+}
+
+/**************************************/
+
+int CLI_RunStats_Write(const struct CLI_RunStats_t *Run, const char *Filename) {
+	double WallTime = GetWallTime() - Run->StartWallTime;
+	double CPUTime  = GetCPUTime()  - Run->StartCPUTime;
+
+	FILE *File = fopen(Filename, "w");
+	if(!File) return 0;
+	fprintf(
+		File,
+		"{\n"
+		" \"version\": %d,\n"
+		" \"simd\": \"%s\",\n"
+		" \"threads\": %d,\n"
+		" \"files\": %d, \"failed\": %d, \"cache_hits\": %d,\n"
+		" \"wall_time\": %.6f,\n"
+		" \"cpu_time\": %.6f,\n"
+		" \"audio_time\": %.6f,\n"
+		" \"realtime_factor\": %.3f,\n"
+		" \"input_sample_points\": %llu,\n"
+		" \"output_sample_points\": %llu,\n"
+		" \"output_samples\": %llu,\n"
+		" \"bytes_read\": %llu,\n"
+		" \"bytes_written\": %llu,\n"
+		" \"clipped\": %llu,\n"
+		" \"peak_rss\": %llu,\n",
+		SPECTRICE_VERSION,
+		Spectrice_GetSIMDName(),
+		Run->nThreads,
+		Run->nFiles, Run->nFailed, Run->nCacheHits,
+		WallTime,
+		CPUTime,
+		Run->AudioTime,
+		(WallTime > 0.0) ? (Run->AudioTime / WallTime) : 0.0,
+		(unsigned long long)Run->nInputSamplePoints,
+		(unsigned long long)Run->nOutputSamplePoints,
+		(unsigned long long)Run->nOutputSamples,
+		(unsigned long long)Run->nBytesRead,
+		(unsigned long long)Run->nBytesWritten,
+		(unsigned long long)Run->nClipped,
+		(unsigned long long)GetPeakRSS()
+	);
+
+	//! Stage timings (only when built with SPECTRICE_STATS)
+	if(Run->HaveStageStats && Run->nFiles > Run->nFailed + Run->nCacheHits) {
+		int Stage;
+		const struct Spectrice_Stats_t *Stats = &Run->StageStats;
+		fprintf(File, " \"hops\": %llu,\n \"stages\": {", (unsigned long long)Stats->nHops);
+		for(Stage=0;Stage<SPECTRICE_STAGE_COUNT;Stage++) {
+			fprintf(
+				File, "%s\n  \"%s\": { \"time\": %.6f, \"ns_per_hop\": %.1f }",
+				Stage ? "," : "",
+				Spectrice_GetStageName(Stage),
+				Stats->Time[Stage],
+				Stats->nHops ? (Stats->Time[Stage] * 1.0e9 / Stats->nHops) : 0.0
+			);
+		}
+		fprintf(File, "\n }\n}\n");
+	} else {
+		fprintf(File, " \"stages\": null\n}\n");
+	}
+
+	int Ok = !ferror(File);
+	if(fclose(File) != 0) Ok = 0;
+	return Ok;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
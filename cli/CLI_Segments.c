@@ -0,0 +1,241 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+/**************************************/
+#include "CLI.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+/**************************************/
+
+//! Memory budget for each window of segments (input + output)
+#define WINDOW_MEMORY_BUDGET (64*1024*1024)
+
+//! Limits on blocks per segment
+//! Each segment costs one extra block of processing for priming, so we
+//! don't want segments too short, but they also shouldn't be so long that
+//! the last segment of a window keeps everyone else waiting.
+#define MIN_SEGMENT_BLOCKS  4
+#define MAX_SEGMENT_BLOCKS 64
+
+/**************************************/
+
+//! Segment task
+struct SegmentTask_t {
+	const struct Spectrice_t *State;
+	int    BlockIdx;     //! Block index of the first block to output
+	int    nBlocks;
+	const float *Input;  //! Input, starting two blocks before BlockIdx
+	float *Output;
+	int    Error;
+	struct Spectrice_Stats_t Stats;
+	struct Spectrice_Telemetry_t *Telemetry; //! [nBlocks][nChan] (NULL = none)
+	const struct CLI_SpectrumDump_t *Dump;   //! NULL = none
+	uint8_t *Spectra;    //! [nBlocks][nHops][Dump->FrameSize]
+};
+
+//! WorkerIdx = -1 when run on the calling thread
+static void SegmentTask(void *User, int WorkerIdx) {
+	struct SegmentTask_t *Task = (struct SegmentTask_t*)User;
+	if(Trace_Enabled && WorkerIdx >= 0) Trace_SetThreadName("Worker %d", WorkerIdx);
+	uint64_t TraceTime = Trace_Begin();
+	struct Spectrice_t State;
+	if(!Spectrice_Fork(&State, Task->State, Task->BlockIdx, Task->Input)) {
+		Task->Error = 1;
+		return;
+	}
+
+	//! Spectra are captured into this task's part of the window
+	struct CLI_SpectrumDump_t Dump;
+	if(Task->Dump) {
+		Dump = *Task->Dump;
+		Spectrice_SetSpectrumFunc(&State, CLI_SpectrumDump_Capture, &Dump);
+	}
+
+	int Block;
+	int BlockFloats = State.BlockSize * State.nChan;
+	for(Block=0;Block<Task->nBlocks;Block++) {
+		if(Task->Dump) Dump.Frames = Task->Spectra + (size_t)Block*State.nHops*Dump.FrameSize;
+		if(Task->Telemetry) {
+			struct Spectrice_Telemetry_t *Telemetry = Task->Telemetry + Block*State.nChan;
+			CLI_Telemetry_Clear(Telemetry, State.nChan);
+			Spectrice_SetTelemetry(&State, Telemetry);
+		}
+		Spectrice_Process(
+			&State,
+			Task->Output + Block*BlockFloats,
+			Task->Input  + (Block+2)*BlockFloats
+		);
+	}
+	Spectrice_GetStats(&State, &Task->Stats);
+	Spectrice_Destroy(&State);
+	Task->Error = 0;
+	Trace_End("Segment", TraceTime, "block", Task->BlockIdx);
+}
+
+/**************************************/
+
+int CLI_RenderSegments(
+	const struct Spectrice_t *State,
+	struct CLI_InputStream_t *Stream,
+	struct WAV_State_t *FileOut,
+	const float *History,
+	int nSamplesRem,
+	int nThreads,
+	struct CLI_Progress_t *Progress,
+	int BlockBase,
+	int nBlocksTotal,
+	struct Spectrice_Stats_t *Stats,
+	struct CLI_Telemetry_t *Telemetry,
+	struct CLI_SpectrumDump_t *Dump,
+	const char *CheckpointFile,
+	int CheckpointInterval,
+	struct CLI_Checkpoint_t *Ckpt
+) {
+	int n, Stage;
+	int ExitCode = 0;
+	int nChan       = State->nChan;
+	int BlockSize   = State->BlockSize;
+	int BlockFloats = BlockSize * nChan;
+	if(nThreads <= 0) nThreads = ThreadPool_GetCPUCount();
+
+	//! Decide on segment size, and allocate buffers for a whole window
+	int nSegments = nThreads;
+	int nSegmentBlocks = WINDOW_MEMORY_BUDGET / (int)(sizeof(float) * BlockFloats * 2) / nSegments;
+	if(nSegmentBlocks < MIN_SEGMENT_BLOCKS) nSegmentBlocks = MIN_SEGMENT_BLOCKS;
+	if(nSegmentBlocks > MAX_SEGMENT_BLOCKS) nSegmentBlocks = MAX_SEGMENT_BLOCKS;
+	int nWindowBlocksMax = nSegments * nSegmentBlocks;
+	float *InBuf  = malloc(sizeof(float) * BlockFloats * (2 + nWindowBlocksMax));
+	float *OutBuf = malloc(sizeof(float) * BlockFloats * nWindowBlocksMax);
+	struct SegmentTask_t *Tasks = malloc(sizeof(struct SegmentTask_t) * nSegments);
+	struct Spectrice_Telemetry_t *TelemetryBuf = NULL;
+	if(Telemetry) TelemetryBuf = malloc(sizeof(struct Spectrice_Telemetry_t) * nChan * nWindowBlocksMax);
+	size_t SpectraBlockSize = Dump ? (Dump->FrameSize * State->nHops) : 0;
+	uint8_t *SpectraBuf = NULL;
+	if(Dump) SpectraBuf = malloc(SpectraBlockSize * nWindowBlocksMax);
+	if(!InBuf || !OutBuf || !Tasks || (Telemetry && !TelemetryBuf) || (Dump && !SpectraBuf)) {
+		printf("ERROR: Couldn't allocate segment buffers.\n");
+		ExitCode = -1; goto Exit_FailAlloc;
+	}
+	struct ThreadPool_t Pool;
+	if(!ThreadPool_Create(&Pool, nThreads)) {
+		printf("ERROR: Unable to create thread pool.\n");
+		ExitCode = -1; goto Exit_FailCreatePool;
+	}
+
+	//! Process window-by-window
+	int BlockIdx = State->BlockIdx;
+	int Block    = BlockBase;
+	time_t NextCheckpointTime = time(NULL) + CheckpointInterval;
+	memcpy(InBuf, History, sizeof(float) * BlockFloats * 2);
+	while(nSamplesRem > 0) {
+		if(Progress) CLI_Progress_Update(Progress, Block, nBlocksTotal);
+
+		//! Read the window
+		uint64_t TraceTime = Trace_Begin();
+		int nWindowBlocks = 0;
+		int nWindowSamples = 0;
+		while(nWindowBlocks < nWindowBlocksMax && nSamplesRem > 0) {
+			int nOutputSmp = nSamplesRem;
+			if(nOutputSmp > BlockSize) nOutputSmp = BlockSize;
+			nSamplesRem    -= nOutputSmp;
+			nWindowSamples += nOutputSmp;
+			CLI_ReadStream(Stream, InBuf + (2+nWindowBlocks)*BlockFloats, nOutputSmp, BlockSize);
+			nWindowBlocks++;
+		}
+		Trace_End("Read", TraceTime, "block", Block);
+
+		//! Spread blocks evenly over segments and dispatch
+		int nTasks = (nWindowBlocks + nSegmentBlocks-1) / nSegmentBlocks;
+		int SegBeg = 0;
+		for(n=0;n<nTasks;n++) {
+			int SegEnd = (nWindowBlocks * (n+1)) / nTasks;
+			struct SegmentTask_t *Task = &Tasks[n];
+			Task->State    = State;
+			Task->BlockIdx = BlockIdx + SegBeg;
+			Task->nBlocks  = SegEnd - SegBeg;
+			Task->Input    = InBuf  + SegBeg*BlockFloats;
+			Task->Output   = OutBuf + SegBeg*BlockFloats;
+			Task->Error    = 1;
+			Task->Telemetry = TelemetryBuf ? (TelemetryBuf + SegBeg*nChan) : NULL;
+			Task->Dump      = Dump;
+			Task->Spectra   = SpectraBuf ? (SpectraBuf + SegBeg*SpectraBlockSize) : NULL;
+			memset(&Task->Stats, 0, sizeof(Task->Stats));
+			if(!ThreadPool_Submit(&Pool, SegmentTask, Task)) SegmentTask(Task, -1);
+			if(Trace_Enabled) Trace_Counter("Queued tasks", ThreadPool_GetQueued(&Pool));
+			SegBeg = SegEnd;
+		}
+		ThreadPool_Wait(&Pool);
+		if(Trace_Enabled) Trace_Counter("Queued tasks", 0);
+		for(n=0;n<nTasks;n++) if(Tasks[n].Error) {
+			printf("\nERROR: Unable to fork processor for segment.\n");
+			ExitCode = -1; goto Exit_FailSegment;
+		}
+		if(Stats) for(n=0;n<nTasks;n++) {
+			Stats->nHops += Tasks[n].Stats.nHops;
+			for(Stage=0;Stage<SPECTRICE_STAGE_COUNT;Stage++) Stats->Time[Stage] += Tasks[n].Stats.Time[Stage];
+		}
+
+		//! Write output and keep the last two blocks for priming
+		//! With telemetry, each block is written separately to count the
+		//! samples that were clipped in it.
+		TraceTime = Trace_Begin();
+		if(Telemetry) {
+			int nSmpRem = nWindowSamples;
+			for(n=0;n<nWindowBlocks;n++) {
+				int N = (nSmpRem < BlockSize) ? nSmpRem : BlockSize;
+				uint64_t nClipped = FileOut->nClipped;
+				WAV_WriteFromFloat(FileOut, OutBuf + n*BlockFloats, N);
+				CLI_Telemetry_Write(Telemetry, Block+n, TelemetryBuf + n*nChan, FileOut->nClipped - nClipped);
+				nSmpRem -= N;
+			}
+		} else WAV_WriteFromFloat(FileOut, OutBuf, nWindowSamples);
+		if(Dump) CLI_SpectrumDump_Write(Dump, SpectraBuf, nWindowBlocks);
+		Trace_End("Write", TraceTime, "block", Block);
+		memmove(InBuf, InBuf + nWindowBlocks*BlockFloats, sizeof(float) * BlockFloats * 2);
+		BlockIdx += nWindowBlocks;
+		Block    += nWindowBlocks;
+
+		//! Save a checkpoint every so often
+		//! State itself is still back where segments began, so we save a
+		//! fork of it that is ready for the next block instead; this is
+		//! bit-exact with having processed everything in sequence.
+		if(CheckpointFile) {
+			Ckpt->nOutputSmpTotal += nWindowSamples;
+			if(nSamplesRem > 0 && time(NULL) >= NextCheckpointTime) {
+				struct Spectrice_t Fork;
+				WAV_Flush(FileOut);
+				Ckpt->Block           = Block;
+				Ckpt->nSamplesRem     = nSamplesRem;
+				Ckpt->InputPosition   = Stream->File->SamplePosition;
+				Ckpt->nLoopSamplesRem = Stream->nLoopSamplesRem;
+				if(Spectrice_Fork(&Fork, State, BlockIdx, InBuf)) {
+					CLI_Checkpoint_Save(CheckpointFile, Ckpt, InBuf, &Fork);
+					Spectrice_Destroy(&Fork);
+				} else printf("\nWARNING: Unable to write checkpoint (%s).\n", CheckpointFile);
+				NextCheckpointTime = time(NULL) + CheckpointInterval;
+			}
+		}
+	}
+
+	//! Exit points
+Exit_FailSegment:
+	ThreadPool_Destroy(&Pool);
+Exit_FailCreatePool:
+Exit_FailAlloc:
+	free(SpectraBuf);
+	free(TelemetryBuf);
+	free(Tasks);
+	free(OutBuf);
+	free(InBuf);
+	return ExitCode;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
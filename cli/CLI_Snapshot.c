@@ -0,0 +1,136 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+/**************************************/
+#include "CLI.h"
+#include "ThreadPool.h"
+/**************************************/
+
+//! Frames are split into at most this many tasks, each with its own power
+//! accumulator. The split only depends on the number of frames, so the
+//! result is the same for any number of threads.
+#define MAX_TASKS         64
+#define MIN_TASK_FRAMES    8
+
+//! Alignment of scratch buffers (matches the library)
+#define SCRATCH_ALIGNMENT 64
+
+/**************************************/
+
+//! Capture task
+struct CaptureTask_t {
+	const struct Spectrice_t *State;
+	const float *Input;   //! First frame of this task
+	int    nFrames;
+	int    Hop;
+	float *Power;         //! Power[nChan][BlockSize/2] (output)
+	float **Scratch;      //! Per-worker scratch buffers
+};
+
+static void CaptureTask(void *User, int WorkerIdx) {
+	struct CaptureTask_t *Task = (struct CaptureTask_t*)User;
+	const struct Spectrice_t *State = Task->State;
+	int f;
+	int nChan = State->nChan;
+	memset(Task->Power, 0, sizeof(float) * (State->BlockSize/2) * nChan);
+	for(f=0;f<Task->nFrames;f++) {
+		Spectrice_AccumulateSnapshotPower(State, Task->Power, Task->Input + f*Task->Hop*nChan, Task->Scratch[WorkerIdx]);
+	}
+}
+
+/**************************************/
+
+int CLI_CaptureSnapshot(
+	const struct Spectrice_t *State,
+	float *Abs,
+	struct WAV_State_t *File,
+	int Start,
+	int End,
+	int Hop,
+	int nThreads
+) {
+	int n, Task;
+	int ExitCode  = 1;
+	int nChan     = State->nChan;
+	int BlockSize = State->BlockSize;
+	int PowerSize = (BlockSize/2) * nChan;
+
+	//! Get frame count (always at least one frame)
+	int nFrames = (End - Start >= BlockSize) ? ((End - Start - BlockSize) / Hop + 1) : 1;
+	int nTasks  = nFrames / MIN_TASK_FRAMES;
+	if(nTasks < 1)         nTasks = 1;
+	if(nTasks > MAX_TASKS) nTasks = MAX_TASKS;
+	if(nThreads <= 0)      nThreads = ThreadPool_GetCPUCount();
+	if(nThreads > nTasks)  nThreads = nTasks;
+
+	//! Read the whole range at once, as the workers can't share the file
+	int nInputSmp = (nFrames-1)*Hop + BlockSize;
+	float  *Input   = malloc(sizeof(float) * nInputSmp * nChan);
+	float  *Power   = malloc(sizeof(float) * PowerSize * nTasks);
+	char   *ScratchData = malloc(SCRATCH_ALIGNMENT-1 + sizeof(float) * BlockSize*2 * nThreads);
+	float **Scratch = malloc(sizeof(float*) * nThreads);
+	struct CaptureTask_t *Tasks = malloc(sizeof(struct CaptureTask_t) * nTasks);
+	if(!Input || !Power || !ScratchData || !Scratch || !Tasks) {
+		printf("ERROR: Couldn't allocate snapshot buffers.\n");
+		ExitCode = 0; goto Exit;
+	}
+	{
+		char *Buf = ScratchData + ((-(uintptr_t)ScratchData) & (SCRATCH_ALIGNMENT-1));
+		for(n=0;n<nThreads;n++) Scratch[n] = (float*)Buf + n*BlockSize*2;
+	}
+	{
+		uint32_t OldPos = File->SamplePosition;
+		File->SamplePosition = Start;
+		WAV_ReadAsFloat(File, Input, nInputSmp);
+		File->SamplePosition = OldPos;
+	}
+
+	//! Spread frames evenly over tasks and dispatch
+	struct ThreadPool_t Pool;
+	int HavePool = (nThreads > 1) && ThreadPool_Create(&Pool, nThreads);
+	int FrameBeg = 0;
+	for(Task=0;Task<nTasks;Task++) {
+		int FrameEnd = (nFrames * (Task+1)) / nTasks;
+		struct CaptureTask_t *t = &Tasks[Task];
+		t->State   = State;
+		t->Input   = Input + FrameBeg*Hop*nChan;
+		t->nFrames = FrameEnd - FrameBeg;
+		t->Hop     = Hop;
+		t->Power   = Power + Task*PowerSize;
+		t->Scratch = Scratch;
+		if(!HavePool || !ThreadPool_Submit(&Pool, CaptureTask, t)) {
+			//! NOTE: Worker 0's scratch is free here only without a pool;
+			//! with a pool, wait for everything else to finish first.
+			if(HavePool) ThreadPool_Wait(&Pool);
+			CaptureTask(t, 0);
+		}
+		FrameBeg = FrameEnd;
+	}
+	if(HavePool) ThreadPool_Destroy(&Pool);
+
+	//! Combine in a fixed order, then get RMS magnitudes
+	memcpy(Abs, Power, sizeof(float) * PowerSize);
+	for(Task=1;Task<nTasks;Task++) {
+		const float *Src = Power + Task*PowerSize;
+		for(n=0;n<PowerSize;n++) Abs[n] += Src[n];
+	}
+	Spectrice_FinishSnapshotPower(State, Abs, nFrames);
+
+Exit:
+	free(Tasks);
+	free(Scratch);
+	free(ScratchData);
+	free(Power);
+	free(Input);
+	return ExitCode;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
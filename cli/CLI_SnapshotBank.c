@@ -0,0 +1,303 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+# include <process.h>
+# define getpid _getpid
+#else
+# include <unistd.h>
+#endif
+/**************************************/
+#include "CLI.h"
+/**************************************/
+#define MAX_LINE_LENGTH  4096
+#define MAX_LINE_TOKENS  64
+/**************************************/
+
+//! Snapshot bank layout:
+//!  BankHeader_t Header;
+//!  BankEntry_t  Entries[Header.nEntries];
+//!  float Spectra[]; //! Each entry is Abs[nChan][BlockSize/2], at Entry.DataOffs
+//! All spectra were made with the same block size, hops and window, and
+//! start on a BANK_DATA_ALIGNMENT boundary so they can be used as-is.
+#define BANK_MAGIC          "SPXB"
+#define BANK_VERSION        1
+#define BANK_NAME_LENGTH    56
+#define BANK_DATA_ALIGNMENT 64
+
+struct BankHeader_t {
+	char     Magic[4];
+	uint32_t Version;
+	uint32_t BlockSize;
+	uint32_t nHops;
+	uint32_t WindowType;
+	uint32_t nEntries;
+};
+
+struct BankEntry_t {
+	char     Name[BANK_NAME_LENGTH];
+	uint32_t nChan;
+	uint32_t Reserved;
+	uint64_t DataOffs;
+};
+
+/**************************************/
+
+//! Capture the spectrum of one snapshot (averaged from Position to End when
+//! End >= 0, every Hop sample points)
+//! Returns the spectrum (to be freed by the caller), or NULL on failure.
+static float *AnalyzeSnapshot(int *nChanOut, const char *Filename, int Position, int End, int Hop, const struct CLI_Options_t *Opt) {
+	int BlockSize = Opt->BlockSize;
+	struct WAV_State_t File;
+	int Error = WAV_OpenR(&File, Filename);
+	if(Error < 0) {
+		printf("ERROR: Unable to open snapshot file (%s); error %s.\n", Filename, WAV_ErrorCodeToString(Error));
+		return NULL;
+	}
+	int nChan = File.fmt->nChannels;
+	float *Abs   = malloc(sizeof(float) * ((BlockSize/2)*nChan + BlockSize*nChan));
+	float *Block = Abs + (BlockSize/2)*nChan;
+	if(!Abs) {
+		printf("ERROR: Couldn't allocate snapshot buffer.\n");
+		goto Error;
+	}
+	if(Position < 0 || Position > (int)File.nSamplePoints - BlockSize) {
+		printf("ERROR: Snapshot position is past the last block (%s).\n", Filename);
+		goto Error;
+	}
+
+	//! Set up a state just for the window and scratch memory
+	struct Spectrice_t State;
+	if(!CLI_InitAnalysisState(&State, nChan, BlockSize, Opt->nHops, Opt->WindowType)) {
+		printf("ERROR: Unable to initialize analysis (%s).\n", Filename);
+		goto Error;
+	}
+	if(End >= 0) {
+		if(End > (int)File.nSamplePoints) End = File.nSamplePoints;
+		if(!CLI_CaptureSnapshot(&State, Abs, &File, Position, End, Hop ? Hop : BlockSize/2, Opt->nThreads)) {
+			Spectrice_Destroy(&State);
+			goto Error;
+		}
+	} else {
+		File.SamplePosition = Position;
+		WAV_ReadAsFloat(&File, Block, BlockSize);
+		Spectrice_GetSnapshotSpectrum(&State, Abs, Block);
+	}
+	Spectrice_Destroy(&State);
+	WAV_Close(&File);
+	*nChanOut = nChan;
+	return Abs;
+
+Error:
+	free(Abs);
+	WAV_Close(&File);
+	return NULL;
+}
+
+//! Read the next entry from the snapshot list
+//! Returns the number of tokens, 0 at the end of the list, or -1 on error.
+static int ReadListLine(FILE *List, int *LineIdx, char *Line, char **Tokens) {
+	while(fgets(Line, MAX_LINE_LENGTH, List)) {
+		(*LineIdx)++;
+		int nTokens = CLI_TokenizeLine(Line, Tokens, MAX_LINE_TOKENS);
+		if(nTokens == 0) continue;
+		if(nTokens < 2 || nTokens > 3) {
+			printf("ERROR: Snapshot list line %d: Expected a name, a file, and optionally a position.\n", *LineIdx);
+			return -1;
+		}
+		if(strlen(Tokens[0]) >= BANK_NAME_LENGTH) {
+			printf("ERROR: Snapshot list line %d: Name is too long (maximum is %d characters).\n", *LineIdx, BANK_NAME_LENGTH-1);
+			return -1;
+		}
+		return nTokens;
+	}
+	return 0;
+}
+
+int CLI_SnapshotBank_Build(const char *BankFilename, const char *ListFilename, const struct CLI_Options_t *Opt) {
+	int n;
+	int ExitCode = 0;
+	int BlockSize = Opt->BlockSize;
+	char TempFilename[4096 + 64];
+	snprintf(TempFilename, sizeof(TempFilename), "%s.%d.tmp", BankFilename, (int)getpid());
+
+	//! Count the entries first, so that the spectra can be written straight
+	//! after the table; the table itself is written last.
+	int   LineIdx = 0, nTokens, nEntries = 0;
+	char  Line[MAX_LINE_LENGTH];
+	char *Tokens[MAX_LINE_TOKENS];
+	struct BankEntry_t *Entries = NULL;
+	FILE *Bank = NULL;
+	FILE *List = fopen(ListFilename, "r");
+	if(!List) {
+		printf("ERROR: Unable to open snapshot list (%s).\n", ListFilename);
+		return -1;
+	}
+	while((nTokens = ReadListLine(List, &LineIdx, Line, Tokens)) > 0) nEntries++;
+	if(nTokens < 0) {
+		ExitCode = -1; goto Exit;
+	}
+	if(nEntries == 0) {
+		printf("ERROR: No snapshots to store.\n");
+		ExitCode = -1; goto Exit;
+	}
+	Entries = calloc(nEntries, sizeof(struct BankEntry_t));
+	Bank    = fopen(TempFilename, "wb");
+	if(!Entries || !Bank) {
+		printf("ERROR: Unable to create snapshot bank (%s).\n", BankFilename);
+		ExitCode = -1; goto Exit;
+	}
+
+	//! Analyze and store each snapshot
+	//! NOTE: (BlockSize/2)*sizeof(float) is always a multiple of
+	//! BANK_DATA_ALIGNMENT, so every entry stays aligned.
+	uint64_t TableSize = sizeof(struct BankHeader_t) + nEntries*sizeof(struct BankEntry_t);
+	uint64_t DataOffs  = (TableSize + BANK_DATA_ALIGNMENT-1) & ~(uint64_t)(BANK_DATA_ALIGNMENT-1);
+	fseek(Bank, DataOffs, SEEK_SET);
+	rewind(List);
+	LineIdx = 0;
+	for(n=0;n<nEntries;n++) {
+		//! NOTE: The list was already checked in the first pass.
+		nTokens = ReadListLine(List, &LineIdx, Line, Tokens);
+		if(nTokens <= 0) {
+			printf("ERROR: Snapshot list changed while reading (%s).\n", ListFilename);
+			ExitCode = -1; goto Exit;
+		}
+		int i;
+		for(i=0;i<n;i++) if(!strcmp(Entries[i].Name, Tokens[0])) break;
+		if(i < n) {
+			printf("ERROR: Snapshot list line %d: Duplicate name (%s).\n", LineIdx, Tokens[0]);
+			ExitCode = -1; goto Exit;
+		}
+
+		int nChan;
+		int Position = 0, End = -1, Hop = 0;
+		if(nTokens > 2) sscanf(Tokens[2], "%d,%d,%d", &Position, &End, &Hop);
+		if(Hop < 0 || (End >= 0 && End <= Position)) {
+			printf("ERROR: Snapshot list line %d: Invalid snapshot range (%s).\n", LineIdx, Tokens[2]);
+			ExitCode = -1; goto Exit;
+		}
+		float *Abs = AnalyzeSnapshot(&nChan, Tokens[1], Position, End, Hop, Opt);
+		if(!Abs) {
+			ExitCode = -1; goto Exit;
+		}
+		struct BankEntry_t *Entry = &Entries[n];
+		strcpy(Entry->Name, Tokens[0]);
+		Entry->nChan    = nChan;
+		Entry->DataOffs = DataOffs;
+		size_t Size = sizeof(float) * (BlockSize/2) * nChan;
+		int Ok = (fwrite(Abs, Size, 1, Bank) == 1);
+		free(Abs);
+		if(!Ok) {
+			printf("ERROR: Unable to write snapshot bank (%s).\n", BankFilename);
+			ExitCode = -1; goto Exit;
+		}
+		DataOffs += Size;
+		if(!Opt->Quiet) printf("Added snapshot %s (%s @ %d, %d channels).\n", Entry->Name, Tokens[1], Position, nChan);
+	}
+
+	//! Write header and table, then put the file in place
+	{
+		struct BankHeader_t Header;
+		memset(&Header, 0, sizeof(Header));
+		memcpy(Header.Magic, BANK_MAGIC, 4);
+		Header.Version    = BANK_VERSION;
+		Header.BlockSize  = BlockSize;
+		Header.nHops      = Opt->nHops;
+		Header.WindowType = Opt->WindowType;
+		Header.nEntries   = nEntries;
+		fseek(Bank, 0, SEEK_SET);
+		int Ok = (
+			fwrite(&Header, sizeof(Header), 1, Bank) == 1 &&
+			fwrite(Entries, sizeof(struct BankEntry_t), nEntries, Bank) == (size_t)nEntries
+		);
+		if(fclose(Bank) != 0) Ok = 0;
+		Bank = NULL;
+		if(Ok) Ok = MapFile_Rename(TempFilename, BankFilename);
+		if(!Ok) {
+			printf("ERROR: Unable to write snapshot bank (%s).\n", BankFilename);
+			ExitCode = -1; goto Exit;
+		}
+		printf("Stored %d snapshots in %s.\n", nEntries, BankFilename);
+	}
+
+Exit:
+	if(Bank) fclose(Bank);
+	if(ExitCode) remove(TempFilename);
+	fclose(List);
+	free(Entries);
+	return ExitCode;
+}
+
+/**************************************/
+
+const float *CLI_SnapshotBank_Open(
+	struct MapFile_t *Map,
+	const char *Filename,
+	const char *Name,
+	int nChan,
+	int BlockSize,
+	int nHops,
+	int WindowType
+) {
+	if(!Filename) {
+		printf("ERROR: Snapshot %s needs a snapshot bank (-snapshotbank).\n", Name);
+		return NULL;
+	}
+	if(!MapFile_Open(Map, Filename)) {
+		printf("ERROR: Unable to open snapshot bank (%s).\n", Filename);
+		return NULL;
+	}
+
+	//! Check header
+	const struct BankHeader_t *Header = (const struct BankHeader_t*)Map->Data;
+	if(
+		Map->Size < sizeof(struct BankHeader_t) ||
+		memcmp(Header->Magic, BANK_MAGIC, 4) != 0 ||
+		Header->Version != BANK_VERSION ||
+		Map->Size < sizeof(struct BankHeader_t) + Header->nEntries*sizeof(struct BankEntry_t)
+	) {
+		printf("ERROR: Invalid snapshot bank (%s).\n", Filename);
+		goto Error;
+	}
+	if(Header->BlockSize != (uint32_t)BlockSize || Header->nHops != (uint32_t)nHops || Header->WindowType != (uint32_t)WindowType) {
+		printf(
+			"ERROR: Snapshot bank was made with different settings (%s);\n"
+			"       the block size, hops and window must match.\n",
+			Filename
+		);
+		goto Error;
+	}
+
+	//! Find entry
+	uint32_t n;
+	const struct BankEntry_t *Entries = (const struct BankEntry_t*)(Header + 1);
+	for(n=0;n<Header->nEntries;n++) {
+		const struct BankEntry_t *Entry = &Entries[n];
+		if(strncmp(Entry->Name, Name, BANK_NAME_LENGTH) != 0) continue;
+		if(Entry->nChan != (uint32_t)nChan) {
+			printf("ERROR: Snapshot %s has %u channels, but the input has %d.\n", Name, Entry->nChan, nChan);
+			goto Error;
+		}
+		if(Entry->DataOffs > Map->Size || Map->Size - Entry->DataOffs < sizeof(float) * (BlockSize/2) * nChan) {
+			printf("ERROR: Invalid snapshot bank (%s).\n", Filename);
+			goto Error;
+		}
+		return (const float*)((const char*)Map->Data + Entry->DataOffs);
+	}
+	printf("ERROR: Snapshot %s not found in bank (%s).\n", Name, Filename);
+
+Error:
+	MapFile_Close(Map);
+	return NULL;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
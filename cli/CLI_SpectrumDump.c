@@ -0,0 +1,216 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/**************************************/
+#include "CLI.h"
+/**************************************/
+
+#define DUMP_VERSION 1
+
+//! Flags
+#define DUMP_FLAG_PHASE (1u << 0)
+
+//! Range of 8-bit log magnitudes
+//! Code 0 is silence (anything below LOG8_FLOOR), and code k is
+//! LOG8_FLOOR + (k-1)*LOG8_STEP dB.
+#define LOG8_FLOOR (-120.0f)
+#define LOG8_STEP  (0.5f)
+
+//! File header
+//! NOTE: All fields are little-endian. The frames follow immediately,
+//! each holding Abs[nChan][nBins] and then (with DUMP_FLAG_PHASE)
+//! Step[nChan][nBins], with Step in turns per hop (relative to a frequency
+//! of n bins, so that bin n holds (n + Step*nHops)*SampleRate/BlockSize Hz).
+//! For DUMPFORMAT_F16, both are float16; for DUMPFORMAT_LOG8, Abs is a log
+//! code (see above) and Step is int8 (in 1/256 turns).
+struct DumpHeader_t {
+	char     Magic[8];   //! "SPCTDUMP"
+	uint32_t Version;
+	uint32_t HeaderSize;
+	uint32_t Format;     //! DUMPFORMAT_x
+	uint32_t Flags;      //! DUMP_FLAG_x
+	uint32_t nChan;
+	uint32_t BlockSize;
+	uint32_t nHops;      //! Frames per block
+	uint32_t nBins;
+	uint32_t SampleRate;
+	uint32_t Position;   //! Output sample point of the first block
+	float    LogFloor;   //! DUMPFORMAT_LOG8 only
+	float    LogStep;    //! DUMPFORMAT_LOG8 only
+	uint64_t nFrames;
+};
+
+/**************************************/
+
+//! Convert to float16, rounding to nearest even
+//! From "float->half variants", F. Giesen (float_to_half_fast3_rtne).
+static uint16_t FloatToHalf(float x) {
+	const uint32_t F32Infty    = 255u << 23;
+	const uint32_t F16Max      = (127u + 16) << 23;
+	const uint32_t DenormMagic = ((127u - 15) + (23 - 10) + 1) << 23;
+	union { float f; uint32_t u; } v = { x }, Magic;
+	uint32_t Sign = v.u & 0x80000000u;
+	uint16_t Out;
+	v.u ^= Sign;
+	if(v.u >= F16Max) {
+		//! Infinity or NaN (all exponent bits set)
+		Out = (v.u > F32Infty) ? 0x7E00 : 0x7C00;
+	} else if(v.u < (113u << 23)) {
+		//! Subnormal (or zero); let the FPU do the rounding
+		Magic.u = DenormMagic;
+		v.f += Magic.f;
+		Out = (uint16_t)(v.u - DenormMagic);
+	} else {
+		uint32_t MantOdd = (v.u >> 13) & 1;
+		v.u += ((uint32_t)(15 - 127) << 23) + 0xFFF;
+		v.u += MantOdd;
+		Out = (uint16_t)(v.u >> 13);
+	}
+	return Out | (uint16_t)(Sign >> 16);
+}
+
+//! Convert a (normalized) magnitude to an 8-bit log code
+//! NOTE: log2() is approximated with a quadratic on the mantissa (which
+//! gives 1+log2(m) for m in [1,2)), accurate to about 0.03dB (well within
+//! LOG8_STEP).
+static uint8_t AbsToLog8(float x) {
+	union { float f; uint32_t u; } v = { x };
+	if(!(x > 0.0f)) return 0;
+	float Exp = (float)((int)(v.u >> 23) - 128);
+	v.u = (v.u & 0x007FFFFFu) | 0x3F800000u;
+	float m = v.f;
+	float Log2 = Exp + (-0.34484843f*m + 2.02466578f)*m - 0.67487759f;
+	float Code = 1.0f + (Log2*6.0205999f - LOG8_FLOOR) * (1.0f / LOG8_STEP);
+	if(Code < 1.0f)   return 0;
+	if(Code > 254.5f) return 255;
+	return (uint8_t)(Code + 0.5f);
+}
+
+/**************************************/
+
+int CLI_SpectrumDump_Open(
+	struct CLI_SpectrumDump_t *Dump,
+	const char *Filename,
+	int Format,
+	int Phase,
+	const struct Spectrice_t *State,
+	uint32_t SampleRate,
+	uint32_t Position
+) {
+	int n;
+	memset(Dump, 0, sizeof(struct CLI_SpectrumDump_t));
+	Dump->Format    = Format;
+	Dump->Phase     = Phase;
+	Dump->nChan     = State->nChan;
+	Dump->nHops     = State->nHops;
+	Dump->nBins     = State->BlockSize / 2;
+	Dump->ElemSize  = (Format == DUMPFORMAT_F16) ? 2 : 1;
+	Dump->FrameSize = (size_t)Dump->nChan * Dump->nBins * Dump->ElemSize * (Phase ? 2 : 1);
+
+	//! A full-scale sine has a magnitude of half the sum of the window
+	double WindowSum = 0.0;
+	for(n=0;n<Dump->nBins;n++) WindowSum += State->Window[n];
+	Dump->Scale = (WindowSum > 0.0) ? (float)(1.0 / WindowSum) : 1.0f;
+
+	Dump->Frames = malloc(Dump->FrameSize * Dump->nHops);
+	if(Phase) Dump->PrevArg = calloc((size_t)Dump->nChan * Dump->nBins, sizeof(float));
+	if(!Dump->Frames || (Phase && !Dump->PrevArg)) {
+		printf("ERROR: Couldn't allocate spectrum dump buffers.\n");
+		goto Exit_Fail;
+	}
+	Dump->File = fopen(Filename, "wb");
+	if(!Dump->File) {
+		printf("ERROR: Unable to create spectrum dump file (%s).\n", Filename);
+		goto Exit_Fail;
+	}
+
+	//! The frame count is filled in on closing
+	struct DumpHeader_t Header;
+	memset(&Header, 0, sizeof(Header));
+	memcpy(Header.Magic, "SPCTDUMP", 8);
+	Header.Version    = DUMP_VERSION;
+	Header.HeaderSize = sizeof(Header);
+	Header.Format     = Format;
+	Header.Flags      = Phase ? DUMP_FLAG_PHASE : 0;
+	Header.nChan      = Dump->nChan;
+	Header.BlockSize  = State->BlockSize;
+	Header.nHops      = Dump->nHops;
+	Header.nBins      = Dump->nBins;
+	Header.SampleRate = SampleRate;
+	Header.Position   = Position;
+	Header.LogFloor   = LOG8_FLOOR;
+	Header.LogStep    = LOG8_STEP;
+	fwrite(&Header, sizeof(Header), 1, Dump->File);
+	return 1;
+
+Exit_Fail:
+	free(Dump->PrevArg);
+	free(Dump->Frames);
+	return 0;
+}
+
+/**************************************/
+
+void CLI_SpectrumDump_Capture(void *User, int Chan, int Hop, const float *Abs, const float *Arg) {
+	int n;
+	struct CLI_SpectrumDump_t *Dump = (struct CLI_SpectrumDump_t*)User;
+	int   nBins = Dump->nBins;
+	float Scale = Dump->Scale;
+	uint8_t *Frame = Dump->Frames + Hop*Dump->FrameSize;
+	if(Dump->Format == DUMPFORMAT_F16) {
+		uint16_t *Dst = (uint16_t*)Frame + Chan*nBins;
+		for(n=0;n<nBins;n++) Dst[n] = FloatToHalf(Abs[n] * Scale);
+	} else {
+		uint8_t *Dst = Frame + Chan*nBins;
+		for(n=0;n<nBins;n++) Dst[n] = AbsToLog8(Abs[n] * Scale);
+	}
+
+	//! The phase step is taken as for freezing, but with the sign flipped
+	//! to follow the frequency (the transform is centred on the window)
+	//! NOTE: The very first frame has no previous phase, so has no step.
+	if(Dump->Phase) {
+		float *PrevArg = Dump->PrevArg + Chan*nBins;
+		int First = (Dump->nFrames == 0 && Hop == 0);
+		uint8_t *StepBase = Frame + (size_t)Dump->nChan*nBins*Dump->ElemSize;
+		for(n=0;n<nBins;n++) {
+			float Step = PrevArg[n] - Arg[n] - (float)n / Dump->nHops;
+			Step -= floorf(Step + 0.5f);
+			if(First) Step = 0.0f;
+			PrevArg[n] = Arg[n];
+			if(Dump->Format == DUMPFORMAT_F16) {
+				((uint16_t*)StepBase)[Chan*nBins + n] = FloatToHalf(Step);
+			} else {
+				int q = (int)lrintf(Step * 256.0f);
+				((int8_t*)StepBase)[Chan*nBins + n] = (int8_t)((q > 127) ? 127 : q);
+			}
+		}
+	}
+}
+
+void CLI_SpectrumDump_Write(struct CLI_SpectrumDump_t *Dump, const uint8_t *Frames, int nBlocks) {
+	size_t nFrames = (size_t)nBlocks * Dump->nHops;
+	fwrite(Frames, Dump->FrameSize, nFrames, Dump->File);
+	Dump->nFrames += nFrames;
+}
+
+int CLI_SpectrumDump_Close(struct CLI_SpectrumDump_t *Dump) {
+	int Ok = 1;
+	fseek(Dump->File, offsetof(struct DumpHeader_t, nFrames), SEEK_SET);
+	fwrite(&Dump->nFrames, sizeof(Dump->nFrames), 1, Dump->File);
+	if(ferror(Dump->File)) Ok = 0;
+	if(fclose(Dump->File) != 0) Ok = 0;
+	free(Dump->PrevArg);
+	free(Dump->Frames);
+	return Ok;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
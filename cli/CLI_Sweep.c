@@ -0,0 +1,115 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/**************************************/
+#include "CLI.h"
+/**************************************/
+#define MAX_LINE_LENGTH  4096
+#define MAX_LINE_TOKENS  64
+#define MAX_VARIANTS     256
+/**************************************/
+
+int CLI_RunSweep(const char *InFilename, const char *VariantsFilename, const struct CLI_Options_t *Opt, struct CLI_RunStats_t *Run) {
+	int n;
+	int ExitCode = 0;
+	int nVariants = 0;
+	char                **Lines        = malloc(MAX_VARIANTS * sizeof(char*));
+	const char          **OutFilenames = malloc(MAX_VARIANTS * sizeof(char*));
+	struct CLI_Options_t *Opts         = malloc(MAX_VARIANTS * sizeof(struct CLI_Options_t));
+	if(!Lines || !OutFilenames || !Opts) {
+		printf("ERROR: Couldn't allocate variants.\n");
+		ExitCode = -1; goto Exit;
+	}
+
+	//! Read variants
+	//! NOTE: Each line is kept, as the filename and any string options
+	//! point into it.
+	{
+		FILE *File = fopen(VariantsFilename, "r");
+		if(!File) {
+			printf("ERROR: Unable to open variants file (%s).\n", VariantsFilename);
+			ExitCode = -1; goto Exit;
+		}
+		int LineIdx = 0;
+		char  Line[MAX_LINE_LENGTH];
+		char *Tokens[MAX_LINE_TOKENS];
+		while(fgets(Line, sizeof(Line), File)) {
+			LineIdx++;
+			char *LineCopy = strdup(Line);
+			if(!LineCopy) {
+				printf("ERROR: Out of memory reading variants.\n");
+				ExitCode = -1; break;
+			}
+			int nTokens = CLI_TokenizeLine(LineCopy, Tokens, MAX_LINE_TOKENS);
+			if(nTokens == 0) {
+				free(LineCopy);
+				continue;
+			}
+			if(nTokens < 0) {
+				printf("ERROR: Variants line %d: Too many options.\n", LineIdx);
+				free(LineCopy);
+				ExitCode = -1; break;
+			}
+			if(nVariants == MAX_VARIANTS) {
+				printf("ERROR: Too many variants (maximum is %d).\n", MAX_VARIANTS);
+				free(LineCopy);
+				ExitCode = -1; break;
+			}
+			Lines[nVariants] = LineCopy;
+
+			//! Apply per-variant options on top of the globals
+			struct CLI_Options_t *VarOpt = &Opts[nVariants];
+			*VarOpt = *Opt;
+			OutFilenames[nVariants] = Tokens[0];
+			nVariants++;
+			for(n=1;n<nTokens;n++) {
+				if(!CLI_ParseOption(VarOpt, Tokens[n])) {
+					printf("ERROR: Variants line %d: Invalid options.\n", LineIdx);
+					ExitCode = -1; break;
+				}
+			}
+			if(ExitCode) break;
+			if(!CLI_OptionsShareAnalysis(Opt, VarOpt)) {
+				printf(
+					"ERROR: Variants line %d: Only freezing options and output format may change\n"
+					"       between variants (not block size, hops, window, freeze point,\n"
+					"       crossfade, loop handling or cache).\n",
+					LineIdx
+				);
+				ExitCode = -1; break;
+			}
+		}
+		fclose(File);
+	}
+	if(!ExitCode && nVariants == 0) {
+		printf("ERROR: No variants to render.\n");
+		ExitCode = -1;
+	}
+
+	//! Render all variants together
+	if(!ExitCode) {
+		struct CLI_Worker_t Worker;
+		CLI_WorkerInit(&Worker);
+		printf("Rendering %d variants of %s...\n", nVariants, InFilename);
+		struct CLI_RenderStats_t Stats;
+		ExitCode = CLI_RenderVariants(&Worker, InFilename, OutFilenames, Opts, nVariants, &Stats);
+		if(Run) CLI_RunStats_Add(Run, &Stats, ExitCode);
+		CLI_WorkerDestroy(&Worker);
+	}
+
+Exit:
+	if(Lines) for(n=0;n<nVariants;n++) free(Lines[n]);
+	free(Opts);
+	free(OutFilenames);
+	free(Lines);
+	return ExitCode;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
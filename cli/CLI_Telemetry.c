@@ -0,0 +1,107 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/**************************************/
+#include "CLI.h"
+/**************************************/
+
+//! Floor for levels in dB (for silence)
+#define MIN_DECIBELS (-200.0)
+
+/**************************************/
+
+static double PowerToDecibels(double x) {
+	return (x > 0.0) ? fmax(10.0*log10(x), MIN_DECIBELS) : MIN_DECIBELS;
+}
+
+static double AmplitudeToDecibels(double x) {
+	return PowerToDecibels(x*x);
+}
+
+/**************************************/
+
+int CLI_Telemetry_Open(struct CLI_Telemetry_t *Tm, const char *Filename, int nChan, int BlockSize, uint32_t PositionBase) {
+	int Chan;
+	Tm->nChan        = nChan;
+	Tm->BlockSize    = BlockSize;
+	Tm->PositionBase = PositionBase;
+	Tm->Chans = calloc(nChan, sizeof(struct Spectrice_Telemetry_t));
+	if(!Tm->Chans) {
+		printf("ERROR: Couldn't allocate telemetry.\n");
+		return 0;
+	}
+	Tm->File = fopen(Filename, "w");
+	if(!Tm->File) {
+		printf("ERROR: Unable to create telemetry file (%s).\n", Filename);
+		free(Tm->Chans);
+		return 0;
+	}
+	fprintf(Tm->File, "block,position,clipped");
+	for(Chan=0;Chan<nChan;Chan++) {
+		fprintf(
+			Tm->File, ",in_rms_%d,in_peak_%d,out_rms_%d,out_peak_%d,freeze_dist_%d,gain_%d",
+			Chan, Chan, Chan, Chan, Chan, Chan
+		);
+	}
+	fprintf(Tm->File, "\n");
+	return 1;
+}
+
+void CLI_Telemetry_Close(struct CLI_Telemetry_t *Tm) {
+	fclose(Tm->File);
+	free(Tm->Chans);
+}
+
+void CLI_Telemetry_Clear(struct Spectrice_Telemetry_t *Chans, int nChan) {
+	memset(Chans, 0, nChan * sizeof(struct Spectrice_Telemetry_t));
+}
+
+void CLI_Telemetry_AddInput(struct Spectrice_Telemetry_t *Chans, const float *Input, int nChan, int nSmp) {
+	int n, Chan;
+	for(Chan=0;Chan<nChan;Chan++) {
+		struct Spectrice_Telemetry_t *Telemetry = &Chans[Chan];
+		double SumSq = 0.0;
+		float  Peak  = Telemetry->InPeak;
+		for(n=0;n<nSmp;n++) {
+			float x = Input[n*nChan+Chan];
+			float a = (x < 0.0f) ? -x : x;
+			SumSq += (double)x*x;
+			if(a > Peak) Peak = a;
+		}
+		Telemetry->InSumSq    += SumSq;
+		Telemetry->InPeak      = Peak;
+		Telemetry->nInSamples += nSmp;
+	}
+}
+
+void CLI_Telemetry_Write(struct CLI_Telemetry_t *Tm, int Block, const struct Spectrice_Telemetry_t *Chans, uint64_t nClipped) {
+	int Chan;
+	fprintf(
+		Tm->File, "%d,%u,%llu",
+		Block, Tm->PositionBase + (uint32_t)Block*Tm->BlockSize, (unsigned long long)nClipped
+	);
+	for(Chan=0;Chan<Tm->nChan;Chan++) {
+		const struct Spectrice_Telemetry_t *t = &Chans[Chan];
+		double InPower  = t->nInSamples  ? (t->InSumSq  / t->nInSamples)  : 0.0;
+		double OutPower = t->nOutSamples ? (t->OutSumSq / t->nOutSamples) : 0.0;
+		double Spec     = (t->SpecInSumSq > 0.0) ? t->SpecInSumSq : 1.0;
+		fprintf(
+			Tm->File, ",%.2f,%.2f,%.2f,%.2f,%.2f,%.2f",
+			PowerToDecibels(InPower),  AmplitudeToDecibels(t->InPeak),
+			PowerToDecibels(OutPower), AmplitudeToDecibels(t->OutPeak),
+			PowerToDecibels(t->FreezeDistSq / Spec),
+			PowerToDecibels(t->SpecOutSumSq / Spec)
+		);
+	}
+	fprintf(Tm->File, "\n");
+}
+
+/**************************************/
+//! EOF
+/**************************************/
@@ -7,7 +7,8 @@
 #include "FourierHelper.h"
 /**************************************/
 
-void Fourier_FFTReCenter(float *Buf, float *Tmp, int N) {
+//! Radix-2 (power-of-two N) transforms
+static void FFTReCenter_Radix2(float *Buf, float *Tmp, int N) {
 	int n;
 	float *SrcA, *SrcB, *Dst;
 	FOURIER_ASSUME_ALIGNED(Buf, 32);
@@ -68,7 +69,7 @@ void Fourier_FFTReCenter(float *Buf, float *Tmp, int N) {
 
 /**************************************/
 
-void Fourier_iFFTReCenter(float *Buf, float *Tmp, int N) {
+static void iFFTReCenter_Radix2(float *Buf, float *Tmp, int N) {
 	int n;
 	float *DstA, *DstB, *Src;
 	FOURIER_ASSUME_ALIGNED(Buf, 32);
@@ -124,6 +125,243 @@ void Fourier_iFFTReCenter(float *Buf, float *Tmp, int N) {
 #endif
 }
 
+/**************************************/
+
+//! Radix-p stages (p = 3 or 5), for N = p*M
+//! Splitting x[] into the p decimated sequences x_q[r] = x[p*r+q] (each of
+//! length M), the centred times n-(N-1)/2 become p*(r-(M-1)/2) + d_q, with
+//! d_q = q-(p-1)/2, so that (with u = Exp[2Pi*i*(k+1/2)/N]):
+//!  X[k] = Sum[u^d_q * Y_q(k), {q,0,p-1}]
+//! where Y_q is the centred FFT of x_q. Y_q(k+M) = -Y_q(k), and as x_q is
+//! real, Y_q(M-1-k) = -Conj[Y_q(k)]. So twiddling line k < M/2 of each Y_q
+//! as V_q = u^d_q * Y_q(k) and taking the centred p-point DFT
+//!  D_e = Sum[Exp[2Pi*i*e*d_q/p] * V_q, {q,0,p-1}], e = -(p-1)/2..(p-1)/2
+//! gives every line of X[] that derives from line k:
+//!  X[j*M + k]     = (-1)^j     * D_j,              j = 0..(p-1)/2
+//!  X[j*M + M-1-k] = (-1)^(j+1) * Conj[D_-(j+1)],   j = 0..(p-3)/2
+//! The inverse transform is the transpose of all this.
+#define MAX_RADIX 5
+
+//! Load/store FOURIER_VSTRIDE lines (packed as {Re,Im}) as Re and Im vectors
+//! With Reverse set, the lines are stored in reverse order.
+FOURIER_FORCED_INLINE
+void LoadLines(Fourier_Vec_t *Re, Fourier_Vec_t *Im, const float *Src, int Reverse) {
+#if FOURIER_VSTRIDE > 1
+	FOURIER_VSPLIT_EVEN_ODD(FOURIER_VLOAD(Src), FOURIER_VLOAD(Src+FOURIER_VSTRIDE), Re, Im);
+	if(Reverse) {
+		*Re = FOURIER_VREVERSE(*Re);
+		*Im = FOURIER_VREVERSE(*Im);
+	}
+#else
+	(void)Reverse;
+	*Re = Src[0];
+	*Im = Src[1];
+#endif
+}
+FOURIER_FORCED_INLINE
+void StoreLines(float *Dst, Fourier_Vec_t Re, Fourier_Vec_t Im, int Reverse) {
+#if FOURIER_VSTRIDE > 1
+	if(Reverse) {
+		Re = FOURIER_VREVERSE(Re);
+		Im = FOURIER_VREVERSE(Im);
+	}
+	FOURIER_VINTERLEAVE(Re, Im, &Re, &Im);
+	FOURIER_VSTORE(Dst+0,               Re);
+	FOURIER_VSTORE(Dst+FOURIER_VSTRIDE, Im);
+#else
+	(void)Reverse;
+	Dst[0] = Re;
+	Dst[1] = Im;
+#endif
+}
+
+//! Set D_(+e) = A + i*B, D_(-e) = A - i*B (swapped for the inverse)
+FOURIER_FORCED_INLINE
+void SetDFTPair(
+	Fourier_Vec_t *PosRe, Fourier_Vec_t *PosIm,
+	Fourier_Vec_t *NegRe, Fourier_Vec_t *NegIm,
+	Fourier_Vec_t ARe, Fourier_Vec_t AIm,
+	Fourier_Vec_t BRe, Fourier_Vec_t BIm,
+	int Inverse
+) {
+	Fourier_Vec_t *t;
+	if(Inverse) {
+		t = PosRe, PosRe = NegRe, NegRe = t;
+		t = PosIm, PosIm = NegIm, NegIm = t;
+	}
+	*PosRe = FOURIER_VSUB(ARe, BIm);
+	*PosIm = FOURIER_VADD(AIm, BRe);
+	*NegRe = FOURIER_VADD(ARe, BIm);
+	*NegIm = FOURIER_VSUB(AIm, BRe);
+}
+
+//! Centred 3-point DFT, in place (indexed by d+1)
+FOURIER_FORCED_INLINE
+void CentredDFT3(Fourier_Vec_t *Re, Fourier_Vec_t *Im, int Inverse) {
+	const Fourier_Vec_t c1 = FOURIER_VSET1(-0.5f);
+	const Fourier_Vec_t s1 = FOURIER_VSET1(0x1.BB67AEp-1f);
+	Fourier_Vec_t SRe = FOURIER_VADD(Re[2], Re[0]), SIm = FOURIER_VADD(Im[2], Im[0]);
+	Fourier_Vec_t TRe = FOURIER_VSUB(Re[2], Re[0]), TIm = FOURIER_VSUB(Im[2], Im[0]);
+	Fourier_Vec_t ARe = FOURIER_VFMA(c1, SRe, Re[1]);
+	Fourier_Vec_t AIm = FOURIER_VFMA(c1, SIm, Im[1]);
+	Re[1] = FOURIER_VADD(Re[1], SRe);
+	Im[1] = FOURIER_VADD(Im[1], SIm);
+	SetDFTPair(&Re[2], &Im[2], &Re[0], &Im[0], ARe, AIm, FOURIER_VMUL(s1, TRe), FOURIER_VMUL(s1, TIm), Inverse);
+}
+
+//! Centred 5-point DFT, in place (indexed by d+2)
+FOURIER_FORCED_INLINE
+void CentredDFT5(Fourier_Vec_t *Re, Fourier_Vec_t *Im, int Inverse) {
+	const Fourier_Vec_t c1 = FOURIER_VSET1( 0x1.3C6EF4p-2f), s1 = FOURIER_VSET1(0x1.E6F0E2p-1f);
+	const Fourier_Vec_t c2 = FOURIER_VSET1(-0x1.9E377Ap-1f), s2 = FOURIER_VSET1(0x1.2CF230p-1f);
+	Fourier_Vec_t S1Re = FOURIER_VADD(Re[3], Re[1]), S1Im = FOURIER_VADD(Im[3], Im[1]);
+	Fourier_Vec_t T1Re = FOURIER_VSUB(Re[3], Re[1]), T1Im = FOURIER_VSUB(Im[3], Im[1]);
+	Fourier_Vec_t S2Re = FOURIER_VADD(Re[4], Re[0]), S2Im = FOURIER_VADD(Im[4], Im[0]);
+	Fourier_Vec_t T2Re = FOURIER_VSUB(Re[4], Re[0]), T2Im = FOURIER_VSUB(Im[4], Im[0]);
+	Fourier_Vec_t A1Re = FOURIER_VFMA(c2, S2Re, FOURIER_VFMA(c1, S1Re, Re[2]));
+	Fourier_Vec_t A1Im = FOURIER_VFMA(c2, S2Im, FOURIER_VFMA(c1, S1Im, Im[2]));
+	Fourier_Vec_t B1Re = FOURIER_VFMA(s2, T2Re, FOURIER_VMUL(s1, T1Re));
+	Fourier_Vec_t B1Im = FOURIER_VFMA(s2, T2Im, FOURIER_VMUL(s1, T1Im));
+	Fourier_Vec_t A2Re = FOURIER_VFMA(c1, S2Re, FOURIER_VFMA(c2, S1Re, Re[2]));
+	Fourier_Vec_t A2Im = FOURIER_VFMA(c1, S2Im, FOURIER_VFMA(c2, S1Im, Im[2]));
+	Fourier_Vec_t B2Re = FOURIER_VSUB(FOURIER_VMUL(s2, T1Re), FOURIER_VMUL(s1, T2Re));
+	Fourier_Vec_t B2Im = FOURIER_VSUB(FOURIER_VMUL(s2, T1Im), FOURIER_VMUL(s1, T2Im));
+	Re[2] = FOURIER_VADD(Re[2], FOURIER_VADD(S1Re, S2Re));
+	Im[2] = FOURIER_VADD(Im[2], FOURIER_VADD(S1Im, S2Im));
+	SetDFTPair(&Re[3], &Im[3], &Re[1], &Im[1], A1Re, A1Im, B1Re, B1Im, Inverse);
+	SetDFTPair(&Re[4], &Im[4], &Re[0], &Im[0], A2Re, A2Im, B2Re, B2Im, Inverse);
+}
+
+//! Get the twiddle factors u^d (d = 1..(p-1)/2) for the lines starting at k
+//! u is evaluated directly rather than by recurrence, as it only spans
+//! angles up to Pi/p.
+FOURIER_FORCED_INLINE
+void RadixTwiddles(Fourier_Vec_t *tRe, Fourier_Vec_t *tIm, int k, int N, int p) {
+#if FOURIER_VSTRIDE > 1
+	Fourier_Vec_t x = FOURIER_VADD(FOURIER_VSET_LINEAR_RAMP(), FOURIER_VSET1(k + 0.5f));
+#else
+	Fourier_Vec_t x = k + 0.5f;
+#endif
+	x = FOURIER_VMUL(x, FOURIER_VSET1(4.0f / N));
+	tRe[1] = Fourier_Cos(x);
+	tIm[1] = Fourier_Sin(x);
+	if(p == 5) {
+		tRe[2] = FOURIER_VSUB(FOURIER_VMUL(tRe[1], tRe[1]), FOURIER_VMUL(tIm[1], tIm[1]));
+		tIm[2] = FOURIER_VMUL(FOURIER_VSET1(2.0f), FOURIER_VMUL(tRe[1], tIm[1]));
+	}
+}
+
+/**************************************/
+
+FOURIER_FORCED_INLINE
+void FFTReCenter_RadixP(float *Buf, float *Tmp, int N, int p) {
+	int q, r, k, j, d;
+	int M = N / p, h = (p-1)/2;
+	FOURIER_ASSUME_ALIGNED(Buf, 32);
+	FOURIER_ASSUME_ALIGNED(Tmp, 32);
+
+	//! Decimate into Tmp[p][M], and transform each sequence
+	for(r=0;r<M;r++) for(q=0;q<p;q++) Tmp[q*M+r] = Buf[p*r+q];
+	for(q=0;q<p;q++) Fourier_FFTReCenter(Tmp + q*M, Buf, M);
+
+	//! Twiddle and combine
+	for(k=0;k<M/2;k+=FOURIER_VSTRIDE) {
+		Fourier_Vec_t Re[MAX_RADIX], Im[MAX_RADIX], a, b;
+		Fourier_Vec_t tRe[MAX_RADIX/2+1], tIm[MAX_RADIX/2+1];
+		RadixTwiddles(tRe, tIm, k, N, p);
+		LoadLines(&Re[h], &Im[h], Tmp + h*M + k*2, 0);
+		for(d=1;d<=h;d++) {
+			LoadLines(&a, &b, Tmp + (h+d)*M + k*2, 0);
+			Re[h+d] = FOURIER_VSUB(FOURIER_VMUL(tRe[d], a), FOURIER_VMUL(tIm[d], b));
+			Im[h+d] = FOURIER_VFMA(tRe[d], b, FOURIER_VMUL(tIm[d], a));
+			LoadLines(&a, &b, Tmp + (h-d)*M + k*2, 0);
+			Re[h-d] = FOURIER_VFMA(tRe[d], a, FOURIER_VMUL(tIm[d], b));
+			Im[h-d] = FOURIER_VSUB(FOURIER_VMUL(tRe[d], b), FOURIER_VMUL(tIm[d], a));
+		}
+		if(p == 3) CentredDFT3(Re, Im, 0);
+		else       CentredDFT5(Re, Im, 0);
+		for(j=0;j<=h;j++) {
+			Fourier_Vec_t Sgn = FOURIER_VSET1((j & 1) ? -1.0f : +1.0f);
+			StoreLines(Buf + (j*M + k)*2, FOURIER_VMUL(Sgn, Re[h+j]), FOURIER_VMUL(Sgn, Im[h+j]), 0);
+		}
+		for(j=0;j<h;j++) {
+			Fourier_Vec_t Sgn = FOURIER_VSET1((j & 1) ? +1.0f : -1.0f);
+			StoreLines(Buf + (j*M + M-k-FOURIER_VSTRIDE)*2, FOURIER_VMUL(Sgn, Re[h-j-1]), FOURIER_VSUB(FOURIER_VSET1(0.0f), FOURIER_VMUL(Sgn, Im[h-j-1])), 1);
+		}
+	}
+}
+
+FOURIER_FORCED_INLINE
+void iFFTReCenter_RadixP(float *Buf, float *Tmp, int N, int p) {
+	int q, r, k, j, d;
+	int M = N / p, h = (p-1)/2;
+	FOURIER_ASSUME_ALIGNED(Buf, 32);
+	FOURIER_ASSUME_ALIGNED(Tmp, 32);
+
+	//! Split and un-twiddle into Tmp[p][M]
+	for(k=0;k<M/2;k+=FOURIER_VSTRIDE) {
+		Fourier_Vec_t Re[MAX_RADIX], Im[MAX_RADIX], a, b;
+		Fourier_Vec_t tRe[MAX_RADIX/2+1], tIm[MAX_RADIX/2+1];
+		for(j=0;j<=h;j++) {
+			Fourier_Vec_t Sgn = FOURIER_VSET1((j & 1) ? -1.0f : +1.0f);
+			LoadLines(&a, &b, Buf + (j*M + k)*2, 0);
+			Re[h+j] = FOURIER_VMUL(Sgn, a);
+			Im[h+j] = FOURIER_VMUL(Sgn, b);
+		}
+		for(j=0;j<h;j++) {
+			Fourier_Vec_t Sgn = FOURIER_VSET1((j & 1) ? +1.0f : -1.0f);
+			LoadLines(&a, &b, Buf + (j*M + M-k-FOURIER_VSTRIDE)*2, 1);
+			Re[h-j-1] = FOURIER_VMUL(Sgn, a);
+			Im[h-j-1] = FOURIER_VSUB(FOURIER_VSET1(0.0f), FOURIER_VMUL(Sgn, b));
+		}
+		if(p == 3) CentredDFT3(Re, Im, 1);
+		else       CentredDFT5(Re, Im, 1);
+		RadixTwiddles(tRe, tIm, k, N, p);
+		StoreLines(Tmp + h*M + k*2, Re[h], Im[h], 0);
+		for(d=1;d<=h;d++) {
+			a = Re[h+d], b = Im[h+d];
+			StoreLines(
+				Tmp + (h+d)*M + k*2,
+				FOURIER_VFMA(tRe[d], a, FOURIER_VMUL(tIm[d], b)),
+				FOURIER_VSUB(FOURIER_VMUL(tRe[d], b), FOURIER_VMUL(tIm[d], a)),
+				0
+			);
+			a = Re[h-d], b = Im[h-d];
+			StoreLines(
+				Tmp + (h-d)*M + k*2,
+				FOURIER_VSUB(FOURIER_VMUL(tRe[d], a), FOURIER_VMUL(tIm[d], b)),
+				FOURIER_VFMA(tRe[d], b, FOURIER_VMUL(tIm[d], a)),
+				0
+			);
+		}
+	}
+
+	//! Transform each sequence, and interleave back
+	for(q=0;q<p;q++) Fourier_iFFTReCenter(Tmp + q*M, Buf, M);
+	for(r=0;r<M;r++) for(q=0;q<p;q++) Buf[p*r+q] = Tmp[q*M+r];
+}
+
+/**************************************/
+
+void Fourier_FFTReCenter(float *Buf, float *Tmp, int N) {
+	     if(N % 3 == 0) FFTReCenter_RadixP(Buf, Tmp, N, 3);
+	else if(N % 5 == 0) FFTReCenter_RadixP(Buf, Tmp, N, 5);
+	else FFTReCenter_Radix2(Buf, Tmp, N);
+}
+
+void Fourier_iFFTReCenter(float *Buf, float *Tmp, int N) {
+	     if(N % 3 == 0) iFFTReCenter_RadixP(Buf, Tmp, N, 3);
+	else if(N % 5 == 0) iFFTReCenter_RadixP(Buf, Tmp, N, 5);
+	else iFFTReCenter_Radix2(Buf, Tmp, N);
+}
+
+int Fourier_IsFFTSize(int N) {
+	if(N <= 0) return 0;
+	while(N % 3 == 0) N /= 3;
+	while(N % 5 == 0) N /= 5;
+	return N >= 16 && (N & (N-1)) == 0;
+}
+
 /**************************************/
 //! EOF
 /**************************************/
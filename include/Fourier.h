@@ -29,11 +29,16 @@ void Fourier_DCT4(float *Buf, float *Tmp, int N);
 //! Centered DFT derivation:
 //!  "The Centered Discrete Fourier Transform and a Parallel Implementation of the FFT"
 //!  DOI: 10.1109/ICASSP.2011.5946834
+//! Sizes with factors of 3 and 5 are split by radix-3/5 stages down to
+//! power-of-two transforms, which use DCT4 as above.
 //! NOTE:
-//!  -N must be a power of two, and >= 16.
+//!  -N must be 2^a * 3^b * 5^c, with 2^a >= 16 (see Fourier_IsFFTSize()).
 void Fourier_FFTReCenter (float *Buf, float *Tmp, int N); //! Buf[N], Tmp[N]
 void Fourier_iFFTReCenter(float *Buf, float *Tmp, int N); //! Buf[N], Tmp[N]
 
+//! Check if N is a supported size for Fourier_FFTReCenter()
+int Fourier_IsFFTSize(int N);
+
 /**************************************/
 //! EOF
 /**************************************/
@@ -0,0 +1,19 @@
+/**************************************/
+#pragma once
+/**************************************/
+#include <stddef.h>
+#include <stdint.h>
+/**************************************/
+
+//! FNV-1a (64-bit)
+//! Start with HASH_FNV1A64_INIT, then feed data in any number of pieces.
+#define HASH_FNV1A64_INIT 0xCBF29CE484222325ull
+uint64_t Hash_FNV1a64(uint64_t Hash, const void *Data, size_t Size);
+
+//! Hash the whole contents of a file
+//! Returns 1 on success, or 0 on failure (file can't be read).
+int Hash_FNV1a64File(uint64_t *Hash, const char *Filename);
+
+/**************************************/
+//! EOF
+/**************************************/
@@ -0,0 +1,30 @@
+/**************************************/
+#pragma once
+/**************************************/
+#include <stddef.h>
+/**************************************/
+
+//! Internal state type
+struct MapFile_t {
+	void  *Data;
+	size_t Size;
+#ifdef _WIN32
+	void  *hFile;
+	void  *hMapping;
+#endif
+};
+
+/**************************************/
+
+//! Map a whole file into memory (read-only)
+//! Returns 1 on success, or 0 on failure (eg. file doesn't exist, or is empty).
+int  MapFile_Open (struct MapFile_t *Map, const char *Filename);
+void MapFile_Close(struct MapFile_t *Map);
+
+//! Atomically replace DstFilename with SrcFilename
+//! Returns 1 on success, or 0 on failure.
+int  MapFile_Rename(const char *SrcFilename, const char *DstFilename);
+
+/**************************************/
+//! EOF
+/**************************************/
@@ -0,0 +1,59 @@
+/**************************************/
+#pragma once
+/**************************************/
+#include <stdint.h>
+/**************************************/
+
+//! Available counters
+#define PERF_CYCLES        0 //! CPU cycles
+#define PERF_INSTRUCTIONS  1 //! Instructions retired
+#define PERF_L1D_LOADS     2 //! L1 data cache loads
+#define PERF_L1D_MISSES    3 //! L1 data cache load misses
+#define PERF_LLC_LOADS     4 //! Last-level cache loads
+#define PERF_LLC_MISSES    5 //! Last-level cache load misses
+#define PERF_BRANCH_MISSES 6 //! Mispredicted branches
+#define PERF_COUNTER_COUNT 7
+
+//! Internal state type
+struct Perf_t {
+	int Fd[PERF_COUNTER_COUNT]; //! -1 = unavailable
+	int nOpen;
+	int Error;                  //! errno of the first counter that failed to open
+};
+
+/**************************************/
+
+//! Perf_Open(Perf)
+//! Description: Open hardware performance counters for the calling thread
+//!              (user-space only). Counters start running immediately.
+//!              Each counter is opened on its own, so that any that are
+//!              not supported by the CPU are simply left out.
+//! Returns: Number of counters opened. This is 0 on anything but Linux,
+//!          or when counters are not available (eg. no PMU under a VM,
+//!          or perf_event_paranoid is too restrictive); the state is then
+//!          still valid, and reads return zeroes.
+int  Perf_Open (struct Perf_t *Perf);
+void Perf_Close(struct Perf_t *Perf);
+
+//! Perf_Read(Perf, Values)
+//! Description: Read the current counts into Values[PERF_COUNTER_COUNT].
+//!              When counters are multiplexed, the counts are scaled up by
+//!              the fraction of time each was actually running.
+//!              Unavailable counters read as 0.
+void Perf_Read(const struct Perf_t *Perf, uint64_t *Values);
+
+//! Perf_Has(Perf, Counter)
+//! Returns: 1 if Counter is available, or 0 otherwise.
+int  Perf_Has(const struct Perf_t *Perf, int Counter);
+
+//! Perf_GetCounterName(Counter)
+//! Returns: Short name of a PERF_x counter, or NULL if invalid.
+const char *Perf_GetCounterName(int Counter);
+
+//! Perf_GetParanoid()
+//! Returns: Current perf_event_paranoid level, or -2 if unknown.
+int  Perf_GetParanoid(void);
+
+/**************************************/
+//! EOF
+/**************************************/
@@ -4,6 +4,16 @@
 //! Refer to the project README file for license terms.
 /**************************************/
 #pragma once
+/**************************************/
+#include <stddef.h>
+#include <stdint.h>
+/**************************************/
+
+//! Library version
+//! This is bumped whenever the output for a given input and parameters
+//! changes, so that it can be used to invalidate cached results.
+#define SPECTRICE_VERSION 2
+
 /**************************************/
 
 //! Available window types
@@ -12,6 +22,34 @@
 #define SPECTRICE_WINDOW_TYPE_HAMMING  2
 #define SPECTRICE_WINDOW_TYPE_BLACKMAN 3
 #define SPECTRICE_WINDOW_TYPE_NUTTALL  4
+#define SPECTRICE_WINDOW_TYPE_SQRTCOS  5
+#define SPECTRICE_WINDOW_TYPE_KBD      6
+
+/**************************************/
+
+//! Processing stages (for timing statistics)
+#define SPECTRICE_STAGE_WINDOW  0 //! Windowing of the input
+#define SPECTRICE_STAGE_FFT     1 //! Forward transform
+#define SPECTRICE_STAGE_POLAR   2 //! Polar conversion and freezing
+#define SPECTRICE_STAGE_IFFT    3 //! Inverse transform
+#define SPECTRICE_STAGE_OVERLAP 4 //! Windowed overlap-add
+#define SPECTRICE_STAGE_SHIFT   5 //! Overlap buffer shifting and output
+#define SPECTRICE_STAGE_COUNT   6
+
+//! Maximum number of extra counters (see Spectrice_SetStatsCounters())
+#define SPECTRICE_STATS_MAX_COUNTERS 8
+
+//! Extra counter reader
+//! Reads the current value of every counter into Values[nCounters].
+typedef void (*Spectrice_StatsCounterFunc_t)(void *User, uint64_t *Values);
+
+//! Spectrum callback (see Spectrice_SetSpectrumFunc())
+typedef void (*Spectrice_SpectrumFunc_t)(void *User, int Chan, int Hop, const float *Abs, const float *Arg);
+
+//! Stage callback
+//! Called with Stage = -1 when a channel's hop is about to be analyzed or
+//! synthesized, then with each SPECTRICE_STAGE_x as it finishes.
+typedef void (*Spectrice_StatsStageFunc_t)(void *User, int Stage, int Chan);
 
 /**************************************/
 
@@ -19,16 +57,23 @@
 struct Spectrice_t {
 	//! Global state (do not change after initialization)
 	int   nChan;        //! Channels in encoding scheme
-	int   BlockSize;    //! Transform block size
-	int   nHops;        //! Number of STFT hops per block
+	int   BlockSize;    //! Transform block size (see Fourier_IsFFTSize())
+	int   nHops;        //! Number of STFT hops per block (must divide BlockSize)
 	int   FreezeStart;  //! Position to begin the freeze operation (in samples)
 	int   FreezePoint;  //! Position where freezing peaks out (in samples)
 	float FreezeFactor; //! Freezing amount (0.0 = No freezing, 1.0 = Full freeze)
 	int   FreezeAmp;    //! Freeze amplitude  (0 = False, 1 = True)
 	int   FreezePhase;  //! Freeze phase step (0 = False, 1 = True)
+	int   FastMath;     //! Use approximate polar conversion (0 = False, 1 = True)
+	float SilenceThreshold; //! Input level considered silent (0.0 = exact silence only)
+	int   FreezeBinLo;  //! First line to freeze
+	int   FreezeBinHi;  //! Last line to freeze, plus one (0 or BlockSize/2 = all lines)
 	int   HaveSnapshot; //! 0 = BfAbs contains last block's data, 1 = BfAbs contains a snapshot
 
 	//! Internal state
+	//! WindowType/WindowSize/WindowHops record the parameters that
+	//! Window[] was built for, so that Spectrice_Reinit() can keep it.
+	//! SilenceLevel is SilenceThreshold as a spectral magnitude.
 	//! Buffer memory layout (excluding alignment padding):
 	//!   char  _Padding[];
 	//!   float Window          [BlockSize];
@@ -40,7 +85,14 @@ struct Spectrice_t {
 	//!   float BfArgOld [nChan][BlockSize/2];
 	//!   float BfArgStep[nChan][BlockSize/2];
 	//! BufferData contains the original pointer returned by malloc().
+	//! The Stats* fields are only updated when the library is built with
+	//! SPECTRICE_STATS (see Spectrice_GetStats()).
 	int    BlockIdx;
+	int    WindowType;
+	int    WindowSize;
+	int    WindowHops;
+	float  SilenceLevel;
+	int    BufferSize;
 	void  *BufferData;
 	float *Window;
 	float *BfTemp;
@@ -50,14 +102,222 @@ struct Spectrice_t {
 	float *BfArg;
 	float *BfArgOld;
 	float *BfArgStep;
+	uint64_t StatsTicks[SPECTRICE_STAGE_COUNT];
+	uint64_t StatsHops;
+	int      nStatsCounters;
+	void    *StatsCounterUser;
+	Spectrice_StatsCounterFunc_t StatsCounterFunc;
+	uint64_t StatsCounters[SPECTRICE_STAGE_COUNT][SPECTRICE_STATS_MAX_COUNTERS];
+	uint64_t StatsCounterHops;
+	void    *StatsStageUser;
+	Spectrice_StatsStageFunc_t StatsStageFunc;
+	struct Spectrice_Telemetry_t *Telemetry; //! [nChan] (NULL = off)
+	void    *SpectrumUser;
+	Spectrice_SpectrumFunc_t SpectrumFunc;
+};
+
+//! Timing statistics
+//! Time[] is the time spent in each stage (in seconds), and nHops the
+//! number of hops synthesized. Counters[][nCounters] are the totals of
+//! any extra counters per stage, over the nCounterHops hops that were
+//! processed while they were installed.
+struct Spectrice_Stats_t {
+	uint64_t nHops;
+	double   Time[SPECTRICE_STAGE_COUNT];
+	int      nCounters;
+	uint64_t nCounterHops;
+	double   Counters[SPECTRICE_STAGE_COUNT][SPECTRICE_STATS_MAX_COUNTERS];
+};
+
+//! Per-channel telemetry (see Spectrice_SetTelemetry())
+//! InX are over the input samples shifted in, and OutX over the output
+//! samples shifted out (only when an output buffer is given). The spectral
+//! sums are over every line of every hop synthesized: SpecIn is the power
+//! before freezing, SpecOut the power after freezing (so SpecOut/SpecIn is
+//! the gain of the freeze, including any snapshot gain), and FreezeDist is
+//! the squared distance between the magnitudes before freezing and the
+//! frozen magnitudes (BfAbs), which falls as the input converges on the
+//! frozen spectrum.
+struct Spectrice_Telemetry_t {
+	uint32_t nInSamples;
+	uint32_t nOutSamples;
+	float    InPeak;
+	float    OutPeak;
+	double   InSumSq;
+	double   OutSumSq;
+	double   SpecInSumSq;
+	double   SpecOutSumSq;
+	double   FreezeDistSq;
 };
 
 /**************************************/
 
 int  Spectrice_Init   (struct Spectrice_t *State, int WindowType, const float *PrimingInput, const float *FreezeSnapshot);
 void Spectrice_Destroy(struct Spectrice_t *State);
+
+//! Re-initialize a state that was previously set up with Spectrice_Init().
+//! The global state fields may be changed before calling this; the buffer
+//! memory is kept if it is large enough, and the window is kept if the
+//! window type, block size and number of hops are all unchanged. This is
+//! intended for processing many files in a row without re-allocating.
+//! On failure, the state is destroyed (as with Spectrice_Init()).
+int  Spectrice_Reinit (struct Spectrice_t *State, int WindowType, const float *PrimingInput, const float *FreezeSnapshot);
+
+//! Process a block of input (Input[BlockSize*nChan], interleaved), and
+//! output a block (Output[BlockSize*nChan]; may be NULL when priming).
+//! Hops where a channel's input is silent (no sample above
+//! SilenceThreshold in magnitude, over the whole transform block) and
+//! where freezing keeps the output silent skip the transforms entirely.
+//! With SilenceThreshold = 0.0, this only happens for exact silence, and
+//! doesn't change the output; higher thresholds also drop anything below
+//! them. Hops are never skipped with FreezePhase (the phase state keeps
+//! moving even on silence), or while telemetry or a spectrum callback is
+//! installed. Denormals are flushed to zero for the duration of this and
+//! all other processing calls, as decaying tails otherwise slow down the
+//! math considerably.
+//! Only lines FreezeBinLo..FreezeBinHi-1 are frozen; all other lines pass
+//! through unchanged, without any polar conversion (so limiting the range
+//! also speeds things up in proportion). This requires
+//! 0 <= FreezeBinLo <= FreezeBinHi <= BlockSize/2, and line n is centred
+//! on a frequency of (n+0.5)*SampleRate/BlockSize. FreezeBinHi = 0 is taken
+//! to mean BlockSize/2 (and is replaced by it on initialization), so a
+//! zero-initialized range freezes all lines.
 void Spectrice_Process(struct Spectrice_t *State, float *Output, const float *Input);
 
+//! Spectrice_Process() split into its analysis and synthesis halves
+//! Spectrice_Analyze() only updates the forward overlap buffer, and
+//! Spectrice_Synthesize() only updates everything else (including
+//! BlockIdx), so the same spectra may be synthesized more than once, or
+//! by a different state (with the same nChan, BlockSize, nHops and window).
+//! Spectra[SPECTRICE_SPECTRA_SIZE] is laid out as [nChan][nHops][BlockSize/2]
+//! complex lines (packed as {Re,Im}), as output by Fourier_FFTReCenter(),
+//! followed by the peak magnitude of the input of each hop ([nChan][nHops]),
+//! so that Spectrice_Synthesize() skips exactly the same silent hops as
+//! Spectrice_Process() would.
+#define SPECTRICE_SPECTRA_SIZE(nChan, BlockSize, nHops) ((nChan)*(nHops)*((BlockSize)+1))
+void Spectrice_Analyze   (struct Spectrice_t *State, float *Spectra, const float *Input);
+void Spectrice_Synthesize(struct Spectrice_t *State, float *Output, const float *Spectra);
+
+//! Snapshot spectra
+//! Spectrice_GetSnapshotSpectrum() transforms a snapshot block (as passed
+//! to Spectrice_Init()) into the magnitude spectra used for freezing,
+//! Abs[nChan][BlockSize/2]. These only depend on nChan, BlockSize, nHops
+//! and the window type, so they may be stored and later passed on to
+//! Spectrice_SetSnapshotSpectrum(), which has the same effect as passing
+//! the snapshot to Spectrice_Init(). Priming would overwrite the spectrum,
+//! so the state must be initialized without PrimingInput, then primed
+//! afterwards with Spectrice_Process(State, NULL, PrimingInput).
+//! Spectrice_SetSnapshotSpectrum() returns 0 if FreezePhase is set (which
+//! can't be combined with a snapshot), or 1 otherwise.
+void Spectrice_GetSnapshotSpectrum(struct Spectrice_t *State, float *Abs, const float *Snapshot);
+int  Spectrice_SetSnapshotSpectrum(struct Spectrice_t *State, const float *Abs);
+
+//! Averaged snapshot spectra (Welch's method)
+//! Spectrice_AccumulateSnapshotPower() adds the power spectra (|X|^2) of a
+//! snapshot block to Power[nChan][BlockSize/2], using Scratch[BlockSize*2]
+//! for the transform. State is only read, so several threads may do this
+//! at once (each with their own Power and Scratch buffers).
+//! Spectrice_FinishSnapshotPower() then turns the sum of nFrames power
+//! spectra into RMS magnitude spectra (in-place), which may be passed to
+//! Spectrice_SetSnapshotSpectrum(). With a single frame, this matches
+//! Spectrice_GetSnapshotSpectrum() (up to rounding).
+void Spectrice_AccumulateSnapshotPower(const struct Spectrice_t *State, float *Power, const float *Snapshot, float *Scratch);
+void Spectrice_FinishSnapshotPower    (const struct Spectrice_t *State, float *Power, int nFrames);
+
+//! Get the index of the first block from which Spectrice_Process() no
+//! longer modifies the freezing state (BfAbs and phase state), or -1 if
+//! this never happens (eg. when freezing the phase step, as it accumulates
+//! forever, or with FreezeFactor < 1.0, as BfAbs keeps averaging).
+//! From this block onwards, the output only depends on the last two blocks
+//! of input, so blocks may be rendered out-of-order with Spectrice_Fork().
+int  Spectrice_GetFrozenBlockIdx(const struct Spectrice_t *State);
+
+//! Create an independent copy of State (with its own memory) that is ready
+//! to produce block BlockIdx (State itself is not modified).
+//! PrimingInput[BlockSize*2*nChan] must contain the input for blocks
+//! BlockIdx-2 and BlockIdx-1. The output of Dst is then bit-exact with
+//! what State would have produced, provided that both BlockIdx-1 and
+//! State->BlockIdx are >= Spectrice_GetFrozenBlockIdx(State) >= 0.
+//! Returns 1 on success, or 0 on failure (out of memory).
+int  Spectrice_Fork(struct Spectrice_t *Dst, const struct Spectrice_t *State, int BlockIdx, const float *PrimingInput);
+
+//! Checkpointing
+//! Spectrice_SaveState() writes everything needed to carry on processing
+//! (parameters, BlockIdx, window, overlap buffers and freezing state) to
+//! Data[Spectrice_GetStateSize(State)], as a versioned native-endian blob.
+//! Spectrice_LoadState() initializes State from such a blob instead of
+//! Spectrice_Init(), and the result then carries on exactly where the
+//! saved state left off. The buffers are stored at an aligned offset, so
+//! Data may point directly into a memory-mapped file; State always gets
+//! its own copy of them, as processing modifies them.
+//! Spectrice_LoadState() returns 1 on success, or 0 on failure (invalid or
+//! incompatible data, or out of memory).
+size_t Spectrice_GetStateSize(const struct Spectrice_t *State);
+void   Spectrice_SaveState   (const struct Spectrice_t *State, void *Data);
+int    Spectrice_LoadState   (struct Spectrice_t *State, const void *Data, size_t DataSize);
+
+//! Telemetry
+//! Spectrice_SetTelemetry() makes every following call to
+//! Spectrice_Process(), Spectrice_Analyze() and Spectrice_Synthesize() add
+//! its levels to Telemetry[nChan] (which the caller clears and reads, eg.
+//! once per block), or stops this with Telemetry = NULL. Without
+//! telemetry, there is no overhead. Telemetry is not copied by
+//! Spectrice_Fork(), is kept by Spectrice_Reinit(), and is removed by
+//! Spectrice_Init() and Spectrice_LoadState().
+void Spectrice_SetTelemetry(struct Spectrice_t *State, struct Spectrice_Telemetry_t *Telemetry);
+
+//! Spectrum capture
+//! Spectrice_SetSpectrumFunc() makes Spectrice_Process() and
+//! Spectrice_Synthesize() call Func for every hop of every channel, with
+//! the magnitudes Abs[BlockSize/2] and phases Arg[BlockSize/2] (in turns)
+//! that are about to be re-synthesized (ie. after freezing), or stops this
+//! with Func = NULL. Hops are passed in the order they are processed (all
+//! hops of a block for the first channel, then the next channel, etc.),
+//! and Hop is the index within the block. Abs and Arg are only valid
+//! during the call. As with telemetry, the callback is not copied by
+//! Spectrice_Fork(), is kept by Spectrice_Reinit(), and is removed by
+//! Spectrice_Init() and Spectrice_LoadState().
+void Spectrice_SetSpectrumFunc(struct Spectrice_t *State, Spectrice_SpectrumFunc_t Func, void *User);
+
+//! Per-stage timing statistics
+//! When the library is built with SPECTRICE_STATS defined, the stages of
+//! Spectrice_Process(), Spectrice_Analyze() and Spectrice_Synthesize() are
+//! timed (with the TSC on x86, or the monotonic clock otherwise, or if
+//! SPECTRICE_STATS_CLOCK is also defined). Timings start from zero on
+//! Spectrice_Init(), Spectrice_Reinit(), Spectrice_Fork() and
+//! Spectrice_LoadState(). Without SPECTRICE_STATS, nothing is timed and
+//! there is no overhead.
+//! Spectrice_GetStats() adds the timings of State to Stats (so that the
+//! timings of several states, such as forks, can be combined), and returns
+//! 1, or returns 0 without touching Stats if the library was built
+//! without SPECTRICE_STATS.
+//! Spectrice_SetStatsCounters() installs a reader for up to
+//! SPECTRICE_STATS_MAX_COUNTERS extra counters (such as hardware
+//! performance counters), which are then sampled at every stage boundary
+//! along with the timer. The reader is only ever called from the thread
+//! processing State, so per-thread counters must belong to that thread;
+//! for this reason, it is not copied by Spectrice_Fork(). It is kept by
+//! Spectrice_Reinit(), and removed by passing Func = NULL. Returns 1 on
+//! success, or 0 if nCounters is out of range or the library was built
+//! without SPECTRICE_STATS.
+//! Spectrice_SetStatsStageFunc() installs a callback that is called at
+//! every stage boundary (eg. to record a timeline). Unlike the counter
+//! reader, it is copied by Spectrice_Fork(), so it must be safe to call
+//! from any thread. It is kept by Spectrice_Reinit(), and removed by
+//! passing Func = NULL. Returns 1 on success, or 0 if the library was
+//! built without SPECTRICE_STATS.
+//! Spectrice_GetStageName() returns a short name for a SPECTRICE_STAGE_x.
+int         Spectrice_GetStats         (const struct Spectrice_t *State, struct Spectrice_Stats_t *Stats);
+int         Spectrice_SetStatsCounters (struct Spectrice_t *State, Spectrice_StatsCounterFunc_t Func, void *User, int nCounters);
+int         Spectrice_SetStatsStageFunc(struct Spectrice_t *State, Spectrice_StatsStageFunc_t Func, void *User);
+const char *Spectrice_GetStageName     (int Stage);
+
+//! Spectrice_GetSIMDName()
+//! Returns: The instruction set that the library was built for ("avx",
+//!          "sse" or "scalar"), with "+fma" appended when fused
+//!          multiply-add is used.
+const char *Spectrice_GetSIMDName(void);
+
 /**************************************/
 //! EOF
 /**************************************/
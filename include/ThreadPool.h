@@ -0,0 +1,95 @@
+/**************************************/
+#pragma once
+/**************************************/
+#include <pthread.h>
+/**************************************/
+
+//! Task function type
+//! WorkerIdx is the index of the worker thread running the task, which
+//! can be used to look up per-worker scratch memory.
+typedef void (*ThreadPool_TaskFunc_t)(void *User, int WorkerIdx);
+
+//! Task descriptor
+struct ThreadPool_Task_t {
+	ThreadPool_TaskFunc_t Func;
+	void *User;
+};
+
+//! Per-worker task queue
+//! Owners take tasks from the head, thieves take tasks from the tail.
+struct ThreadPool_Queue_t {
+	pthread_mutex_t Lock;
+	int Head, Tail, Capacity;
+	struct ThreadPool_Task_t *Tasks;
+};
+
+//! Internal state type
+struct ThreadPool_t {
+	int nThreads;
+	int NextQueue;
+	int nQueued;   //! Tasks submitted but not yet taken by a worker
+	int nPending;  //! Tasks submitted but not yet finished
+	int Shutdown;
+	pthread_mutex_t Lock;
+	pthread_cond_t  WorkCond;
+	pthread_cond_t  DoneCond;
+	pthread_t                 *Threads;
+	struct ThreadPool_Queue_t *Queues;
+};
+
+/**************************************/
+
+//! ThreadPool_GetCPUCount()
+//! Description: Get number of online processors.
+//! Arguments: None.
+//! Returns: Number of processors (at least 1).
+int ThreadPool_GetCPUCount(void);
+
+/**************************************/
+
+//! ThreadPool_Create(Pool, nThreads)
+//! Description: Create a work-stealing thread pool.
+//! Arguments:
+//!   Pool:     Structure to store internal state in.
+//!   nThreads: Number of worker threads (<= 0 to use ThreadPool_GetCPUCount()).
+//! Returns: On success, returns 1. On failure, returns 0.
+int ThreadPool_Create(struct ThreadPool_t *Pool, int nThreads);
+
+//! ThreadPool_Submit(Pool, Func, User)
+//! Description: Queue a task for execution.
+//! Arguments:
+//!   Pool: Structure holding the internal state.
+//!   Func: Task function.
+//!   User: Userdata to pass to Func.
+//! Returns: On success, returns 1. On failure (out of memory), returns 0.
+//! Notes:
+//!  -Tasks are distributed round-robin across the worker queues, and each
+//!   worker runs its own tasks in submission order. Idle workers steal from
+//!   the back of other queues. Submitting the most expensive tasks first
+//!   therefore keeps stragglers to a minimum.
+int ThreadPool_Submit(struct ThreadPool_t *Pool, ThreadPool_TaskFunc_t Func, void *User);
+
+//! ThreadPool_GetQueued(Pool)
+//! Description: Get the number of tasks waiting for a worker.
+//! Arguments:
+//!   Pool: Structure holding the internal state.
+//! Returns: Queue depth (which may change as soon as this returns).
+int ThreadPool_GetQueued(struct ThreadPool_t *Pool);
+
+//! ThreadPool_Wait(Pool)
+//! Description: Wait for all submitted tasks to finish.
+//! Arguments:
+//!   Pool: Structure holding the internal state.
+//! Returns: Nothing; all tasks have completed.
+void ThreadPool_Wait(struct ThreadPool_t *Pool);
+
+//! ThreadPool_Destroy(Pool)
+//! Description: Wait for all tasks, then stop worker threads.
+//! Arguments:
+//!   Pool: Structure holding the internal state.
+//! Returns: Nothing; pool is destroyed.
+void ThreadPool_Destroy(struct ThreadPool_t *Pool);
+
+/**************************************/
+//! EOF
+/**************************************/
@@ -0,0 +1,66 @@
+/**************************************/
+#pragma once
+/**************************************/
+#include <stdint.h>
+/**************************************/
+
+//! Set while recording (read-only outside of Trace.c)
+extern int Trace_Enabled;
+
+/**************************************/
+
+//! Trace_Open()
+//! Description: Start recording events, and name the calling thread "Main".
+//! Notes:
+//!  -Every thread records into its own buffers (registered on its first
+//!   event without taking any locks), so recording costs little more than
+//!   reading the clock. Buffers are kept after a thread exits.
+void Trace_Open(void);
+
+//! Trace_Close(Filename)
+//! Description: Stop recording, write all events to Filename as Chrome
+//!              trace-event JSON (for chrome://tracing or Perfetto), and
+//!              free the buffers.
+//! Returns: On success, returns 1. On failure, returns 0.
+//! Notes:
+//!  -No other thread may be recording at this point.
+int  Trace_Close(const char *Filename);
+
+//! Trace_GetTime()
+//! Returns: Monotonic timestamp in nanoseconds.
+uint64_t Trace_GetTime(void);
+
+//! Trace_Record(Name, Begin, ArgName, Arg)
+//! Description: Record a span on the calling thread, from Begin (from
+//!              Trace_GetTime()) until now. If ArgName is not NULL, Arg is
+//!              attached to the span under that name.
+//! Notes:
+//!  -Name and ArgName must be string constants (only the pointers are kept).
+void Trace_Record(const char *Name, uint64_t Begin, const char *ArgName, int Arg);
+
+//! Trace_Lap(Name, ArgName, Arg)
+//! Description: As Trace_Record(), but the span starts at the calling
+//!              thread's last lap; Name = NULL only starts a new lap.
+void Trace_Lap(const char *Name, const char *ArgName, int Arg);
+
+//! Trace_Counter(Name, Value)
+//! Description: Record the value of a counter (eg. a queue depth).
+void Trace_Counter(const char *Name, int Value);
+
+//! Trace_SetThreadName(Fmt, Idx)
+//! Description: Name the calling thread (printf-style, with Idx).
+void Trace_SetThreadName(const char *Fmt, int Idx);
+
+/**************************************/
+
+//! Inline wrappers that only cost a branch while not recording
+static inline uint64_t Trace_Begin(void) {
+	return Trace_Enabled ? Trace_GetTime() : 0;
+}
+static inline void Trace_End(const char *Name, uint64_t Begin, const char *ArgName, int Arg) {
+	if(Trace_Enabled) Trace_Record(Name, Begin, ArgName, Arg);
+}
+
+/**************************************/
+//! EOF
+/**************************************/
@@ -70,9 +70,12 @@ struct WAV_State_t {
 	uint8_t  Mode;
 	uint32_t SamplePosition;
 	uint32_t nSamplePoints;
+	uint64_t nDataBytes; //! Bytes actually read or written since opening
+	uint64_t nClipped;   //! Samples clipped when writing (PCM formats only)
 	struct WAVE_fmt_t  *fmt;
 	struct WAV_Chunk_t *dataCk;
 	struct WAV_Chunk_t *Chunks;
+	uint8_t *PackBuffer; //! Write mode only
 };
 
 /**************************************/
@@ -130,6 +133,24 @@ uint32_t WAV_ReadAsFloat(struct WAV_State_t *WavState, float *Dst, uint32_t nSmp
 //!  -The `fmt` header is copied locally.
 int WAV_OpenW(struct WAV_State_t *WavState, const char *Filename, const struct WAVE_fmt_t *fmt);
 
+//! WAV_ResumeW(WavState, Filename, fmt, nSmpPoints)
+//! Description: Re-open a WAV file that was being written by WAV_OpenW().
+//! Arguments:
+//!   WavState:   Structure to store internal state in.
+//!   Filename:   File to open.
+//!   fmt:        WAV format (must match the file).
+//!   nSmpPoints: Number of sample points to keep.
+//! Returns:
+//!   On success, returns 0. On failure, returns a value < 0, corresponding to
+//!   the error codes at the start of this file.
+//! Notes:
+//!  -This is intended for resuming after the writer was interrupted (eg. the
+//!   process was killed), so the file need not have been closed properly.
+//!  -The file is truncated after nSmpPoints, and writing continues from there.
+//!  -Fails with WAV_EINVALID if the file has fewer sample points, or doesn't
+//!   start with the header written by WAV_OpenW() for this format.
+int WAV_ResumeW(struct WAV_State_t *WavState, const char *Filename, const struct WAVE_fmt_t *fmt, uint32_t nSmpPoints);
+
 //! WAV_WriteFromFloat(WavState, Src, nSmpPoints)
 //! Description: Write samples to file from float-type buffer.
 //! Arguments:
@@ -141,6 +162,8 @@ int WAV_OpenW(struct WAV_State_t *WavState, const char *Filename, const struct W
 //!  -Internally, samples may be buffered; if the samples MUST be output, use
 //!   the WAV_Flush() function following this call.
 //!  -Channels must be interleaved as input.
+//!  -Samples outside of the range of a PCM format are clipped, and counted
+//!   in WavState->nClipped.
 int WAV_WriteFromFloat(struct WAV_State_t *WavState, const float *Src, uint32_t nSmpPoints);
 
 //! WAV_Flush(WavState)
@@ -5,6 +5,22 @@
 /**************************************/
 #pragma once
 /**************************************/
+#ifdef SPECTRICE_STATS
+# if (defined(__x86_64__) || defined(__i386__)) && !defined(SPECTRICE_STATS_CLOCK)
+#  define SPECTRICE_STATS_TSC
+#  include <x86intrin.h>
+# elif defined(_WIN32)
+#  include <windows.h>
+# else
+#  include <time.h>
+# endif
+#endif
+#if defined(__AVX__)
+# include <immintrin.h>
+#elif defined(__SSE__)
+# include <xmmintrin.h>
+#endif
+/**************************************/
 #define ABS(x) ((x) < 0 ? (-(x)) : (x))
 #define SQR(x) ((x)*(x))
 /**************************************/
@@ -15,6 +31,253 @@
 
 /**************************************/
 
+//! Approximate atan2(y,x)/2Pi (max error around 2e-6 turns)
+//! Polynomial for atan(z) on [0,1] from Abramowitz & Stegun, eq. 4.4.49.
+SPECTRICE_FORCED_INLINE float Spectrice_FastAtan2Turns(float y, float x) {
+	float ax = ABS(x), ay = ABS(y);
+	float Mx = (ax > ay) ? ax : ay;
+	float Mn = (ax > ay) ? ay : ax;
+	float z  = Mn / ((Mx > 0.0f) ? Mx : 1.0f);
+	float z2 = z*z;
+	float r  = z * (
+		+0.99997726f + z2*(
+		-0.33262347f + z2*(
+		+0.19354346f + z2*(
+		-0.11643287f + z2*(
+		+0.05265332f + z2*(
+		-0.01172120f)))))
+	) * (float)(1.0 / (2*M_PI));
+	r = (ay > ax)  ? (0.25f - r) : r;
+	r = (x < 0.0f) ? (0.5f  - r) : r;
+	r = (y < 0.0f) ? (-r)        : r;
+	return r;
+}
+
+//! Approximate sin(2Pi*x) and cos(2Pi*x) (max error around 4e-7)
+//! Reduces to [-Pi/4,+Pi/4] and uses Taylor polynomials, then rotates
+//! back into the right quadrant.
+SPECTRICE_FORCED_INLINE void Spectrice_FastSinCosTurns(float x, float *Sin, float *Cos) {
+	float q = rintf(x * 4.0f);
+	float a = (x - q*0.25f) * (float)(2*M_PI);
+	float a2 = a*a;
+	float s = a * (1.0f + a2*(-1/6.0f + a2*(1/120.0f + a2*(-1/5040.0f))));
+	float c = 1.0f + a2*(-1/2.0f + a2*(1/24.0f + a2*(-1/720.0f + a2*(1/40320.0f))));
+	int Quadrant = (int)q;
+	float t = s;
+	s = (Quadrant & 1) ? c : s;
+	c = (Quadrant & 1) ? t : c;
+	s = (Quadrant & 2)       ? -s : s;
+	c = ((Quadrant+1) & 2)   ? -c : c;
+	*Sin = s;
+	*Cos = c;
+}
+
+//! Add the sum of squares of x[N] to *SumSq, and raise *Peak to the
+//! largest magnitude in x[N]
+SPECTRICE_FORCED_INLINE void Spectrice_SumSqPeak(const float *x, int N, double *SumSq, float *Peak) {
+	int n = 0;
+	float Sum = 0.0f, Max = *Peak;
+#if defined(__AVX__)
+	__m256 vSum = _mm256_setzero_ps();
+	__m256 vMax = _mm256_setzero_ps();
+	const __m256 SignMask = _mm256_set1_ps(-0.0f);
+	for(;n+8<=N;n+=8) {
+		__m256 v = _mm256_loadu_ps(x + n);
+		vSum = _mm256_add_ps(vSum, _mm256_mul_ps(v, v));
+		vMax = _mm256_max_ps(vMax, _mm256_andnot_ps(SignMask, v));
+	}
+	__m128 s = _mm_add_ps(_mm256_castps256_ps128(vSum), _mm256_extractf128_ps(vSum, 1));
+	__m128 m = _mm_max_ps(_mm256_castps256_ps128(vMax), _mm256_extractf128_ps(vMax, 1));
+#elif defined(__SSE__)
+	__m128 s = _mm_setzero_ps();
+	__m128 m = _mm_setzero_ps();
+	const __m128 SignMask = _mm_set1_ps(-0.0f);
+	for(;n+4<=N;n+=4) {
+		__m128 v = _mm_loadu_ps(x + n);
+		s = _mm_add_ps(s, _mm_mul_ps(v, v));
+		m = _mm_max_ps(m, _mm_andnot_ps(SignMask, v));
+	}
+#endif
+#if defined(__AVX__) || defined(__SSE__)
+	{
+		float vs[4], vm[4];
+		int i;
+		_mm_storeu_ps(vs, s);
+		_mm_storeu_ps(vm, m);
+		for(i=0;i<4;i++) {
+			Sum += vs[i];
+			Max  = (vm[i] > Max) ? vm[i] : Max;
+		}
+	}
+#endif
+	for(;n<N;n++) {
+		float a = ABS(x[n]);
+		Sum += SQR(a);
+		Max  = (a > Max) ? a : Max;
+	}
+	*SumSq += Sum;
+	*Peak   = Max;
+}
+
+//! Get the largest magnitude in x[N]
+//! NOTE: With any NaN in x, this returns NaN, so that (Peak <= Threshold)
+//! always agrees with Spectrice_IsSilent().
+SPECTRICE_FORCED_INLINE float Spectrice_Peak(const float *x, int N) {
+	int n = 0;
+	int HaveNaN = 0;
+	float Max = 0.0f;
+#if defined(__AVX__)
+	__m256 vMax = _mm256_setzero_ps();
+	__m256 vNaN = _mm256_setzero_ps();
+	const __m256 SignMask = _mm256_set1_ps(-0.0f);
+	for(;n+8<=N;n+=8) {
+		__m256 v = _mm256_andnot_ps(SignMask, _mm256_loadu_ps(x + n));
+		vMax = _mm256_max_ps(vMax, v);
+		vNaN = _mm256_or_ps(vNaN, _mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+	}
+	__m128 m = _mm_max_ps(_mm256_castps256_ps128(vMax), _mm256_extractf128_ps(vMax, 1));
+	HaveNaN  = _mm256_movemask_ps(vNaN);
+#elif defined(__SSE__)
+	__m128 m    = _mm_setzero_ps();
+	__m128 vNaN = _mm_setzero_ps();
+	const __m128 SignMask = _mm_set1_ps(-0.0f);
+	for(;n+4<=N;n+=4) {
+		__m128 v = _mm_andnot_ps(SignMask, _mm_loadu_ps(x + n));
+		m    = _mm_max_ps(m, v);
+		vNaN = _mm_or_ps(vNaN, _mm_cmpunord_ps(v, v));
+	}
+	HaveNaN = _mm_movemask_ps(vNaN);
+#endif
+#if defined(__AVX__) || defined(__SSE__)
+	{
+		float vm[4];
+		int i;
+		_mm_storeu_ps(vm, m);
+		for(i=0;i<4;i++) Max = (vm[i] > Max) ? vm[i] : Max;
+	}
+#endif
+	for(;n<N;n++) {
+		float a = ABS(x[n]);
+		if(a != a) HaveNaN = 1;
+		Max = (a > Max) ? a : Max;
+	}
+	return HaveNaN ? __builtin_nanf("") : Max;
+}
+
+//! Check whether no element of x[N] is above Threshold in magnitude
+//! NOTE: NaN is never silent.
+SPECTRICE_FORCED_INLINE int Spectrice_IsSilent(const float *x, int N, float Threshold) {
+	int n = 0;
+#if defined(__AVX__)
+	const __m256 SignMask = _mm256_set1_ps(-0.0f);
+	const __m256 vThres   = _mm256_set1_ps(Threshold);
+	for(;n+8<=N;n+=8) {
+		__m256 v = _mm256_andnot_ps(SignMask, _mm256_loadu_ps(x + n));
+		if(_mm256_movemask_ps(_mm256_cmp_ps(v, vThres, _CMP_NLE_UQ))) return 0;
+	}
+#elif defined(__SSE__)
+	const __m128 SignMask = _mm_set1_ps(-0.0f);
+	const __m128 vThres   = _mm_set1_ps(Threshold);
+	for(;n+4<=N;n+=4) {
+		__m128 v = _mm_andnot_ps(SignMask, _mm_loadu_ps(x + n));
+		if(_mm_movemask_ps(_mm_cmpnle_ps(v, vThres))) return 0;
+	}
+#endif
+	for(;n<N;n++) if(!(ABS(x[n]) <= Threshold)) return 0;
+	return 1;
+}
+
+/**************************************/
+
+//! Flush denormals to zero (FTZ and DAZ), returning the previous floating
+//! point control state for Spectrice_RestoreDenormals()
+SPECTRICE_FORCED_INLINE uint32_t Spectrice_FlushDenormals(void) {
+#if defined(__SSE__)
+	uint32_t Old = _mm_getcsr();
+	_mm_setcsr(Old | 0x8040); //! FTZ (bit 15) | DAZ (bit 6)
+	return Old;
+#elif defined(__aarch64__)
+	uint64_t Old;
+	__asm__ volatile("mrs %0, fpcr" : "=r"(Old));
+	__asm__ volatile("msr fpcr, %0" : : "r"(Old | (1u << 24))); //! FZ
+	return (uint32_t)Old;
+#else
+	return 0;
+#endif
+}
+
+SPECTRICE_FORCED_INLINE void Spectrice_RestoreDenormals(uint32_t Old) {
+#if defined(__SSE__)
+	_mm_setcsr(Old);
+#elif defined(__aarch64__)
+	__asm__ volatile("msr fpcr, %0" : : "r"((uint64_t)Old));
+#else
+	(void)Old;
+#endif
+}
+
+/**************************************/
+
+//! Stage timing (see Spectrice_GetStats())
+//! SPECTRICE_STATS_BEGIN() starts timing in a function, and each
+//! SPECTRICE_STATS_STAGE() charges the time (and extra counters) since the
+//! last one to a stage, calling the stage callback at each boundary. Both
+//! compile to nothing without SPECTRICE_STATS.
+#ifdef SPECTRICE_STATS
+static inline uint64_t Spectrice_StatsTicks(void) {
+# if defined(SPECTRICE_STATS_TSC)
+	return __rdtsc();
+# elif defined(_WIN32)
+	LARGE_INTEGER Count;
+	QueryPerformanceCounter(&Count);
+	return Count.QuadPart;
+# else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000u + ts.tv_nsec;
+# endif
+}
+
+//! Timer and counter values at a stage boundary
+struct Spectrice_StatsMark_t {
+	int      Chan;
+	uint64_t Ticks;
+	uint64_t Counters[SPECTRICE_STATS_MAX_COUNTERS];
+};
+
+SPECTRICE_FORCED_INLINE void Spectrice_StatsMark(const struct Spectrice_t *State, struct Spectrice_StatsMark_t *Mark, int Chan) {
+	Mark->Chan = Chan;
+	if(State->StatsStageFunc) State->StatsStageFunc(State->StatsStageUser, -1, Chan);
+	if(State->StatsCounterFunc) State->StatsCounterFunc(State->StatsCounterUser, Mark->Counters);
+	Mark->Ticks = Spectrice_StatsTicks();
+}
+
+SPECTRICE_FORCED_INLINE void Spectrice_StatsCharge(struct Spectrice_t *State, struct Spectrice_StatsMark_t *Mark, int Stage) {
+	//! Read the timer first, so that it doesn't include the counter reads
+	uint64_t Ticks = Spectrice_StatsTicks();
+	State->StatsTicks[Stage] += Ticks - Mark->Ticks;
+	if(State->StatsStageFunc) State->StatsStageFunc(State->StatsStageUser, Stage, Mark->Chan);
+	if(State->StatsCounterFunc) {
+		int n;
+		uint64_t Counters[SPECTRICE_STATS_MAX_COUNTERS];
+		State->StatsCounterFunc(State->StatsCounterUser, Counters);
+		for(n=0;n<State->nStatsCounters;n++) {
+			State->StatsCounters[Stage][n] += Counters[n] - Mark->Counters[n];
+			Mark->Counters[n] = Counters[n];
+		}
+	}
+	if(State->StatsStageFunc || State->StatsCounterFunc) Ticks = Spectrice_StatsTicks();
+	Mark->Ticks = Ticks;
+}
+# define SPECTRICE_STATS_BEGIN(State, Chan) struct Spectrice_StatsMark_t StatsMark; Spectrice_StatsMark(State, &StatsMark, Chan)
+# define SPECTRICE_STATS_STAGE(State, Stage) Spectrice_StatsCharge(State, &StatsMark, Stage)
+#else
+# define SPECTRICE_STATS_BEGIN(State, Chan)
+# define SPECTRICE_STATS_STAGE(State, Stage)
+#endif
+
+/**************************************/
+
 #define SPECTRICE_BUFFER_ALIGNMENT 64u //! Always align memory to 64-byte boundaries (preparation for AVX-512)
 #define SPECTRICE_IS_POWEROF_2(x) (((x) & (-(x))) == (x))
 
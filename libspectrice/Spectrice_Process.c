@@ -11,117 +11,350 @@
 #include "Spectrice_Helper.h"
 /**************************************/
 
-void Spectrice_Process(struct Spectrice_t *State, float *Output, const float *Input) {
-	int n, Chan, Hop;
+//! Shift the next hop of a channel's input into the forward overlap buffer
+SPECTRICE_FORCED_INLINE void ShiftInHop(struct Spectrice_t *State, const float *Input, int Chan, int Hop) {
+	int n;
+	int nChan     = State->nChan;
+	int BlockSize = State->BlockSize;
+	int HopSize   = BlockSize / State->nHops;
+	float *BfFwdLap = State->BfFwdLap + Chan*BlockSize;
+	SPECTRICE_ASSUME_ALIGNED(BfFwdLap, SPECTRICE_BUFFER_ALIGNMENT);
+	for(n=HopSize;n<BlockSize;n++) {
+		BfFwdLap[n-HopSize] = BfFwdLap[n];
+	}
+	for(n=0;n<HopSize;n++) {
+		BfFwdLap[BlockSize-HopSize+n] = Input[(Hop*HopSize+n)*nChan+Chan];
+	}
+	if(State->Telemetry) {
+		struct Spectrice_Telemetry_t *Telemetry = &State->Telemetry[Chan];
+		Spectrice_SumSqPeak(BfFwdLap + BlockSize-HopSize, HopSize, &Telemetry->InSumSq, &Telemetry->InPeak);
+		Telemetry->nInSamples += HopSize;
+	}
+}
+
+//! Window and transform the next hop of a channel into BfDFT[BlockSize*2],
+//! then shift that hop's input into the forward overlap buffer
+SPECTRICE_FORCED_INLINE void AnalyzeHop(struct Spectrice_t *State, float *BfDFT, const float *Input, int Chan, int Hop) {
+	int n;
+	int BlockSize = State->BlockSize;
+	float *Window   = State->Window;
+	float *BfFwdLap = State->BfFwdLap + Chan*BlockSize;
+
+	//! Give some compiler hints
+	SPECTRICE_ASSUME_ALIGNED(Window,   SPECTRICE_BUFFER_ALIGNMENT);
+	SPECTRICE_ASSUME_ALIGNED(BfFwdLap, SPECTRICE_BUFFER_ALIGNMENT);
+
+	//! Apply DFT
+	SPECTRICE_STATS_BEGIN(State, Chan);
+	for(n=0;n<BlockSize/2;n++) {
+		BfDFT[            n] = Window[n] * BfFwdLap[n];
+		BfDFT[BlockSize-1-n] = Window[n] * BfFwdLap[BlockSize-1-n];
+	}
+	SPECTRICE_STATS_STAGE(State, SPECTRICE_STAGE_WINDOW);
+	Fourier_FFTReCenter(BfDFT, BfDFT+BlockSize, BlockSize);
+	SPECTRICE_STATS_STAGE(State, SPECTRICE_STAGE_FFT);
+	ShiftInHop(State, Input, Chan, Hop);
+	SPECTRICE_STATS_STAGE(State, SPECTRICE_STAGE_SHIFT);
+}
+
+//! Get the crossfade mix ratio of freezing for a hop
+SPECTRICE_FORCED_INLINE float GetMixRatio(const struct Spectrice_t *State, int Hop) {
+	float Idx = ((float)State->BlockIdx + (float)Hop / (float)State->nHops) * (float)State->BlockSize;
+	float Beg = (float)State->FreezeStart;
+	float End = (float)State->FreezePoint;
+	float MixRatio = (Idx >= End) ? 1.0f : ((Idx-Beg) / (End-Beg));
+	MixRatio *= State->FreezeFactor;
+	return (MixRatio < 0.0f) ? 0.0f : (MixRatio > 1.0f) ? 1.0f : MixRatio;
+}
+
+//! Shift one hop of output out of a channel's inverse overlap buffer
+SPECTRICE_FORCED_INLINE void ShiftOutHop(struct Spectrice_t *State, float *Output, int Chan, int Hop) {
+	int n;
 	int nChan     = State->nChan;
 	int BlockSize = State->BlockSize;
+	int HopSize   = BlockSize / State->nHops;
+	float *BfInvLap = State->BfInvLap + Chan*BlockSize;
+	SPECTRICE_ASSUME_ALIGNED(BfInvLap, SPECTRICE_BUFFER_ALIGNMENT);
+	if(Output) {
+		for(n=0;n<HopSize;n++) Output[(Hop*HopSize+n)*nChan+Chan] = BfInvLap[n];
+	}
+	for(n=HopSize;n<BlockSize;n++) {
+		BfInvLap[n-HopSize] = BfInvLap[n];
+	}
+	for(n=0;n<HopSize;n++) {
+		BfInvLap[BlockSize-HopSize+n] = 0.0f;
+	}
+}
+
+//! Apply freezing to the spectrum in BfDFT[BlockSize*2] (destroyed), then
+//! inverse transform and overlap-add, shifting out one hop of output
+//! NOTE: FastMath and Monitor should be constants, so that this is
+//! specialized (Monitor = 1 when telemetry or spectrum capture is on).
+SPECTRICE_FORCED_INLINE void SynthesizeHop(struct Spectrice_t *State, float *BfDFT, float *Output, int Chan, int Hop, int FastMath, int Monitor) {
+	int n, Range;
+	int BlockSize = State->BlockSize;
 	int nHops     = State->nHops;
+	int HopSize   = BlockSize / nHops;
+	int BinLo     = State->FreezeBinLo;
+	int BinHi     = State->FreezeBinHi;
+	float *Window    = State->Window;
+	float *BfInvLap  = State->BfInvLap  + Chan*BlockSize;
+	float *BfAbs     = State->BfAbs     + Chan*(BlockSize/2);
+	float *BfArg     = State->BfArg     + Chan*(BlockSize/2);
+	float *BfArgOld  = State->BfArgOld  + Chan*(BlockSize/2);
+	float *BfArgStep = State->BfArgStep + Chan*(BlockSize/2);
+	struct Spectrice_Telemetry_t *Telemetry = (Monitor && State->Telemetry) ? &State->Telemetry[Chan] : NULL;
 
-	//! Begin processing
-	float *Window = State->Window;
-	float *BfTemp = State->BfTemp;
-	float *BfInvLap  = State->BfInvLap;
-	float *BfFwdLap  = State->BfFwdLap;
-	float *BfAbs     = State->BfAbs;
-	float *BfArg     = State->BfArg;
-	float *BfArgOld  = State->BfArgOld;
-	float *BfArgStep = State->BfArgStep;
-	for(Chan=0;Chan<nChan;Chan++) {
-		for(Hop=0;Hop<nHops;Hop++) {
-			int HopSize = BlockSize / nHops;
-
-			//! Give some compiler hints
-			SPECTRICE_ASSUME_ALIGNED(Window,    SPECTRICE_BUFFER_ALIGNMENT);
-			SPECTRICE_ASSUME_ALIGNED(BfTemp,    SPECTRICE_BUFFER_ALIGNMENT);
-			SPECTRICE_ASSUME_ALIGNED(BfInvLap,  SPECTRICE_BUFFER_ALIGNMENT);
-			SPECTRICE_ASSUME_ALIGNED(BfFwdLap,  SPECTRICE_BUFFER_ALIGNMENT);
-			SPECTRICE_ASSUME_ALIGNED(BfAbs,     SPECTRICE_BUFFER_ALIGNMENT);
-			SPECTRICE_ASSUME_ALIGNED(BfArg,     SPECTRICE_BUFFER_ALIGNMENT);
-			SPECTRICE_ASSUME_ALIGNED(BfArgOld,  SPECTRICE_BUFFER_ALIGNMENT);
-			SPECTRICE_ASSUME_ALIGNED(BfArgStep, SPECTRICE_BUFFER_ALIGNMENT);
-
-			//! Apply DFT
-			float *BfDFT = BfTemp;
-			for(n=0;n<BlockSize/2;n++) {
-				BfDFT[            n] = Window[n] * BfFwdLap[n];
-				BfDFT[BlockSize-1-n] = Window[n] * BfFwdLap[BlockSize-1-n];
-			}
-			Fourier_FFTReCenter(BfDFT, BfDFT+BlockSize, BlockSize);
-
-			//! Get crossfade mix ratio
-			float MixRatio; {
-				float Idx = ((float)State->BlockIdx + (float)Hop / (float)nHops) * (float)BlockSize;
-				float Beg = (float)State->FreezeStart;
-				float End = (float)State->FreezePoint;
-				MixRatio  = (Idx >= End) ? 1.0f : ((Idx-Beg) / (End-Beg));
-				MixRatio *= State->FreezeFactor;
-				MixRatio  = (MixRatio < 0.0f) ? 0.0f : (MixRatio > 1.0f) ? 1.0f : MixRatio;
-			}
+	//! The second half of BfDFT isn't needed until the iDFT, so spectrum
+	//! capture stores Abs and Arg there
+	float *SpecAbs = (Monitor && State->SpectrumFunc) ? (BfDFT + BlockSize) : NULL;
+	float *SpecArg = SpecAbs + BlockSize/2;
 
-			//! Convert to Amp+Phase, apply freezing, convert back to Re+Im
-			for(n=0;n<BlockSize/2;n++) {
-				//! Convert Re,Im to Abs,Arg
-				//! NOTE: Pre-divide Arg by 2Pi to simplify things.
-				float Re  = BfDFT[n*2+0];
-				float Im  = BfDFT[n*2+1];
-				float Abs = sqrtf(SQR(Re) + SQR(Im));
-				float Arg = atan2f(Im, Re) * (float)(1.0 / (2*M_PI));
-
-				//! Freeze amplitude
-				if(State->FreezeAmp) {
-					Abs = MixRatio*BfAbs[n] + (1.0f-MixRatio)*Abs;
-					if(!State->HaveSnapshot) BfAbs[n] = Abs;
-				}
-
-				//! Freeze phase step
-				if(State->FreezePhase) {
-					float dArg = Arg - BfArgOld[n]; BfArgOld[n] = Arg;
-					dArg += (float)n / nHops;
-					dArg -= truncf(dArg);
-					dArg += 1.0f * (dArg < 0.0f);
-					dArg  = BfArgStep[n] = MixRatio*BfArgStep[n] + (1.0f-MixRatio)*dArg;
-					dArg -= (float)n / nHops;
-					BfArg[n] += dArg;
-					BfArg[n] -= truncf(BfArg[n]);
-					Arg = BfArg[n];
-				}
-
-				//! Convert back to Re,Im
-				Re = Abs * cosf(Arg * (float)(2*M_PI));
-				Im = Abs * sinf(Arg * (float)(2*M_PI));
-				BfDFT[n*2+0] = Re;
-				BfDFT[n*2+1] = Im;
-			}
+	//! Give some compiler hints
+	SPECTRICE_ASSUME_ALIGNED(Window,    SPECTRICE_BUFFER_ALIGNMENT);
+	SPECTRICE_ASSUME_ALIGNED(BfInvLap,  SPECTRICE_BUFFER_ALIGNMENT);
+	SPECTRICE_ASSUME_ALIGNED(BfAbs,     SPECTRICE_BUFFER_ALIGNMENT);
+	SPECTRICE_ASSUME_ALIGNED(BfArg,     SPECTRICE_BUFFER_ALIGNMENT);
+	SPECTRICE_ASSUME_ALIGNED(BfArgOld,  SPECTRICE_BUFFER_ALIGNMENT);
+	SPECTRICE_ASSUME_ALIGNED(BfArgStep, SPECTRICE_BUFFER_ALIGNMENT);
 
-			//! Do iDFT and accumulate
-			Fourier_iFFTReCenter(BfDFT, BfDFT+BlockSize, BlockSize);
-			for(n=0;n<BlockSize/2;n++) {
-				BfInvLap[            n] += Window[n] * BfDFT[n];
-				BfInvLap[BlockSize-1-n] += Window[n] * BfDFT[BlockSize-1-n];
-			}
+	//! Get crossfade mix ratio
+	SPECTRICE_STATS_BEGIN(State, Chan);
+	float MixRatio = GetMixRatio(State, Hop);
 
-			//! Shift samples into/out of buffers
-			if(Output) {
-				for(n=0;n<HopSize;n++) Output[(Hop*HopSize+n)*nChan+Chan] = BfInvLap[n];
+	//! Lines outside of the freezing range pass through as they are, so
+	//! only need looking at when monitoring
+	float SpecInSumSq = 0.0f, SpecOutSumSq = 0.0f, FreezeDistSq = 0.0f;
+	if(Monitor) for(Range=0;Range<2;Range++) {
+		int Beg = Range ? BinHi : 0;
+		int End = Range ? BlockSize/2 : BinLo;
+		for(n=Beg;n<End;n++) {
+			float Re  = BfDFT[n*2+0];
+			float Im  = BfDFT[n*2+1];
+			float AbsSq = SQR(Re) + SQR(Im);
+			if(Telemetry) {
+				SpecInSumSq  += AbsSq;
+				SpecOutSumSq += AbsSq;
 			}
-			for(n=HopSize;n<BlockSize;n++) {
-				BfFwdLap[n-HopSize] = BfFwdLap[n];
-				BfInvLap[n-HopSize] = BfInvLap[n];
+			if(SpecAbs) {
+				SpecAbs[n] = sqrtf(AbsSq);
+				if(FastMath) SpecArg[n] = Spectrice_FastAtan2Turns(Im, Re);
+				else         SpecArg[n] = atan2f(Im, Re) * (float)(1.0 / (2*M_PI));
 			}
-			for(n=0;n<HopSize;n++) {
-				BfFwdLap[BlockSize-HopSize+n] = Input[(Hop*HopSize+n)*nChan+Chan];
-				BfInvLap[BlockSize-HopSize+n] = 0.0f;
+		}
+	}
+
+	//! Convert to Amp+Phase, apply freezing, convert back to Re+Im
+	for(n=BinLo;n<BinHi;n++) {
+		//! Convert Re,Im to Abs,Arg
+		//! NOTE: Pre-divide Arg by 2Pi to simplify things.
+		float Re  = BfDFT[n*2+0];
+		float Im  = BfDFT[n*2+1];
+		float Abs = sqrtf(SQR(Re) + SQR(Im));
+		float Arg;
+		if(FastMath) Arg = Spectrice_FastAtan2Turns(Im, Re);
+		else         Arg = atan2f(Im, Re) * (float)(1.0 / (2*M_PI));
+		if(Telemetry) {
+			SpecInSumSq  += SQR(Abs);
+			FreezeDistSq += SQR(Abs - BfAbs[n]);
+		}
+
+		//! Freeze amplitude
+		if(State->FreezeAmp) {
+			Abs = MixRatio*BfAbs[n] + (1.0f-MixRatio)*Abs;
+			if(!State->HaveSnapshot) BfAbs[n] = Abs;
+		}
+		if(Telemetry) SpecOutSumSq += SQR(Abs);
+
+		//! Freeze phase step
+		if(State->FreezePhase) {
+			float dArg = Arg - BfArgOld[n]; BfArgOld[n] = Arg;
+			dArg += (float)n / nHops;
+			dArg -= truncf(dArg);
+			dArg += 1.0f * (dArg < 0.0f);
+			dArg  = BfArgStep[n] = MixRatio*BfArgStep[n] + (1.0f-MixRatio)*dArg;
+			dArg -= (float)n / nHops;
+			BfArg[n] += dArg;
+			BfArg[n] -= truncf(BfArg[n]);
+			Arg = BfArg[n];
+		}
+
+		//! Convert back to Re,Im
+		if(FastMath) {
+			float Sin, Cos;
+			Spectrice_FastSinCosTurns(Arg, &Sin, &Cos);
+			Re = Abs * Cos;
+			Im = Abs * Sin;
+		} else {
+			Re = Abs * cosf(Arg * (float)(2*M_PI));
+			Im = Abs * sinf(Arg * (float)(2*M_PI));
+		}
+		BfDFT[n*2+0] = Re;
+		BfDFT[n*2+1] = Im;
+		if(SpecAbs) {
+			SpecAbs[n] = Abs;
+			SpecArg[n] = Arg;
+		}
+	}
+	if(Telemetry) {
+		Telemetry->SpecInSumSq  += SpecInSumSq;
+		Telemetry->SpecOutSumSq += SpecOutSumSq;
+		Telemetry->FreezeDistSq += FreezeDistSq;
+	}
+	if(SpecAbs) State->SpectrumFunc(State->SpectrumUser, Chan, Hop, SpecAbs, SpecArg);
+
+	//! Do iDFT and accumulate
+	SPECTRICE_STATS_STAGE(State, SPECTRICE_STAGE_POLAR);
+	Fourier_iFFTReCenter(BfDFT, BfDFT+BlockSize, BlockSize);
+	SPECTRICE_STATS_STAGE(State, SPECTRICE_STAGE_IFFT);
+	for(n=0;n<BlockSize/2;n++) {
+		BfInvLap[            n] += Window[n] * BfDFT[n];
+		BfInvLap[BlockSize-1-n] += Window[n] * BfDFT[BlockSize-1-n];
+	}
+	SPECTRICE_STATS_STAGE(State, SPECTRICE_STAGE_OVERLAP);
+
+	//! Shift samples out of buffer
+	if(Output && Telemetry) {
+		Spectrice_SumSqPeak(BfInvLap, HopSize, &Telemetry->OutSumSq, &Telemetry->OutPeak);
+		Telemetry->nOutSamples += HopSize;
+	}
+	ShiftOutHop(State, Output, Chan, Hop);
+	SPECTRICE_STATS_STAGE(State, SPECTRICE_STAGE_SHIFT);
+#ifdef SPECTRICE_STATS
+	State->StatsHops++;
+	if(State->StatsCounterFunc) State->StatsCounterHops++;
+#endif
+}
+
+//! Dispatch to the specialization of SynthesizeHop() for State
+SPECTRICE_FORCED_INLINE void SynthesizeHopAny(struct Spectrice_t *State, float *BfDFT, float *Output, int Chan, int Hop) {
+	if(State->Telemetry || State->SpectrumFunc) {
+		if(State->FastMath) SynthesizeHop(State, BfDFT, Output, Chan, Hop, 1, 1);
+		else                SynthesizeHop(State, BfDFT, Output, Chan, Hop, 0, 1);
+	} else {
+		if(State->FastMath) SynthesizeHop(State, BfDFT, Output, Chan, Hop, 1, 0);
+		else                SynthesizeHop(State, BfDFT, Output, Chan, Hop, 0, 0);
+	}
+}
+
+/**************************************/
+
+//! Check whether skipping is possible at all
+//! NOTE: With FreezePhase, even silent hops move the phase state along
+//! (using the phase of each zero line, which depends on the signs of the
+//! zeros coming out of the transform), so those can't be skipped.
+SPECTRICE_FORCED_INLINE int CanSkipHops(const struct Spectrice_t *State) {
+	return !State->FreezePhase && !State->Telemetry && !State->SpectrumFunc;
+}
+
+//! Check whether freezing keeps a hop of a channel silent, given silent
+//! input (ie. the frozen magnitudes MixRatio*BfAbs are all silent; lines
+//! outside of the freezing range just pass the silence through)
+SPECTRICE_FORCED_INLINE int IsFreezeSilent(const struct Spectrice_t *State, int Chan, float MixRatio) {
+	int Bins  = State->BlockSize / 2;
+	int BinLo = State->FreezeBinLo;
+	if(!State->FreezeAmp || MixRatio == 0.0f) return 1;
+	return Spectrice_IsSilent(State->BfAbs + Chan*Bins + BinLo, State->FreezeBinHi - BinLo, State->SilenceLevel / MixRatio);
+}
+
+//! Synthesize a silent hop of a channel without any transforms
+//! This leaves the state exactly as SynthesizeHop() would with a spectrum
+//! of zeros (when CanSkipHops() and IsFreezeSilent() are true).
+SPECTRICE_FORCED_INLINE void SkipHop(struct Spectrice_t *State, float *Output, int Chan, int Hop, float MixRatio) {
+	int n;
+	int Bins = State->BlockSize / 2;
+	float *BfAbs = State->BfAbs + Chan*Bins;
+	SPECTRICE_ASSUME_ALIGNED(BfAbs, SPECTRICE_BUFFER_ALIGNMENT);
+	SPECTRICE_STATS_BEGIN(State, Chan);
+	if(State->FreezeAmp && !State->HaveSnapshot && MixRatio != 1.0f) {
+		for(n=State->FreezeBinLo;n<State->FreezeBinHi;n++) BfAbs[n] *= MixRatio;
+	}
+	ShiftOutHop(State, Output, Chan, Hop);
+	SPECTRICE_STATS_STAGE(State, SPECTRICE_STAGE_SHIFT);
+#ifdef SPECTRICE_STATS
+	State->StatsHops++;
+	if(State->StatsCounterFunc) State->StatsCounterHops++;
+#endif
+}
+
+/**************************************/
+
+void Spectrice_Process(struct Spectrice_t *State, float *Output, const float *Input) {
+	int Chan, Hop;
+	int nChan     = State->nChan;
+	int BlockSize = State->BlockSize;
+	int nHops     = State->nHops;
+	int CanSkip   = CanSkipHops(State);
+	float *BfTemp = State->BfTemp;
+	SPECTRICE_ASSUME_ALIGNED(BfTemp, SPECTRICE_BUFFER_ALIGNMENT);
+	uint32_t FPState = Spectrice_FlushDenormals();
+	for(Chan=0;Chan<nChan;Chan++) for(Hop=0;Hop<nHops;Hop++) {
+		//! Skip the transforms if the whole block about to be analyzed
+		//! is silent, and the output will be as well
+		if(CanSkip && Spectrice_IsSilent(State->BfFwdLap + Chan*BlockSize, BlockSize, State->SilenceThreshold)) {
+			float MixRatio = GetMixRatio(State, Hop);
+			if(IsFreezeSilent(State, Chan, MixRatio)) {
+				ShiftInHop(State, Input, Chan, Hop);
+				SkipHop(State, Output, Chan, Hop, MixRatio);
+				continue;
 			}
 		}
+		AnalyzeHop(State, BfTemp, Input, Chan, Hop);
+		SynthesizeHopAny(State, BfTemp, Output, Chan, Hop);
+	}
+	Spectrice_RestoreDenormals(FPState);
+	State->BlockIdx++;
+}
+
+/**************************************/
 
-		//! Next channel
-		BfInvLap  += BlockSize;
-		BfFwdLap  += BlockSize;
-		BfAbs     += BlockSize/2;
-		BfArg     += BlockSize/2;
-		BfArgOld  += BlockSize/2;
-		BfArgStep += BlockSize/2;
+void Spectrice_Analyze(struct Spectrice_t *State, float *Spectra, const float *Input) {
+	int n, Chan, Hop;
+	int nChan     = State->nChan;
+	int BlockSize = State->BlockSize;
+	int nHops     = State->nHops;
+	float *BfTemp = State->BfTemp;
+	SPECTRICE_ASSUME_ALIGNED(BfTemp, SPECTRICE_BUFFER_ALIGNMENT);
+	float *Peaks  = Spectra + nChan*nHops*BlockSize;
+	uint32_t FPState = Spectrice_FlushDenormals();
+	for(Chan=0;Chan<nChan;Chan++) for(Hop=0;Hop<nHops;Hop++) {
+		//! Keep the peak of the input about to be analyzed, so that silence
+		//! can be judged exactly as Spectrice_Process() does
+		*Peaks++ = Spectrice_Peak(State->BfFwdLap + Chan*BlockSize, BlockSize);
+		AnalyzeHop(State, BfTemp, Input, Chan, Hop);
+		for(n=0;n<BlockSize;n++) Spectra[n] = BfTemp[n];
+		Spectra += BlockSize;
+	}
+	Spectrice_RestoreDenormals(FPState);
+}
+
+void Spectrice_Synthesize(struct Spectrice_t *State, float *Output, const float *Spectra) {
+	int n, Chan, Hop;
+	int nChan     = State->nChan;
+	int BlockSize = State->BlockSize;
+	int nHops     = State->nHops;
+	int CanSkip   = CanSkipHops(State);
+	float *BfTemp = State->BfTemp;
+	const float *Peaks = Spectra + nChan*nHops*BlockSize;
+	SPECTRICE_ASSUME_ALIGNED(BfTemp, SPECTRICE_BUFFER_ALIGNMENT);
+	uint32_t FPState = Spectrice_FlushDenormals();
+	for(Chan=0;Chan<nChan;Chan++) for(Hop=0;Hop<nHops;Hop++) {
+		//! Silence is judged from the input peak that came with the spectra
+		//! NOTE: NaN peaks compare false, so they are never silent.
+		float Peak = *Peaks++;
+		if(CanSkip && Peak <= State->SilenceThreshold) {
+			float MixRatio = GetMixRatio(State, Hop);
+			if(IsFreezeSilent(State, Chan, MixRatio)) {
+				SkipHop(State, Output, Chan, Hop, MixRatio);
+				Spectra += BlockSize;
+				continue;
+			}
+		}
+		for(n=0;n<BlockSize;n++) BfTemp[n] = Spectra[n];
+		SynthesizeHopAny(State, BfTemp, Output, Chan, Hop);
+		Spectra += BlockSize;
 	}
+	Spectrice_RestoreDenormals(FPState);
 	State->BlockIdx++;
 }
 
@@ -6,6 +6,16 @@
 #include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#ifdef SPECTRICE_STATS
+# include <time.h>
+#endif
+/**************************************/
+#if defined(__AVX__)
+# include <immintrin.h>
+#elif defined(__SSE__)
+# include <xmmintrin.h>
+#endif
 /**************************************/
 #include "Fourier.h"
 #include "Spectrice.h"
@@ -19,12 +29,37 @@
 
 /**************************************/
 
+//! Kaiser-Bessel-derived window parameter
+#define KBD_ALPHA 4.0
+
+//! Zeroth-order modified Bessel function of the first kind
+static double BesselI0(double x) {
+	int k;
+	double Sum = 1.0, Term = 1.0;
+	for(k=1;Term > Sum*1.0e-17;k++) {
+		Term *= SQR(x / (2*k));
+		Sum  += Term;
+	}
+	return Sum;
+}
+
+//! Kaiser window of length Len, at point i
+static double KaiserKernel(int i, int Len) {
+	double t = 2.0*i / (Len-1) - 1.0;
+	return BesselI0(M_PI*KBD_ALPHA * sqrt(1.0 - SQR(t)));
+}
+
 /*!
+  The window is applied on both analysis and synthesis, so it is w^2 that
+  must sum to a constant over the hops; for a cosine-sum window, this
+  holds when nHops is more than twice its highest harmonic.
   -Sine:     Valid for nHops >= 2.
   -Hann:     Valid for nHops >= 3.
   -Hamming:  Valid for nHops >= 3.
   -Blackman: Valid for nHops >= 5.
   -Nuttall:  Valid for nHops >= 7.
+  -SqrtCos:  Valid for nHops >= 4.
+  -KBD:      Valid for nHops >= 2.
 !*/
 static int InitXformWindow(float *w, int N, int nHops, int Type) {
 	int n;
@@ -90,6 +125,46 @@ static int InitXformWindow(float *w, int N, int nHops, int Type) {
 			}
 		} break;
 
+		//! Square root of a 4-term cosine-sum, with the coefficients chosen
+		//! for the lowest sidelobes of the root (rather than of the sum, as
+		//! with Nuttall), and the sum going to zero at the edges so that
+		//! the sidelobes fall off at 12dB/octave. Sidelobes are at -55dB,
+		//! against -31dB for Hann and -43dB for Hamming (whose sidelobes
+		//! don't fall off at all) at the same number of hops.
+		//! NOTE: Evaluated in double precision and clipped at 0.0, as the
+		//! sum cancels down to nearly nothing at the edges.
+		case SPECTRICE_WINDOW_TYPE_SQRTCOS: {
+			if(nHops < 4) return 0;
+			for(n=0;n<N/2;n++) {
+				double x = (
+					+0.3324
+					-0.4769*cos((n+0.5) * (2*M_PI) / N)
+					+0.1676*cos((n+0.5) * (4*M_PI) / N)
+					-0.0231*cos((n+0.5) * (6*M_PI) / N)
+				);
+				w[n] = (float)sqrt((x > 0.0) ? x : 0.0);
+				Sum += SQR(w[n]);
+			}
+		} break;
+
+		//! Kaiser-Bessel-derived window, generalized to any hop size: w^2
+		//! is a Kaiser window of length N-HopSize+1 smeared by a moving sum
+		//! over HopSize samples, which makes it sum to a constant over the
+		//! hops by construction. The window gets smoother as the hops get
+		//! smaller (sidelobes at about -44dB for 4 hops, -51dB for 8 hops).
+		case SPECTRICE_WINDOW_TYPE_KBD: {
+			if(nHops < 2) return 0;
+			int    HopSize = N / nHops;
+			int    KernLen = N - HopSize + 1;
+			double MovSum  = 0.0;
+			for(n=0;n<N/2;n++) {
+				MovSum += KaiserKernel(n, KernLen);
+				if(n >= HopSize) MovSum -= KaiserKernel(n-HopSize, KernLen);
+				w[n] = (float)sqrt(MovSum);
+				Sum += SQR(w[n]);
+			}
+		} break;
+
 		default: return 0;
 	}
 	float Norm = sqrtf(1.0f / (Sum * nHops));
@@ -99,27 +174,33 @@ static int InitXformWindow(float *w, int N, int nHops, int Type) {
 
 /**************************************/
 
-int Spectrice_Init(struct Spectrice_t *State, int WindowType, const float *PrimingInput, const float *FreezeSnapshot) {
-	int n;
-
-	//! Clear anything that is needed for EncoderState_Destroy()
-	State->BufferData = NULL;
+//! Buffer layout (byte offsets from the aligned start of the buffer)
+struct BufferLayout_t {
+	uintptr_t Window;
+	uintptr_t BfTemp;
+	uintptr_t BfInvLap;
+	uintptr_t BfFwdLap;
+	uintptr_t BfAbs;
+	uintptr_t BfArg;
+	uintptr_t BfArgOld;
+	uintptr_t BfArgStep;
+	int       Size;
+};
 
-	//! Verify parameters
-	//! NOTE: We can't combine FreezePhase with a snapshot. It's technically
-	//! possible to do so, but this will be left for a future update.
+//! Verify parameters and get the buffer layout
+//! Returns 1 on success, or 0 if the parameters are invalid.
+static int GetBufferLayout(struct BufferLayout_t *Layout, const struct Spectrice_t *State) {
 	int nChan      = State->nChan;
 	int BlockSize  = State->BlockSize;
 	int nHops      = State->nHops;
 	if(nChan     < MIN_CHANS || nChan     > MAX_CHANS) return 0;
 	if(BlockSize < MIN_BANDS || BlockSize > MAX_BANDS) return 0;
 	if(nHops     < 2         || nHops     > BlockSize) return 0;
-	if(!SPECTRICE_IS_POWEROF_2(BlockSize) || !SPECTRICE_IS_POWEROF_2(nHops)) return 0;
-	if(FreezeSnapshot && State->FreezePhase) return 0;
+	if(!Fourier_IsFFTSize(BlockSize) || BlockSize % nHops != 0) return 0;
+	if(State->FreezeBinLo < 0 || State->FreezeBinLo > State->FreezeBinHi || State->FreezeBinHi > BlockSize/2) return 0;
 
-	//! Get buffer offsets and allocation size
 	int AllocSize = 0;
-#define CREATE_BUFFER(Name, Sz) uintptr_t Name##_Offs = AllocSize; AllocSize += (Sz)
+#define CREATE_BUFFER(Name, Sz) Layout->Name = AllocSize; AllocSize += (Sz)
 	CREATE_BUFFER(Window,    (sizeof(float) * (BlockSize/2)) * 1);
 	CREATE_BUFFER(BfTemp,    (sizeof(float) * (BlockSize  )) * 2);
 	CREATE_BUFFER(BfInvLap,  (sizeof(float) * (BlockSize  )) * nChan);
@@ -129,28 +210,111 @@ int Spectrice_Init(struct Spectrice_t *State, int WindowType, const float *Primi
 	CREATE_BUFFER(BfArgOld,  (sizeof(float) * (BlockSize/2)) * (State->FreezePhase ? nChan : 0));
 	CREATE_BUFFER(BfArgStep, (sizeof(float) * (BlockSize/2)) * (State->FreezePhase ? nChan : 0));
 #undef CREATE_BUFFER
+	Layout->Size = AllocSize;
+	return 1;
+}
 
-	//! Allocate buffer space
-	char *Buf = State->BufferData = malloc(SPECTRICE_BUFFER_ALIGNMENT-1 + AllocSize);
-	if(!Buf) return 0;
+//! Point the state's buffers into Buf (which must be aligned)
+static void SetBufferPointers(struct Spectrice_t *State, char *Buf, const struct BufferLayout_t *Layout) {
+	State->Window    = (float*)(Buf + Layout->Window);
+	State->BfTemp    = (float*)(Buf + Layout->BfTemp);
+	State->BfInvLap  = (float*)(Buf + Layout->BfInvLap);
+	State->BfFwdLap  = (float*)(Buf + Layout->BfFwdLap);
+	State->BfAbs     = (float*)(Buf + Layout->BfAbs);
+	State->BfArg     = (float*)(Buf + Layout->BfArg);
+	State->BfArgOld  = (float*)(Buf + Layout->BfArgOld);
+	State->BfArgStep = (float*)(Buf + Layout->BfArgStep);
+}
+
+//! Set SilenceLevel from SilenceThreshold
+//! A block of input that never exceeds SilenceThreshold can't give a line
+//! with a magnitude above SilenceThreshold times the sum of the window.
+static void SetSilenceLevel(struct Spectrice_t *State) {
+	int n;
+	float Sum = 0.0f;
+	for(n=0;n<State->BlockSize/2;n++) Sum += State->Window[n];
+	State->SilenceLevel = State->SilenceThreshold * 2.0f*Sum;
+}
+
+/**************************************/
+
+//! Clear timing statistics (but not the counter reader)
+static void ResetStats(struct Spectrice_t *State) {
+	int Stage, n;
+	for(Stage=0;Stage<SPECTRICE_STAGE_COUNT;Stage++) {
+		State->StatsTicks[Stage] = 0;
+		for(n=0;n<SPECTRICE_STATS_MAX_COUNTERS;n++) State->StatsCounters[Stage][n] = 0;
+	}
+	State->StatsHops        = 0;
+	State->StatsCounterHops = 0;
+}
+
+//! Remove the counter reader
+static void ClearStatsCounters(struct Spectrice_t *State) {
+	State->nStatsCounters   = 0;
+	State->StatsCounterUser = NULL;
+	State->StatsCounterFunc = NULL;
+}
+
+//! Remove the counter reader and stage callback
+static void ClearStatsHooks(struct Spectrice_t *State) {
+	ClearStatsCounters(State);
+	State->StatsStageUser = NULL;
+	State->StatsStageFunc = NULL;
+}
+
+static int InitState(struct Spectrice_t *State, int WindowType, const float *PrimingInput, const float *FreezeSnapshot, int Reuse) {
+	int n;
+
+	//! Verify parameters and get buffer offsets and allocation size
+	//! NOTE: We can't combine FreezePhase with a snapshot. It's technically
+	//! possible to do so, but this will be left for a future update.
+	//! NOTE: FreezeBinHi = 0 means all lines (see Spectrice_Process()).
+	struct BufferLayout_t Layout;
+	if(State->FreezeBinHi == 0) State->FreezeBinHi = State->BlockSize/2;
+	if(!GetBufferLayout(&Layout, State)) return 0;
+	if(FreezeSnapshot && State->FreezePhase) return 0;
+	int nChan      = State->nChan;
+	int BlockSize  = State->BlockSize;
+	int nHops      = State->nHops;
+	int AllocSize  = Layout.Size;
+
+	//! Allocate buffer space, or re-use the old buffer if it's big enough.
+	//! The window is always placed first, so it survives re-use as long as
+	//! it was built for the same parameters.
+	int WindowValid = 0;
+	char *Buf = Reuse ? State->BufferData : NULL;
+	if(Buf && State->BufferSize >= AllocSize) {
+		WindowValid = (
+			State->WindowType == WindowType &&
+			State->WindowSize == BlockSize  &&
+			State->WindowHops == nHops
+		);
+	} else {
+		free(Buf);
+		Buf = State->BufferData = malloc(SPECTRICE_BUFFER_ALIGNMENT-1 + AllocSize);
+		if(!Buf) return 0;
+		State->BufferSize = AllocSize;
+	}
 
 	//! Initialize pointers
 	Buf += (-(uintptr_t)Buf) & (SPECTRICE_BUFFER_ALIGNMENT-1);
-	State->Window    = (float*)(Buf + Window_Offs);
-	State->BfTemp    = (float*)(Buf + BfTemp_Offs);
-	State->BfInvLap  = (float*)(Buf + BfInvLap_Offs);
-	State->BfFwdLap  = (float*)(Buf + BfFwdLap_Offs);
-	State->BfAbs     = (float*)(Buf + BfAbs_Offs);
-	State->BfArg     = (float*)(Buf + BfArg_Offs);
-	State->BfArgOld  = (float*)(Buf + BfArgOld_Offs);
-	State->BfArgStep = (float*)(Buf + BfArgStep_Offs);
+	SetBufferPointers(State, Buf, &Layout);
 
 	//! Set initial state
 	State->BlockIdx = 0;
-	if(!InitXformWindow(State->Window, BlockSize, nHops, WindowType)) {
-		Spectrice_Destroy(State);
-		return 0;
+	ResetStats(State);
+	if(!WindowValid) {
+		State->WindowType = -1;
+		if(!InitXformWindow(State->Window, BlockSize, nHops, WindowType)) {
+			Spectrice_Destroy(State);
+			return 0;
+		}
+		State->WindowType = WindowType;
+		State->WindowSize = BlockSize;
+		State->WindowHops = nHops;
 	}
+	SetSilenceLevel(State);
 	if(State->FreezePhase) {
 		for(n=0;n<(BlockSize/2)*nChan;n++) State->BfArg    [n] = 0.0f;
 		for(n=0;n<(BlockSize/2)*nChan;n++) State->BfArgOld [n] = 0.0f;
@@ -159,24 +323,7 @@ int Spectrice_Init(struct Spectrice_t *State, int WindowType, const float *Primi
 
 	//! Transform the "snapshot" window for freezing
 	if(FreezeSnapshot) {
-		int Chan;
-		float *BfAbs = State->BfAbs;
-		float *BfDFT = State->BfTemp;
-		const float *Window = State->Window;
-		for(Chan=0;Chan<nChan;Chan++) {
-			for(n=0;n<BlockSize/2;n++) {
-				BfDFT[            n] = Window[n] * FreezeSnapshot[(            n)*nChan + Chan];
-				BfDFT[BlockSize-1-n] = Window[n] * FreezeSnapshot[(BlockSize-1-n)*nChan + Chan];
-			}
-			Fourier_FFTReCenter(BfDFT, BfDFT+BlockSize, BlockSize);
-			for(n=0;n<BlockSize/2;n++) {
-				float Re  = BfDFT[n*2+0];
-				float Im  = BfDFT[n*2+1];
-				float Abs = sqrtf(SQR(Re) + SQR(Im));
-				BfAbs[n] = Abs;
-			}
-			BfAbs += BlockSize/2;
-		}
+		Spectrice_GetSnapshotSpectrum(State, State->BfAbs, FreezeSnapshot);
 		State->HaveSnapshot = 1;
 	} else {
 		float *BfAbs = State->BfAbs;
@@ -195,9 +342,425 @@ int Spectrice_Init(struct Spectrice_t *State, int WindowType, const float *Primi
 
 /**************************************/
 
+int Spectrice_Init(struct Spectrice_t *State, int WindowType, const float *PrimingInput, const float *FreezeSnapshot) {
+	//! Clear anything that is needed for Spectrice_Destroy(), and anything
+	//! that InitState() doesn't set up
+	State->BufferData = NULL;
+	ClearStatsHooks(State);
+	State->Telemetry    = NULL;
+	State->SpectrumFunc = NULL;
+	return InitState(State, WindowType, PrimingInput, FreezeSnapshot, 0);
+}
+
+int Spectrice_Reinit(struct Spectrice_t *State, int WindowType, const float *PrimingInput, const float *FreezeSnapshot) {
+	if(!InitState(State, WindowType, PrimingInput, FreezeSnapshot, 1)) {
+		Spectrice_Destroy(State);
+		return 0;
+	}
+	return 1;
+}
+
+/**************************************/
+
+void Spectrice_GetSnapshotSpectrum(struct Spectrice_t *State, float *Abs, const float *Snapshot) {
+	int n, Chan;
+	int nChan     = State->nChan;
+	int BlockSize = State->BlockSize;
+	float *BfDFT = State->BfTemp;
+	const float *Window = State->Window;
+	for(Chan=0;Chan<nChan;Chan++) {
+		for(n=0;n<BlockSize/2;n++) {
+			BfDFT[            n] = Window[n] * Snapshot[(            n)*nChan + Chan];
+			BfDFT[BlockSize-1-n] = Window[n] * Snapshot[(BlockSize-1-n)*nChan + Chan];
+		}
+		Fourier_FFTReCenter(BfDFT, BfDFT+BlockSize, BlockSize);
+		for(n=0;n<BlockSize/2;n++) {
+			float Re = BfDFT[n*2+0];
+			float Im = BfDFT[n*2+1];
+			Abs[n] = sqrtf(SQR(Re) + SQR(Im));
+		}
+		Abs += BlockSize/2;
+	}
+}
+
+//! Power[n] += Re[n]^2 + Im[n]^2, for N complex lines packed as {Re,Im}
+//! NOTE: N must be a multiple of 8 (always true, as BlockSize >= 16).
+static void AccumulatePower(float *Power, const float *BfDFT, int N) {
+	int n;
+#if defined(__AVX__)
+	for(n=0;n<N;n+=8) {
+		__m256 l  = _mm256_loadu_ps(BfDFT + n*2);
+		__m256 h  = _mm256_loadu_ps(BfDFT + n*2 + 8);
+		__m256 a  = _mm256_permute2f128_ps(l, h, 0x20);
+		__m256 b  = _mm256_permute2f128_ps(l, h, 0x31);
+		__m256 Re = _mm256_shuffle_ps(a, b, 0x88);
+		__m256 Im = _mm256_shuffle_ps(a, b, 0xDD);
+		__m256 p  = _mm256_loadu_ps(Power + n);
+		p = _mm256_add_ps(p, _mm256_add_ps(_mm256_mul_ps(Re, Re), _mm256_mul_ps(Im, Im)));
+		_mm256_storeu_ps(Power + n, p);
+	}
+#elif defined(__SSE__)
+	for(n=0;n<N;n+=4) {
+		__m128 l  = _mm_loadu_ps(BfDFT + n*2);
+		__m128 h  = _mm_loadu_ps(BfDFT + n*2 + 4);
+		__m128 Re = _mm_shuffle_ps(l, h, 0x88);
+		__m128 Im = _mm_shuffle_ps(l, h, 0xDD);
+		__m128 p  = _mm_loadu_ps(Power + n);
+		p = _mm_add_ps(p, _mm_add_ps(_mm_mul_ps(Re, Re), _mm_mul_ps(Im, Im)));
+		_mm_storeu_ps(Power + n, p);
+	}
+#else
+	for(n=0;n<N;n++) {
+		float Re = BfDFT[n*2+0];
+		float Im = BfDFT[n*2+1];
+		Power[n] += SQR(Re) + SQR(Im);
+	}
+#endif
+}
+
+void Spectrice_AccumulateSnapshotPower(const struct Spectrice_t *State, float *Power, const float *Snapshot, float *Scratch) {
+	int n, Chan;
+	int nChan     = State->nChan;
+	int BlockSize = State->BlockSize;
+	const float *Window = State->Window;
+	for(Chan=0;Chan<nChan;Chan++) {
+		for(n=0;n<BlockSize/2;n++) {
+			Scratch[            n] = Window[n] * Snapshot[(            n)*nChan + Chan];
+			Scratch[BlockSize-1-n] = Window[n] * Snapshot[(BlockSize-1-n)*nChan + Chan];
+		}
+		Fourier_FFTReCenter(Scratch, Scratch+BlockSize, BlockSize);
+		AccumulatePower(Power, Scratch, BlockSize/2);
+		Power += BlockSize/2;
+	}
+}
+
+void Spectrice_FinishSnapshotPower(const struct Spectrice_t *State, float *Power, int nFrames) {
+	int n;
+	int N = (State->BlockSize/2) * State->nChan;
+	float Scale = 1.0f / nFrames;
+	for(n=0;n<N;n++) Power[n] = sqrtf(Power[n] * Scale);
+}
+
+int Spectrice_SetSnapshotSpectrum(struct Spectrice_t *State, const float *Abs) {
+	//! Same restriction as in InitState()
+	if(State->FreezePhase) return 0;
+	memcpy(State->BfAbs, Abs, sizeof(float) * (State->BlockSize/2) * State->nChan);
+	State->HaveSnapshot = 1;
+	return 1;
+}
+
+/**************************************/
+
+int Spectrice_GetFrozenBlockIdx(const struct Spectrice_t *State) {
+	//! Phase step accumulates into BfArg on every hop, so never frozen
+	if(State->FreezePhase) return -1;
+
+	//! If BfAbs is never read, or is never written, or is completely
+	//! overwritten on every hop, then there's no state to speak of
+	if(!State->FreezeAmp || State->HaveSnapshot || State->FreezeFactor == 0.0f) return 0;
+	if(State->FreezeBinLo == State->FreezeBinHi) return 0;
+
+	//! Otherwise, BfAbs is only left alone once MixRatio reaches 1.0, which
+	//! happens on the first block that starts at or after FreezePoint
+	if(State->FreezeFactor < 1.0f) return -1;
+	int BlockSize = State->BlockSize;
+	int Idx = (State->FreezePoint + BlockSize-1) / BlockSize;
+	return (Idx < 0) ? 0 : Idx;
+}
+
+/**************************************/
+
+int Spectrice_Fork(struct Spectrice_t *Dst, const struct Spectrice_t *State, int BlockIdx, const float *PrimingInput) {
+	int n, Chan;
+	int nChan     = State->nChan;
+	int BlockSize = State->BlockSize;
+
+	//! Copy the whole state (including the window), then re-base pointers
+	char *Buf = malloc(SPECTRICE_BUFFER_ALIGNMENT-1 + State->BufferSize);
+	if(!Buf) return 0;
+	*Dst = *State;
+	Dst->BufferData = Buf;
+	Buf += (-(uintptr_t)Buf) & (SPECTRICE_BUFFER_ALIGNMENT-1);
+	{
+		const char *SrcBuf = (const char*)State->Window;
+		memcpy(Buf, SrcBuf, State->BufferSize);
+#define REBASE(Name) Dst->Name = (float*)(Buf + ((const char*)State->Name - SrcBuf))
+		REBASE(Window);
+		REBASE(BfTemp);
+		REBASE(BfInvLap);
+		REBASE(BfFwdLap);
+		REBASE(BfAbs);
+		REBASE(BfArg);
+		REBASE(BfArgOld);
+		REBASE(BfArgStep);
+#undef REBASE
+	}
+
+	//! Set the overlap buffers as they were after block BlockIdx-2. Because
+	//! each hop only overlaps the next BlockSize samples, BfInvLap can start
+	//! out empty: all contributions from before block BlockIdx-1 are flushed
+	//! out by the time block BlockIdx is output, and block BlockIdx-1 fills
+	//! in the rest.
+	for(Chan=0;Chan<nChan;Chan++) {
+		float *BfFwdLap = Dst->BfFwdLap + Chan*BlockSize;
+		float *BfInvLap = Dst->BfInvLap + Chan*BlockSize;
+		for(n=0;n<BlockSize;n++) {
+			BfFwdLap[n] = PrimingInput[n*nChan + Chan];
+			BfInvLap[n] = 0.0f;
+		}
+	}
+	Dst->BlockIdx = BlockIdx-1;
+	ResetStats(Dst);
+	ClearStatsCounters(Dst);
+	Dst->Telemetry    = NULL;
+	Dst->SpectrumFunc = NULL;
+	Spectrice_Process(Dst, NULL, PrimingInput + BlockSize*nChan);
+	return 1;
+}
+
+/**************************************/
+
+//! Saved state layout:
+//!  StateHeader_t Header;
+//!  char _Padding[STATE_DATA_OFFSET - sizeof(Header)];
+//!  char BufferData[Header.DataSize]; //! As laid out by GetBufferLayout()
+#define STATE_MAGIC       "SPXS"
+#define STATE_VERSION     3
+#define STATE_BYTE_ORDER  0x01020304u
+#define STATE_DATA_OFFSET (SPECTRICE_BUFFER_ALIGNMENT*2)
+
+struct StateHeader_t {
+	char     Magic[4];
+	uint32_t Version;
+	uint32_t ByteOrder;
+	uint32_t DataSize;
+	int32_t  nChan;
+	int32_t  BlockSize;
+	int32_t  nHops;
+	int32_t  FreezeStart;
+	int32_t  FreezePoint;
+	float    FreezeFactor;
+	int32_t  FreezeAmp;
+	int32_t  FreezePhase;
+	int32_t  FastMath;
+	float    SilenceThreshold;
+	int32_t  FreezeBinLo;
+	int32_t  FreezeBinHi;
+	int32_t  HaveSnapshot;
+	int32_t  BlockIdx;
+	int32_t  WindowType;
+};
+
+size_t Spectrice_GetStateSize(const struct Spectrice_t *State) {
+	struct BufferLayout_t Layout;
+	GetBufferLayout(&Layout, State);
+	return STATE_DATA_OFFSET + Layout.Size;
+}
+
+void Spectrice_SaveState(const struct Spectrice_t *State, void *Data) {
+	struct BufferLayout_t Layout;
+	GetBufferLayout(&Layout, State);
+
+	//! Fill out header, then copy the buffers as-is
+	//! NOTE: Buffers always follow GetBufferLayout() from Window onwards,
+	//! even if the memory was re-used from a larger allocation, so we only
+	//! need Layout.Size bytes.
+	struct StateHeader_t *Header = (struct StateHeader_t*)Data;
+	memset(Data, 0, STATE_DATA_OFFSET);
+	memcpy(Header->Magic, STATE_MAGIC, 4);
+	Header->Version      = STATE_VERSION;
+	Header->ByteOrder    = STATE_BYTE_ORDER;
+	Header->DataSize     = Layout.Size;
+	Header->nChan        = State->nChan;
+	Header->BlockSize    = State->BlockSize;
+	Header->nHops        = State->nHops;
+	Header->FreezeStart  = State->FreezeStart;
+	Header->FreezePoint  = State->FreezePoint;
+	Header->FreezeFactor = State->FreezeFactor;
+	Header->FreezeAmp    = State->FreezeAmp;
+	Header->FreezePhase  = State->FreezePhase;
+	Header->FastMath     = State->FastMath;
+	Header->SilenceThreshold = State->SilenceThreshold;
+	Header->FreezeBinLo  = State->FreezeBinLo;
+	Header->FreezeBinHi  = State->FreezeBinHi;
+	Header->HaveSnapshot = State->HaveSnapshot;
+	Header->BlockIdx     = State->BlockIdx;
+	Header->WindowType   = State->WindowType;
+	memcpy((char*)Data + STATE_DATA_OFFSET, State->Window, Layout.Size);
+}
+
+int Spectrice_LoadState(struct Spectrice_t *State, const void *Data, size_t DataSize) {
+	//! Check header
+	const struct StateHeader_t *Header = (const struct StateHeader_t*)Data;
+	State->BufferData = NULL;
+	if(DataSize < STATE_DATA_OFFSET) return 0;
+	if(memcmp(Header->Magic, STATE_MAGIC, 4) != 0) return 0;
+	if(Header->Version != STATE_VERSION || Header->ByteOrder != STATE_BYTE_ORDER) return 0;
+
+	//! Restore parameters and make sure they give the same layout
+	struct BufferLayout_t Layout;
+	State->nChan        = Header->nChan;
+	State->BlockSize    = Header->BlockSize;
+	State->nHops        = Header->nHops;
+	State->FreezeStart  = Header->FreezeStart;
+	State->FreezePoint  = Header->FreezePoint;
+	State->FreezeFactor = Header->FreezeFactor;
+	State->FreezeAmp    = Header->FreezeAmp;
+	State->FreezePhase  = Header->FreezePhase;
+	State->FastMath     = Header->FastMath;
+	State->SilenceThreshold = Header->SilenceThreshold;
+	State->FreezeBinLo  = Header->FreezeBinLo;
+	State->FreezeBinHi  = Header->FreezeBinHi;
+	State->HaveSnapshot = Header->HaveSnapshot;
+	if(!GetBufferLayout(&Layout, State)) return 0;
+	if(Header->DataSize != (uint32_t)Layout.Size || DataSize - STATE_DATA_OFFSET < Header->DataSize) return 0;
+
+	//! Allocate and copy buffers
+	char *Buf = malloc(SPECTRICE_BUFFER_ALIGNMENT-1 + Layout.Size);
+	if(!Buf) return 0;
+	State->BufferData = Buf;
+	State->BufferSize = Layout.Size;
+	Buf += (-(uintptr_t)Buf) & (SPECTRICE_BUFFER_ALIGNMENT-1);
+	memcpy(Buf, (const char*)Data + STATE_DATA_OFFSET, Layout.Size);
+	SetBufferPointers(State, Buf, &Layout);
+	State->BlockIdx   = Header->BlockIdx;
+	State->WindowType = Header->WindowType;
+	State->WindowSize = State->BlockSize;
+	State->WindowHops = State->nHops;
+	SetSilenceLevel(State);
+	ResetStats(State);
+	ClearStatsHooks(State);
+	State->Telemetry    = NULL;
+	State->SpectrumFunc = NULL;
+	return 1;
+}
+
+/**************************************/
+
+void Spectrice_SetTelemetry(struct Spectrice_t *State, struct Spectrice_Telemetry_t *Telemetry) {
+	State->Telemetry = Telemetry;
+}
+
+void Spectrice_SetSpectrumFunc(struct Spectrice_t *State, Spectrice_SpectrumFunc_t Func, void *User) {
+	State->SpectrumUser = User;
+	State->SpectrumFunc = Func;
+}
+
+/**************************************/
+
+#ifdef SPECTRICE_STATS
+//! Get the timer frequency, in ticks per second
+static double GetStatsTickRate(void) {
+# if defined(SPECTRICE_STATS_TSC)
+	//! Calibrate the TSC against the monotonic clock on first use
+	//! NOTE: Racing threads would all arrive at much the same value.
+	static double TickRate = 0.0;
+	if(TickRate == 0.0) {
+		struct timespec t0, t1;
+		uint64_t Ticks0, Ticks1;
+		double Elapsed;
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		Ticks0 = __rdtsc();
+		do {
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+			Elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec)*1.0e-9;
+		} while(Elapsed < 0.01);
+		Ticks1 = __rdtsc();
+		TickRate = (Ticks1 - Ticks0) / Elapsed;
+	}
+	return TickRate;
+# elif defined(_WIN32)
+	LARGE_INTEGER Freq;
+	QueryPerformanceFrequency(&Freq);
+	return (double)Freq.QuadPart;
+# else
+	return 1.0e9;
+# endif
+}
+#endif
+
+int Spectrice_GetStats(const struct Spectrice_t *State, struct Spectrice_Stats_t *Stats) {
+#ifdef SPECTRICE_STATS
+	int Stage, n;
+	double TickRate = GetStatsTickRate();
+	for(Stage=0;Stage<SPECTRICE_STAGE_COUNT;Stage++) {
+		Stats->Time[Stage] += State->StatsTicks[Stage] / TickRate;
+		for(n=0;n<State->nStatsCounters;n++) Stats->Counters[Stage][n] += (double)State->StatsCounters[Stage][n];
+	}
+	Stats->nHops        += State->StatsHops;
+	Stats->nCounterHops += State->StatsCounterHops;
+	if(Stats->nCounters < State->nStatsCounters) Stats->nCounters = State->nStatsCounters;
+	return 1;
+#else
+	(void)State;
+	(void)Stats;
+	return 0;
+#endif
+}
+
+int Spectrice_SetStatsCounters(struct Spectrice_t *State, Spectrice_StatsCounterFunc_t Func, void *User, int nCounters) {
+#ifdef SPECTRICE_STATS
+	if(Func && (nCounters < 1 || nCounters > SPECTRICE_STATS_MAX_COUNTERS)) return 0;
+	State->nStatsCounters   = Func ? nCounters : 0;
+	State->StatsCounterUser = User;
+	State->StatsCounterFunc = Func;
+	return 1;
+#else
+	(void)State;
+	(void)Func;
+	(void)User;
+	(void)nCounters;
+	return 0;
+#endif
+}
+
+int Spectrice_SetStatsStageFunc(struct Spectrice_t *State, Spectrice_StatsStageFunc_t Func, void *User) {
+#ifdef SPECTRICE_STATS
+	State->StatsStageUser = User;
+	State->StatsStageFunc = Func;
+	return 1;
+#else
+	(void)State;
+	(void)Func;
+	(void)User;
+	return 0;
+#endif
+}
+
+const char *Spectrice_GetStageName(int Stage) {
+	static const char *const Names[SPECTRICE_STAGE_COUNT] = {
+		"window",
+		"fft",
+		"polar",
+		"ifft",
+		"overlap",
+		"shift",
+	};
+	return (Stage >= 0 && Stage < SPECTRICE_STAGE_COUNT) ? Names[Stage] : NULL;
+}
+
+/**************************************/
+
+const char *Spectrice_GetSIMDName(void) {
+#if defined(__AVX__) && defined(__FMA__)
+	return "avx+fma";
+#elif defined(__AVX__)
+	return "avx";
+#elif defined(__SSE__) && defined(__FMA__)
+	return "sse+fma";
+#elif defined(__SSE__)
+	return "sse";
+#else
+	return "scalar";
+#endif
+}
+
+/**************************************/
+
 void Spectrice_Destroy(struct Spectrice_t *State) {
 	//! Free buffer space
 	free(State->BufferData);
+	State->BufferData = NULL;
 }
 
 /**************************************/
@@ -0,0 +1,453 @@
+/**************************************/
+//! Spectrice: Spectral Freezing Tool
+//! Copyright (C) 2022, Ruben Nunez (Aikku; aik AT aol DOT com DOT au)
+//! Refer to the project README file for license terms.
+/**************************************/
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/**************************************/
+#include "../bench/Bench.h"
+#include "../bench/Signal.h"
+#include "Fourier.h"
+#include "Hash.h"
+#include "Spectrice.h"
+/**************************************/
+
+//! Transform sizes to check
+#define MIN_DCT_SIZE 8
+#define MIN_FFT_SIZE 16
+#define MAX_SIZE     65536
+
+//! Mixed-radix sizes to check (for the FFT only), covering radix-3 and
+//! radix-5 stages on their own and together
+static const int MixedSizes[] = { 48, 80, 240, 720, 1600, 6144, 12288, 15360, 61440 };
+#define N_MIXED_SIZES (int)(sizeof(MixedSizes) / sizeof(MixedSizes[0]))
+
+//! Above this size, only a sample of output lines is checked against the
+//! (quadratic) reference
+#define MAX_FULL_CHECK_SIZE 4096
+#define N_SAMPLED_LINES     256
+
+//! Error bounds (relative RMS error against the reference)
+//! Rounding grows with the number of stages (log2(N)), and the error of the
+//! twiddle factor recurrences grows linearly with N, so the bound for a
+//! transform is TRANSFORM_ERROR_PER_STAGE*log2(N) + TRANSFORM_ERROR_PER_LINE*N.
+#define TRANSFORM_ERROR_PER_STAGE 2.0e-7
+#define TRANSFORM_ERROR_PER_LINE  1.0e-9
+
+//! Identity reconstruction goes through a forward and inverse transform
+//! and the polar conversions, so its bound is IDENTITY_ERROR_PER_STAGE *
+//! log2(BlockSize)
+#define IDENTITY_ERROR_PER_STAGE  4.0e-7
+
+//! Identity check parameters
+#define IDENTITY_N_BLOCKS 16
+#define IDENTITY_N_CHAN   2
+
+//! Golden render parameters
+#define GOLDEN_SAMPLE_RATE 48000
+#define GOLDEN_N_SAMPLES   (GOLDEN_SAMPLE_RATE*2)
+#define MAX_GOLDEN         64
+
+/**************************************/
+
+//! Transform type
+#define XFORM_FFT  0
+#define XFORM_IFFT 1
+#define XFORM_DCT2 2
+#define XFORM_DCT4 3
+
+static const struct {
+	const char *Name;
+	void (*Func)(float *Buf, float *Tmp, int N);
+	int MinSize;
+	int MixedRadix;
+} Transforms[] = {
+	{ "FFTReCenter",  Fourier_FFTReCenter,  MIN_FFT_SIZE, 1 },
+	{ "iFFTReCenter", Fourier_iFFTReCenter, MIN_FFT_SIZE, 1 },
+	{ "DCT2",         Fourier_DCT2,         MIN_DCT_SIZE, 0 },
+	{ "DCT4",         Fourier_DCT4,         MIN_DCT_SIZE, 0 },
+};
+#define N_TRANSFORMS (int)(sizeof(Transforms) / sizeof(Transforms[0]))
+
+static const char *const WindowNames[] = { "sine", "hann", "hamming", "blackman", "nuttall", "sqrtcos", "kbd" };
+#define N_WINDOWS (int)(sizeof(WindowNames) / sizeof(WindowNames[0]))
+
+/**************************************/
+
+//! Check if a transform is checked at size N
+static int IsCheckedSize(int Type, int N) {
+	int i;
+	if(N < Transforms[Type].MinSize) return 0;
+	if((N & (N-1)) == 0) return 1;
+	if(Transforms[Type].MixedRadix) for(i=0;i<N_MIXED_SIZES;i++) if(MixedSizes[i] == N) return 1;
+	return 0;
+}
+
+//! Reference transforms, for output line k of input x[N]
+//! Phases are reduced exactly (in integers) before calling cos()/sin(),
+//! using Cos[m] = cos(2Pi*m/M) with M = 8N.
+//!  FFT:  X[k] = Sum[x[n] * Exp[+2Pi*i*(n-(N-1)/2)(k+1/2)/N], {n,0,N-1}], k < N/2
+//!  iFFT: x[n] = Re[Sum[X[k] * Exp[-2Pi*i*(n-(N-1)/2)(k+1/2)/N], {k,0,N/2-1}]]
+//!  DCT2: X[k] = Sum[x[n] * Cos[Pi*(n+1/2)k/N], {n,0,N-1}]
+//!  DCT4: X[k] = Sum[x[n] * Cos[Pi*(n+1/2)(k+1/2)/N], {n,0,N-1}]
+static void ReferenceLine(double *Out, const float *x, int N, int Type, int k, const double *Cos) {
+	int n;
+	int64_t M = 8*(int64_t)N;
+	double Re = 0.0, Im = 0.0;
+	switch(Type) {
+		case XFORM_FFT: {
+			//! (n-(N-1)/2)(k+1/2)/N = (2n-N+1)(2k+1) / 4N = 2*(...) / 8N
+			for(n=0;n<N;n++) {
+				int64_t m = (2*(int64_t)n - N + 1) * (2*k + 1) * 2;
+				m %= M; if(m < 0) m += M;
+				Re += x[n] * Cos[m];
+				Im += x[n] * Cos[(m + M - M/4) % M]; //! sin(a) = cos(a - Pi/2)
+			}
+		} break;
+
+		case XFORM_IFFT: {
+			//! Input is N/2 complex lines; output sample k
+			for(n=0;n<N/2;n++) {
+				int64_t m = (2*(int64_t)k - N + 1) * (2*n + 1) * 2;
+				m %= M; if(m < 0) m += M;
+				//! Re[(a+ib) * Exp[-i*t]] = a*cos(t) + b*sin(t)
+				Re += x[n*2+0] * Cos[m] + x[n*2+1] * Cos[(m + M - M/4) % M];
+			}
+		} break;
+
+		case XFORM_DCT2: {
+			//! Pi*(n+1/2)k/N = 2Pi * (2n+1)k*2 / 8N
+			for(n=0;n<N;n++) Re += x[n] * Cos[((2*(int64_t)n + 1) * k * 2) % M];
+		} break;
+
+		case XFORM_DCT4: {
+			//! Pi*(n+1/2)(k+1/2)/N = 2Pi * (2n+1)(2k+1) / 8N
+			for(n=0;n<N;n++) Re += x[n] * Cos[((2*(int64_t)n + 1) * (2*k + 1)) % M];
+		} break;
+	}
+	Out[0] = Re;
+	Out[1] = Im;
+}
+
+//! Check one transform at one size
+//! Returns the relative RMS error.
+static double CheckTransform(int Type, int N, float *Buf, float *Tmp, float *Src, double *Cos) {
+	int n, i;
+	struct Signal_Random_t Rand;
+	Signal_RandomSeed(&Rand, N*N_TRANSFORMS + Type);
+	for(n=0;n<N;n++) Src[n] = Buf[n] = Signal_RandomFloat(&Rand);
+	for(n=0;n<8*N;n++) Cos[n] = cos(2.0*M_PI * n / (8.0*N));
+	Transforms[Type].Func(Buf, Tmp, N);
+
+	//! FFT output is N/2 complex lines, everything else is N real values
+	int IsComplex = (Type == XFORM_FFT);
+	int nLines    = IsComplex ? N/2 : N;
+	int nChecked  = (N <= MAX_FULL_CHECK_SIZE) ? nLines : N_SAMPLED_LINES;
+	double ErrSum = 0.0, RefSum = 0.0;
+	for(i=0;i<nChecked;i++) {
+		//! Sample lines evenly, with a random offset within each stride
+		int k = i;
+		if(nChecked < nLines) k = i*(nLines/nChecked) + (int)((Signal_RandomFloat(&Rand)*0.5f + 0.5f) * (nLines/nChecked));
+		double Ref[2];
+		ReferenceLine(Ref, Src, N, Type, k, Cos);
+		if(IsComplex) {
+			double dRe = Buf[k*2+0] - Ref[0];
+			double dIm = Buf[k*2+1] - Ref[1];
+			ErrSum += dRe*dRe + dIm*dIm;
+			RefSum += Ref[0]*Ref[0] + Ref[1]*Ref[1];
+		} else {
+			double d = Buf[k] - Ref[0];
+			ErrSum += d*d;
+			RefSum += Ref[0]*Ref[0];
+		}
+	}
+	return sqrt(ErrSum / RefSum);
+}
+
+/**************************************/
+
+//! Check that a state with FreezeFactor = 0 reconstructs its input
+//! Output lags input by exactly one block.
+//! Returns the relative RMS error (after the first two blocks, which
+//! contain the fade-in), or -1.0 if the combination isn't supported.
+static double CheckIdentity(int WindowType, int BlockSize, int nHops) {
+	int n;
+	int nChan   = IDENTITY_N_CHAN;
+	int nSmp    = IDENTITY_N_BLOCKS * BlockSize;
+	int Latency = BlockSize;
+	struct Spectrice_t State;
+	State.nChan        = nChan;
+	State.BlockSize    = BlockSize;
+	State.nHops        = nHops;
+	State.FreezeStart  = 0;
+	State.FreezePoint  = 0;
+	State.FreezeFactor = 0.0f;
+	State.FreezeAmp    = 1;
+	State.FreezePhase  = 0;
+	State.FastMath     = 0;
+	State.SilenceThreshold = 0.0f;
+	State.FreezeBinLo  = 0;
+	State.FreezeBinHi  = BlockSize/2;
+	if(!Spectrice_Init(&State, WindowType, NULL, NULL)) return -1.0;
+
+	float *Input  = malloc(sizeof(float) * nSmp * nChan * 2);
+	float *Output = Input + nSmp*nChan;
+	if(!Input) {
+		Spectrice_Destroy(&State);
+		return INFINITY;
+	}
+	Signal_Generate(Input, SIGNAL_TYPE_MIX, nChan, nSmp, GOLDEN_SAMPLE_RATE, 1);
+	for(n=0;n<IDENTITY_N_BLOCKS;n++) {
+		Spectrice_Process(&State, Output + n*BlockSize*nChan, Input + n*BlockSize*nChan);
+	}
+	double ErrSum = 0.0, RefSum = 0.0;
+	for(n=2*BlockSize*nChan;n<nSmp*nChan;n++) {
+		double Ref = Input[n - Latency*nChan];
+		double d   = Output[n] - Ref;
+		ErrSum += d*d;
+		RefSum += Ref*Ref;
+	}
+	free(Input);
+	Spectrice_Destroy(&State);
+	return sqrt(ErrSum / RefSum);
+}
+
+/**************************************/
+
+//! Golden render configuration
+struct GoldenConfig_t {
+	const char *Name;
+	int   Signal;
+	int   nChan;
+	int   BlockSize;
+	int   nHops;
+	int   WindowType;
+	float FreezeFactor;
+	int   FreezePhase;
+	int   Snapshot;
+};
+
+static const struct GoldenConfig_t GoldenConfigs[] = {
+	{ "mix2-1024x8-nuttall-amp",      SIGNAL_TYPE_MIX,   2, 1024, 8, SPECTRICE_WINDOW_TYPE_NUTTALL,  1.0f, 0, 0 },
+	{ "mix2-4096x4-hann-amp",         SIGNAL_TYPE_MIX,   2, 4096, 4, SPECTRICE_WINDOW_TYPE_HANN,     1.0f, 0, 0 },
+	{ "sweep1-2048x8-blackman-phase", SIGNAL_TYPE_SWEEP, 1, 2048, 8, SPECTRICE_WINDOW_TYPE_BLACKMAN, 1.0f, 1, 0 },
+	{ "decay2-512x4-hamming-partial", SIGNAL_TYPE_DECAY, 2,  512, 4, SPECTRICE_WINDOW_TYPE_HAMMING,  0.5f, 0, 0 },
+	{ "noise1-8192x2-sine-none",      SIGNAL_TYPE_NOISE, 1, 8192, 2, SPECTRICE_WINDOW_TYPE_SINE,     0.0f, 0, 0 },
+	{ "mix6-1024x8-nuttall-snapshot", SIGNAL_TYPE_MIX,   6, 1024, 8, SPECTRICE_WINDOW_TYPE_NUTTALL,  1.0f, 0, 1 },
+	{ "mix2-1024x4-sqrtcos-amp",      SIGNAL_TYPE_MIX,   2, 1024, 4, SPECTRICE_WINDOW_TYPE_SQRTCOS,  1.0f, 0, 0 },
+	{ "decay1-2048x4-kbd-partial",    SIGNAL_TYPE_DECAY, 1, 2048, 4, SPECTRICE_WINDOW_TYPE_KBD,      0.5f, 0, 0 },
+	{ "mix2-1536x6-hann-amp",         SIGNAL_TYPE_MIX,   2, 1536, 6, SPECTRICE_WINDOW_TYPE_HANN,     1.0f, 0, 0 },
+	{ "sweep1-2560x5-blackman-phase", SIGNAL_TYPE_SWEEP, 1, 2560, 5, SPECTRICE_WINDOW_TYPE_BLACKMAN, 1.0f, 1, 0 },
+};
+#define N_GOLDEN_CONFIGS (int)(sizeof(GoldenConfigs) / sizeof(GoldenConfigs[0]))
+
+//! Render a configuration and hash the output
+//! Returns 1 on success, or 0 on failure.
+static int RenderGolden(uint64_t *Hash, const struct GoldenConfig_t *Cfg) {
+	int n;
+	int nChan     = Cfg->nChan;
+	int BlockSize = Cfg->BlockSize;
+	int nBlocks   = GOLDEN_N_SAMPLES / BlockSize;
+	int nSmp      = nBlocks * BlockSize;
+	float *Input  = malloc(sizeof(float) * (nSmp + BlockSize) * nChan);
+	float *Output = Input + nSmp*nChan;
+	if(!Input) return 0;
+	Signal_Generate(Input, Cfg->Signal, nChan, nSmp, GOLDEN_SAMPLE_RATE, 1);
+
+	struct Spectrice_t State;
+	State.nChan        = nChan;
+	State.BlockSize    = BlockSize;
+	State.nHops        = Cfg->nHops;
+	State.FreezeStart  = nSmp / 4;
+	State.FreezePoint  = nSmp / 2;
+	State.FreezeFactor = Cfg->FreezeFactor;
+	State.FreezeAmp    = 1;
+	State.FreezePhase  = Cfg->FreezePhase;
+	State.FastMath     = 0;
+	State.SilenceThreshold = 0.0f;
+	State.FreezeBinLo  = 0;
+	State.FreezeBinHi  = BlockSize/2;
+	if(!Spectrice_Init(&State, Cfg->WindowType, Input, Cfg->Snapshot ? (Input + (nSmp/2)*nChan) : NULL)) {
+		free(Input);
+		return 0;
+	}
+	*Hash = HASH_FNV1A64_INIT;
+	for(n=1;n<nBlocks;n++) {
+		Spectrice_Process(&State, Output, Input + n*BlockSize*nChan);
+		*Hash = Hash_FNV1a64(*Hash, Output, sizeof(float) * BlockSize * nChan);
+	}
+	Spectrice_Destroy(&State);
+	free(Input);
+	return 1;
+}
+
+//! Golden hash file
+//! Each line contains a configuration name and its output hash.
+struct Golden_t {
+	char     Name[64];
+	uint64_t Hash;
+};
+
+static int ReadGolden(struct Golden_t *Golden, const char *Filename) {
+	int nGolden = 0;
+	FILE *File = fopen(Filename, "r");
+	if(!File) return -1;
+	char Line[256];
+	while(nGolden < MAX_GOLDEN && fgets(Line, sizeof(Line), File)) {
+		if(Line[0] == '#') continue;
+		struct Golden_t *g = &Golden[nGolden];
+		if(sscanf(Line, "%63s %" SCNx64, g->Name, &g->Hash) == 2) nGolden++;
+	}
+	fclose(File);
+	return nGolden;
+}
+
+/**************************************/
+
+int main(int argc, const char *argv[]) {
+	int n, t, N;
+	int nFailed = 0;
+	const char *GoldenFilename = NULL;
+	int UpdateGolden = 0;
+	struct Bench_Options_t Opt;
+	Bench_DefaultOptions(&Opt);
+	for(n=1;n<argc;n++) {
+		if(Bench_ParseOption(&Opt, argv[n])) continue;
+		if(!memcmp(argv[n], "-golden:", 8)) GoldenFilename = argv[n] + 8;
+		else if(!strcmp(argv[n], "-updategolden")) UpdateGolden = 1;
+		else {
+			printf(
+				"Test_Accuracy - Accuracy and regression checks\n"
+				"Usage: Test_Accuracy [Opt]\n"
+				"Options:\n"
+				" -golden:FILE    - Compare end-to-end renders against the hashes in FILE.\n"
+				" -updategolden   - Write the current hashes to FILE instead.\n"
+				" -csv:FILE       - Write results to FILE as CSV.\n"
+				" -json:FILE      - Write results to FILE as JSON.\n"
+			);
+			return 1;
+		}
+	}
+	struct Bench_Output_t Out;
+	if(!Bench_Output_Open(&Out, &Opt, "accuracy")) return -1;
+
+	//! Transforms against the double-precision reference
+	{
+		float  *Buf = Bench_AlignedAlloc(sizeof(float) * MAX_SIZE);
+		float  *Tmp = Bench_AlignedAlloc(sizeof(float) * MAX_SIZE);
+		float  *Src = Bench_AlignedAlloc(sizeof(float) * MAX_SIZE);
+		double *Cos = malloc(sizeof(double) * MAX_SIZE * 8);
+		if(!Buf || !Tmp || !Src || !Cos) {
+			printf("ERROR: Couldn't allocate buffers.\n");
+			return -1;
+		}
+		printf("%-12s %6s %12s %12s\n", "Transform", "N", "RelRMSError", "Bound");
+		for(t=0;t<N_TRANSFORMS;t++) for(N=Transforms[t].MinSize;N<=MAX_SIZE;N++) {
+			if(!IsCheckedSize(t, N)) continue;
+			double Err   = CheckTransform(t, N, Buf, Tmp, Src, Cos);
+			double Bound = TRANSFORM_ERROR_PER_STAGE * log2(N) + TRANSFORM_ERROR_PER_LINE * N;
+			int    Ok    = (Err <= Bound);
+			nFailed += !Ok;
+			printf("%-12s %6d %12.3e %12.3e%s\n", Transforms[t].Name, N, Err, Bound, Ok ? "" : "  FAILED");
+			Bench_Output_Begin(&Out);
+			Bench_Output_Str(&Out, "check", "transform");
+			Bench_Output_Str(&Out, "name",  Transforms[t].Name);
+			Bench_Output_Int(&Out, "n",     N);
+			Bench_Output_Num(&Out, "error", Err);
+			Bench_Output_Num(&Out, "bound", Bound);
+			Bench_Output_Int(&Out, "ok",    Ok);
+			Bench_Output_End(&Out);
+		}
+		free(Cos);
+		Bench_AlignedFree(Src);
+		Bench_AlignedFree(Tmp);
+		Bench_AlignedFree(Buf);
+	}
+
+	//! Identity reconstruction for every supported window/hops combination
+	{
+		static const int BlockSizes[] = { 256, 4096, 1536, 1280 };
+		int w, b, nHops;
+		printf("\n%-12s %6s %5s %12s %12s\n", "Window", "Block", "Hops", "RelRMSError", "Bound");
+		for(w=0;w<N_WINDOWS;w++) for(b=0;b<(int)(sizeof(BlockSizes)/sizeof(BlockSizes[0]));b++) for(nHops=2;nHops<=32;nHops++) {
+			double Err = CheckIdentity(w, BlockSizes[b], nHops);
+			if(Err < 0.0) continue;
+			double Bound = IDENTITY_ERROR_PER_STAGE * log2(BlockSizes[b]);
+			int    Ok    = (Err <= Bound);
+			nFailed += !Ok;
+			printf("%-12s %6d %5d %12.3e %12.3e%s\n", WindowNames[w], BlockSizes[b], nHops, Err, Bound, Ok ? "" : "  FAILED");
+			char Name[64];
+			snprintf(Name, sizeof(Name), "%s-%dx%d", WindowNames[w], BlockSizes[b], nHops);
+			Bench_Output_Begin(&Out);
+			Bench_Output_Str(&Out, "check", "identity");
+			Bench_Output_Str(&Out, "name",  Name);
+			Bench_Output_Int(&Out, "n",     BlockSizes[b]);
+			Bench_Output_Num(&Out, "error", Err);
+			Bench_Output_Num(&Out, "bound", Bound);
+			Bench_Output_Int(&Out, "ok",    Ok);
+			Bench_Output_End(&Out);
+		}
+	}
+
+	//! Golden end-to-end renders
+	if(GoldenFilename) {
+		struct Golden_t Golden[MAX_GOLDEN];
+		int nGolden = UpdateGolden ? 0 : ReadGolden(Golden, GoldenFilename);
+		if(nGolden < 0) {
+			printf("ERROR: Unable to read golden hashes (%s).\n", GoldenFilename);
+			nFailed++;
+			nGolden = 0;
+		}
+		FILE *File = NULL;
+		if(UpdateGolden) {
+			File = fopen(GoldenFilename, "w");
+			if(!File) {
+				printf("ERROR: Unable to write golden hashes (%s).\n", GoldenFilename);
+				return -1;
+			}
+			fprintf(File, "# Golden output hashes for Test_Accuracy (regenerate with -updategolden)\n");
+		}
+		printf("\n%-30s %-16s %s\n", "Render", "Hash", "Result");
+		for(n=0;n<N_GOLDEN_CONFIGS;n++) {
+			const struct GoldenConfig_t *Cfg = &GoldenConfigs[n];
+			uint64_t Hash = 0;
+			const char *Result;
+			int Ok = RenderGolden(&Hash, Cfg);
+			if(!Ok) Result = "FAILED (render)";
+			else if(UpdateGolden) {
+				fprintf(File, "%s %016" PRIx64 "\n", Cfg->Name, Hash);
+				Result = "updated";
+			} else {
+				int i;
+				for(i=0;i<nGolden;i++) if(!strcmp(Golden[i].Name, Cfg->Name)) break;
+				if(i == nGolden)                Result = "FAILED (no golden hash)", Ok = 0;
+				else if(Golden[i].Hash != Hash) Result = "FAILED (mismatch)",       Ok = 0;
+				else                            Result = "ok";
+			}
+			nFailed += !Ok;
+			printf("%-30s %016" PRIx64 " %s\n", Cfg->Name, Hash, Result);
+			Bench_Output_Begin(&Out);
+			Bench_Output_Str(&Out, "check", "golden");
+			Bench_Output_Str(&Out, "name",  Cfg->Name);
+			Bench_Output_Int(&Out, "n",     Cfg->BlockSize);
+			Bench_Output_Num(&Out, "error", Ok ? 0.0 : 1.0);
+			Bench_Output_Num(&Out, "bound", 0.0);
+			Bench_Output_Int(&Out, "ok",    Ok);
+			Bench_Output_End(&Out);
+		}
+		if(File) fclose(File);
+	}
+
+	Bench_Output_Close(&Out);
+	if(nFailed) printf("\n%d check(s) FAILED.\n", nFailed);
+	else        printf("\nAll checks passed.\n");
+	return nFailed ? 1 : 0;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
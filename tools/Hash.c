@@ -0,0 +1,42 @@
+/**************************************/
+#include <stdio.h>
+#include <stdlib.h>
+/**************************************/
+#include "Hash.h"
+/**************************************/
+#define FILE_CHUNK_SIZE (1024*1024)
+/**************************************/
+
+uint64_t Hash_FNV1a64(uint64_t Hash, const void *Data, size_t Size) {
+	const uint8_t *Src = (const uint8_t*)Data;
+	while(Size--) {
+		Hash ^= *Src++;
+		Hash *= 0x100000001B3ull;
+	}
+	return Hash;
+}
+
+/**************************************/
+
+int Hash_FNV1a64File(uint64_t *Hash, const char *Filename) {
+	FILE *File = fopen(Filename, "rb");
+	if(!File) return 0;
+	uint8_t *Buf = malloc(FILE_CHUNK_SIZE);
+	if(!Buf) {
+		fclose(File);
+		return 0;
+	}
+
+	size_t Size;
+	uint64_t h = *Hash;
+	while((Size = fread(Buf, 1, FILE_CHUNK_SIZE, File)) > 0) h = Hash_FNV1a64(h, Buf, Size);
+	int Ok = !ferror(File);
+	free(Buf);
+	fclose(File);
+	if(Ok) *Hash = h;
+	return Ok;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
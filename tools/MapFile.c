@@ -0,0 +1,91 @@
+/**************************************/
+#include <stdio.h>
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+/**************************************/
+#include "MapFile.h"
+/**************************************/
+
+#ifdef _WIN32
+
+int MapFile_Open(struct MapFile_t *Map, const char *Filename) {
+	Map->Data = NULL;
+	Map->Size = 0;
+	Map->hFile = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(Map->hFile == INVALID_HANDLE_VALUE) return 0;
+
+	LARGE_INTEGER Size;
+	if(!GetFileSizeEx(Map->hFile, &Size) || Size.QuadPart == 0) {
+		CloseHandle(Map->hFile);
+		return 0;
+	}
+	Map->hMapping = CreateFileMappingA(Map->hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(!Map->hMapping) {
+		CloseHandle(Map->hFile);
+		return 0;
+	}
+	Map->Data = MapViewOfFile(Map->hMapping, FILE_MAP_READ, 0, 0, 0);
+	if(!Map->Data) {
+		CloseHandle(Map->hMapping);
+		CloseHandle(Map->hFile);
+		return 0;
+	}
+	Map->Size = (size_t)Size.QuadPart;
+	return 1;
+}
+
+void MapFile_Close(struct MapFile_t *Map) {
+	if(!Map->Data) return;
+	UnmapViewOfFile(Map->Data);
+	CloseHandle(Map->hMapping);
+	CloseHandle(Map->hFile);
+	Map->Data = NULL;
+}
+
+int MapFile_Rename(const char *SrcFilename, const char *DstFilename) {
+	return MoveFileExA(SrcFilename, DstFilename, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+#else
+
+int MapFile_Open(struct MapFile_t *Map, const char *Filename) {
+	Map->Data = NULL;
+	Map->Size = 0;
+	int fd = open(Filename, O_RDONLY);
+	if(fd < 0) return 0;
+
+	//! NOTE: The mapping stays valid after closing the descriptor.
+	struct stat st;
+	if(fstat(fd, &st) < 0 || st.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+	void *Data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(Data == MAP_FAILED) return 0;
+	Map->Data = Data;
+	Map->Size = (size_t)st.st_size;
+	return 1;
+}
+
+void MapFile_Close(struct MapFile_t *Map) {
+	if(!Map->Data) return;
+	munmap(Map->Data, Map->Size);
+	Map->Data = NULL;
+}
+
+int MapFile_Rename(const char *SrcFilename, const char *DstFilename) {
+	return rename(SrcFilename, DstFilename) == 0;
+}
+
+#endif
+
+/**************************************/
+//! EOF
+/**************************************/
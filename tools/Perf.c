@@ -0,0 +1,130 @@
+/**************************************/
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef __linux__
+# include <unistd.h>
+# include <sys/syscall.h>
+# include <linux/perf_event.h>
+#endif
+/**************************************/
+#include "Perf.h"
+/**************************************/
+
+static const char *const CounterNames[PERF_COUNTER_COUNT] = {
+	"cycles",
+	"instructions",
+	"l1d_loads",
+	"l1d_misses",
+	"llc_loads",
+	"llc_misses",
+	"branch_misses",
+};
+
+const char *Perf_GetCounterName(int Counter) {
+	return (Counter >= 0 && Counter < PERF_COUNTER_COUNT) ? CounterNames[Counter] : NULL;
+}
+
+int Perf_Has(const struct Perf_t *Perf, int Counter) {
+	return Perf->Fd[Counter] >= 0;
+}
+
+int Perf_GetParanoid(void) {
+	int Level = -2;
+#ifdef __linux__
+	FILE *File = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+	if(File) {
+		if(fscanf(File, "%d", &Level) != 1) Level = -2;
+		fclose(File);
+	}
+#endif
+	return Level;
+}
+
+/**************************************/
+#ifdef __linux__
+/**************************************/
+
+//! Set the perf event type and config for a counter
+static void SetEvent(struct perf_event_attr *Attr, int Counter) {
+#define CACHE_EVENT(Cache, Result) ((Cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | ((Result) << 16))
+	switch(Counter) {
+		case PERF_CYCLES:        Attr->type = PERF_TYPE_HARDWARE; Attr->config = PERF_COUNT_HW_CPU_CYCLES;       break;
+		case PERF_INSTRUCTIONS:  Attr->type = PERF_TYPE_HARDWARE; Attr->config = PERF_COUNT_HW_INSTRUCTIONS;     break;
+		case PERF_L1D_LOADS:     Attr->type = PERF_TYPE_HW_CACHE; Attr->config = CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_ACCESS); break;
+		case PERF_L1D_MISSES:    Attr->type = PERF_TYPE_HW_CACHE; Attr->config = CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_MISS);   break;
+		case PERF_LLC_LOADS:     Attr->type = PERF_TYPE_HW_CACHE; Attr->config = CACHE_EVENT(PERF_COUNT_HW_CACHE_LL,  PERF_COUNT_HW_CACHE_RESULT_ACCESS); break;
+		case PERF_LLC_MISSES:    Attr->type = PERF_TYPE_HW_CACHE; Attr->config = CACHE_EVENT(PERF_COUNT_HW_CACHE_LL,  PERF_COUNT_HW_CACHE_RESULT_MISS);   break;
+		case PERF_BRANCH_MISSES: Attr->type = PERF_TYPE_HARDWARE; Attr->config = PERF_COUNT_HW_BRANCH_MISSES;    break;
+	}
+#undef CACHE_EVENT
+}
+
+int Perf_Open(struct Perf_t *Perf) {
+	int Counter;
+	Perf->nOpen = 0;
+	Perf->Error = 0;
+	for(Counter=0;Counter<PERF_COUNTER_COUNT;Counter++) {
+		struct perf_event_attr Attr;
+		memset(&Attr, 0, sizeof(Attr));
+		Attr.size           = sizeof(Attr);
+		Attr.exclude_kernel = 1;
+		Attr.exclude_hv     = 1;
+		Attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		SetEvent(&Attr, Counter);
+		Perf->Fd[Counter] = (int)syscall(SYS_perf_event_open, &Attr, 0, -1, -1, 0);
+		if(Perf->Fd[Counter] >= 0) Perf->nOpen++;
+		else if(!Perf->Error) Perf->Error = errno;
+	}
+	return Perf->nOpen;
+}
+
+void Perf_Close(struct Perf_t *Perf) {
+	int Counter;
+	for(Counter=0;Counter<PERF_COUNTER_COUNT;Counter++) {
+		if(Perf->Fd[Counter] >= 0) close(Perf->Fd[Counter]);
+		Perf->Fd[Counter] = -1;
+	}
+	Perf->nOpen = 0;
+}
+
+void Perf_Read(const struct Perf_t *Perf, uint64_t *Values) {
+	int Counter;
+	for(Counter=0;Counter<PERF_COUNTER_COUNT;Counter++) {
+		//! Data is { Value, TimeEnabled, TimeRunning }
+		uint64_t Data[3];
+		Values[Counter] = 0;
+		if(Perf->Fd[Counter] < 0) continue;
+		if(read(Perf->Fd[Counter], Data, sizeof(Data)) != (ssize_t)sizeof(Data)) continue;
+		if(Data[2] == 0) continue;
+		Values[Counter] = (Data[2] < Data[1]) ? (uint64_t)((double)Data[0] * Data[1] / Data[2]) : Data[0];
+	}
+}
+
+/**************************************/
+#else
+/**************************************/
+
+int Perf_Open(struct Perf_t *Perf) {
+	int Counter;
+	for(Counter=0;Counter<PERF_COUNTER_COUNT;Counter++) Perf->Fd[Counter] = -1;
+	Perf->nOpen = 0;
+	Perf->Error = ENOSYS;
+	return 0;
+}
+
+void Perf_Close(struct Perf_t *Perf) {
+	Perf->nOpen = 0;
+}
+
+void Perf_Read(const struct Perf_t *Perf, uint64_t *Values) {
+	int Counter;
+	(void)Perf;
+	for(Counter=0;Counter<PERF_COUNTER_COUNT;Counter++) Values[Counter] = 0;
+}
+
+/**************************************/
+#endif
+/**************************************/
+//! EOF
+/**************************************/
@@ -0,0 +1,229 @@
+/**************************************/
+#include <pthread.h>
+#include <stdlib.h>
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <unistd.h>
+#endif
+/**************************************/
+#include "ThreadPool.h"
+/**************************************/
+
+//! Worker thread argument
+struct Worker_t {
+	struct ThreadPool_t *Pool;
+	int WorkerIdx;
+};
+
+/**************************************/
+
+int ThreadPool_GetCPUCount(void) {
+#ifdef _WIN32
+	SYSTEM_INFO Info;
+	GetSystemInfo(&Info);
+	int n = (int)Info.dwNumberOfProcessors;
+#else
+	int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return (n > 0) ? n : 1;
+}
+
+/**************************************/
+
+//! Push task to tail of queue
+//! NOTE: Queue must be locked.
+static int QueuePush(struct ThreadPool_Queue_t *Queue, const struct ThreadPool_Task_t *Task) {
+	//! Grow queue if needed
+	if(Queue->Tail == Queue->Capacity) {
+		int nTasks = Queue->Tail - Queue->Head;
+		if(Queue->Head > 0) {
+			//! Compact first
+			int n;
+			for(n=0;n<nTasks;n++) Queue->Tasks[n] = Queue->Tasks[Queue->Head+n];
+		} else {
+			int NewCapacity = Queue->Capacity ? (Queue->Capacity*2) : 64;
+			struct ThreadPool_Task_t *NewTasks = realloc(Queue->Tasks, NewCapacity * sizeof(struct ThreadPool_Task_t));
+			if(!NewTasks) return 0;
+			Queue->Tasks    = NewTasks;
+			Queue->Capacity = NewCapacity;
+		}
+		Queue->Head = 0;
+		Queue->Tail = nTasks;
+	}
+	Queue->Tasks[Queue->Tail++] = *Task;
+	return 1;
+}
+
+//! Take task from our own queue (head) or steal from another (tail)
+static int TakeTask(struct ThreadPool_t *Pool, int WorkerIdx, struct ThreadPool_Task_t *Task) {
+	int n, Found = 0;
+	for(n=0;n<Pool->nThreads && !Found;n++) {
+		struct ThreadPool_Queue_t *Queue = &Pool->Queues[(WorkerIdx + n) % Pool->nThreads];
+		pthread_mutex_lock(&Queue->Lock);
+		if(Queue->Head < Queue->Tail) {
+			if(n == 0) *Task = Queue->Tasks[Queue->Head++];
+			else       *Task = Queue->Tasks[--Queue->Tail];
+			Found = 1;
+		}
+		pthread_mutex_unlock(&Queue->Lock);
+	}
+	if(Found) {
+		pthread_mutex_lock(&Pool->Lock);
+		Pool->nQueued--;
+		pthread_mutex_unlock(&Pool->Lock);
+	}
+	return Found;
+}
+
+/**************************************/
+
+static void *WorkerThread(void *Arg) {
+	struct Worker_t     *Worker = (struct Worker_t*)Arg;
+	struct ThreadPool_t *Pool   = Worker->Pool;
+	int WorkerIdx = Worker->WorkerIdx;
+	free(Worker);
+
+	for(;;) {
+		//! Run tasks while there are any
+		struct ThreadPool_Task_t Task;
+		if(TakeTask(Pool, WorkerIdx, &Task)) {
+			Task.Func(Task.User, WorkerIdx);
+			pthread_mutex_lock(&Pool->Lock);
+			if(--Pool->nPending == 0) pthread_cond_broadcast(&Pool->DoneCond);
+			pthread_mutex_unlock(&Pool->Lock);
+			continue;
+		}
+
+		//! Sleep until more work arrives
+		int Exit = 0;
+		pthread_mutex_lock(&Pool->Lock);
+		while(!Pool->nQueued && !Pool->Shutdown) pthread_cond_wait(&Pool->WorkCond, &Pool->Lock);
+		if(!Pool->nQueued && Pool->Shutdown) Exit = 1;
+		pthread_mutex_unlock(&Pool->Lock);
+		if(Exit) break;
+	}
+	return NULL;
+}
+
+/**************************************/
+
+//! Signal shutdown and join the first nThreads workers
+static void StopWorkers(struct ThreadPool_t *Pool, int nThreads) {
+	pthread_mutex_lock(&Pool->Lock);
+	Pool->Shutdown = 1;
+	pthread_cond_broadcast(&Pool->WorkCond);
+	pthread_mutex_unlock(&Pool->Lock);
+	while(nThreads) pthread_join(Pool->Threads[--nThreads], NULL);
+}
+
+//! Free all resources (workers must be stopped)
+static void FreePool(struct ThreadPool_t *Pool) {
+	int n;
+	for(n=0;n<Pool->nThreads;n++) {
+		pthread_mutex_destroy(&Pool->Queues[n].Lock);
+		free(Pool->Queues[n].Tasks);
+	}
+	pthread_cond_destroy(&Pool->DoneCond);
+	pthread_cond_destroy(&Pool->WorkCond);
+	pthread_mutex_destroy(&Pool->Lock);
+	free(Pool->Queues);
+	free(Pool->Threads);
+}
+
+/**************************************/
+
+int ThreadPool_Create(struct ThreadPool_t *Pool, int nThreads) {
+	int n;
+	if(nThreads <= 0) nThreads = ThreadPool_GetCPUCount();
+
+	//! Set initial state
+	Pool->nThreads  = 0;
+	Pool->NextQueue = 0;
+	Pool->nQueued   = 0;
+	Pool->nPending  = 0;
+	Pool->Shutdown  = 0;
+	Pool->Threads   = malloc(nThreads * sizeof(pthread_t));
+	Pool->Queues    = malloc(nThreads * sizeof(struct ThreadPool_Queue_t));
+	if(!Pool->Threads || !Pool->Queues) {
+		free(Pool->Threads);
+		free(Pool->Queues);
+		return 0;
+	}
+	pthread_mutex_init(&Pool->Lock, NULL);
+	pthread_cond_init(&Pool->WorkCond, NULL);
+	pthread_cond_init(&Pool->DoneCond, NULL);
+	for(n=0;n<nThreads;n++) {
+		struct ThreadPool_Queue_t *Queue = &Pool->Queues[n];
+		pthread_mutex_init(&Queue->Lock, NULL);
+		Queue->Head     = 0;
+		Queue->Tail     = 0;
+		Queue->Capacity = 0;
+		Queue->Tasks    = NULL;
+	}
+
+	//! Queues must all exist before any worker can start stealing,
+	//! so set nThreads before spawning
+	Pool->nThreads = nThreads;
+	for(n=0;n<nThreads;n++) {
+		struct Worker_t *Worker = malloc(sizeof(struct Worker_t));
+		if(Worker) {
+			Worker->Pool      = Pool;
+			Worker->WorkerIdx = n;
+			if(pthread_create(&Pool->Threads[n], NULL, WorkerThread, Worker) == 0) continue;
+			free(Worker);
+		}
+
+		//! Failed to start this worker; shut down the ones we have
+		StopWorkers(Pool, n);
+		FreePool(Pool);
+		return 0;
+	}
+	return 1;
+}
+
+/**************************************/
+
+int ThreadPool_Submit(struct ThreadPool_t *Pool, ThreadPool_TaskFunc_t Func, void *User) {
+	struct ThreadPool_Task_t Task = {Func, User};
+	pthread_mutex_lock(&Pool->Lock);
+	struct ThreadPool_Queue_t *Queue = &Pool->Queues[Pool->NextQueue];
+	pthread_mutex_lock(&Queue->Lock);
+	int Ok = QueuePush(Queue, &Task);
+	pthread_mutex_unlock(&Queue->Lock);
+	if(Ok) {
+		Pool->NextQueue = (Pool->NextQueue + 1) % Pool->nThreads;
+		Pool->nQueued++;
+		Pool->nPending++;
+		pthread_cond_signal(&Pool->WorkCond);
+	}
+	pthread_mutex_unlock(&Pool->Lock);
+	return Ok;
+}
+
+/**************************************/
+
+int ThreadPool_GetQueued(struct ThreadPool_t *Pool) {
+	pthread_mutex_lock(&Pool->Lock);
+	int nQueued = Pool->nQueued;
+	pthread_mutex_unlock(&Pool->Lock);
+	return nQueued;
+}
+
+void ThreadPool_Wait(struct ThreadPool_t *Pool) {
+	pthread_mutex_lock(&Pool->Lock);
+	while(Pool->nPending) pthread_cond_wait(&Pool->DoneCond, &Pool->Lock);
+	pthread_mutex_unlock(&Pool->Lock);
+}
+
+/**************************************/
+
+void ThreadPool_Destroy(struct ThreadPool_t *Pool) {
+	//! Workers drain all queues before exiting
+	StopWorkers(Pool, Pool->nThreads);
+	FreePool(Pool);
+}
+
+/**************************************/
+//! EOF
+/**************************************/
@@ -0,0 +1,236 @@
+/**************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+# include <windows.h>
+#endif
+/**************************************/
+#include "Trace.h"
+/**************************************/
+
+//! Events per buffer chunk, and most events kept per thread
+#define CHUNK_EVENTS       4096
+#define MAX_THREAD_EVENTS  (1 << 22)
+
+/**************************************/
+
+//! Event types (as in the trace-event format)
+#define EVENT_SPAN    'X'
+#define EVENT_COUNTER 'C'
+
+struct TraceEvent_t {
+	const char *Name;
+	const char *ArgName;
+	uint64_t    Time;
+	uint64_t    Duration;
+	int32_t     Arg;
+	char        Type;
+};
+
+struct TraceChunk_t {
+	struct TraceChunk_t *Next;
+	int nEvents;
+	struct TraceEvent_t Events[CHUNK_EVENTS];
+};
+
+//! Per-thread buffer
+//! Only the owning thread ever writes to this, and it is only read back by
+//! Trace_Close() once all threads are done.
+struct TraceThread_t {
+	struct TraceThread_t *Next;
+	int      Tid;
+	int      Generation; //! Recording session this belongs to
+	int      nEvents;
+	int      nDropped;
+	uint64_t LapTime;
+	char     Name[32];
+	struct TraceChunk_t *Head;
+	struct TraceChunk_t *Tail;
+};
+
+int Trace_Enabled = 0;
+static int      Generation = 0;
+static int      NextTid    = 0;
+static uint64_t StartTime  = 0;
+static struct TraceThread_t *Threads = NULL;
+static __thread struct TraceThread_t *ThisThread = NULL;
+
+/**************************************/
+
+uint64_t Trace_GetTime(void) {
+#ifdef _WIN32
+	LARGE_INTEGER Freq, Count;
+	QueryPerformanceFrequency(&Freq);
+	QueryPerformanceCounter(&Count);
+	return (uint64_t)((double)Count.QuadPart * 1.0e9 / (double)Freq.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000u + ts.tv_nsec;
+#endif
+}
+
+//! Get the calling thread's buffer, registering it on first use
+//! Returns NULL if out of memory.
+static struct TraceThread_t *GetThread(void) {
+	struct TraceThread_t *Thread = ThisThread;
+	if(Thread && Thread->Generation == __atomic_load_n(&Generation, __ATOMIC_RELAXED)) return Thread;
+
+	//! Push onto the list of threads (lock-free)
+	Thread = calloc(1, sizeof(struct TraceThread_t));
+	if(!Thread) return NULL;
+	Thread->Tid        = __atomic_fetch_add(&NextTid, 1, __ATOMIC_RELAXED);
+	Thread->Generation = __atomic_load_n(&Generation, __ATOMIC_RELAXED);
+	Thread->LapTime    = Trace_GetTime();
+	Thread->Next = __atomic_load_n(&Threads, __ATOMIC_RELAXED);
+	while(!__atomic_compare_exchange_n(&Threads, &Thread->Next, Thread, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	ThisThread = Thread;
+	return Thread;
+}
+
+//! Append an event to the calling thread's buffer
+static struct TraceEvent_t *AddEvent(void) {
+	struct TraceThread_t *Thread = GetThread();
+	if(!Thread) return NULL;
+	if(Thread->nEvents >= MAX_THREAD_EVENTS) {
+		Thread->nDropped++;
+		return NULL;
+	}
+	struct TraceChunk_t *Chunk = Thread->Tail;
+	if(!Chunk || Chunk->nEvents == CHUNK_EVENTS) {
+		Chunk = malloc(sizeof(struct TraceChunk_t));
+		if(!Chunk) {
+			Thread->nDropped++;
+			return NULL;
+		}
+		Chunk->Next    = NULL;
+		Chunk->nEvents = 0;
+		if(Thread->Tail) Thread->Tail->Next = Chunk;
+		else Thread->Head = Chunk;
+		Thread->Tail = Chunk;
+	}
+	Thread->nEvents++;
+	return &Chunk->Events[Chunk->nEvents++];
+}
+
+/**************************************/
+
+void Trace_Open(void) {
+	StartTime = Trace_GetTime();
+	__atomic_store_n(&Trace_Enabled, 1, __ATOMIC_RELEASE);
+	Trace_SetThreadName("Main", 0);
+}
+
+void Trace_Record(const char *Name, uint64_t Begin, const char *ArgName, int Arg) {
+	uint64_t End = Trace_GetTime();
+	struct TraceEvent_t *Event = AddEvent();
+	if(!Event) return;
+	Event->Name     = Name;
+	Event->ArgName  = ArgName;
+	Event->Time     = Begin;
+	Event->Duration = End - Begin;
+	Event->Arg      = Arg;
+	Event->Type     = EVENT_SPAN;
+}
+
+void Trace_Lap(const char *Name, const char *ArgName, int Arg) {
+	struct TraceThread_t *Thread = GetThread();
+	if(!Thread) return;
+	uint64_t Begin = Thread->LapTime;
+	if(Name) Trace_Record(Name, Begin, ArgName, Arg);
+	Thread->LapTime = Trace_GetTime();
+}
+
+void Trace_Counter(const char *Name, int Value) {
+	struct TraceEvent_t *Event = AddEvent();
+	if(!Event) return;
+	Event->Name     = Name;
+	Event->ArgName  = NULL;
+	Event->Time     = Trace_GetTime();
+	Event->Duration = 0;
+	Event->Arg      = Value;
+	Event->Type     = EVENT_COUNTER;
+}
+
+void Trace_SetThreadName(const char *Fmt, int Idx) {
+	struct TraceThread_t *Thread = GetThread();
+	if(Thread) snprintf(Thread->Name, sizeof(Thread->Name), Fmt, Idx);
+}
+
+/**************************************/
+
+//! Convert a timestamp to microseconds since Trace_Open()
+static double ToMicroseconds(uint64_t Time) {
+	return (Time > StartTime) ? (Time - StartTime) * 1.0e-3 : 0.0;
+}
+
+int Trace_Close(const char *Filename) {
+	int Ok = 1;
+	__atomic_store_n(&Trace_Enabled, 0, __ATOMIC_RELEASE);
+
+	//! Take the list of threads, and start a new session
+	struct TraceThread_t *ThreadList = __atomic_exchange_n(&Threads, NULL, __ATOMIC_ACQUIRE);
+	__atomic_fetch_add(&Generation, 1, __ATOMIC_RELAXED);
+
+	//! Write events
+	FILE *File = fopen(Filename, "w");
+	if(File) {
+		int First = 1;
+		struct TraceThread_t *Thread;
+		fprintf(File, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+		for(Thread=ThreadList;Thread;Thread=Thread->Next) {
+			const struct TraceChunk_t *Chunk;
+			if(Thread->Name[0]) {
+				fprintf(
+					File, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+					First ? "" : ",", Thread->Tid, Thread->Name
+				);
+				First = 0;
+			}
+			if(Thread->nDropped) {
+				printf("WARNING: Trace buffer full; dropped %d events from thread %d.\n", Thread->nDropped, Thread->Tid);
+			}
+			for(Chunk=Thread->Head;Chunk;Chunk=Chunk->Next) {
+				int n;
+				for(n=0;n<Chunk->nEvents;n++) {
+					const struct TraceEvent_t *Event = &Chunk->Events[n];
+					fprintf(
+						File, "%s\n{\"name\": \"%s\", \"ph\": \"%c\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f",
+						First ? "" : ",", Event->Name, Event->Type, Thread->Tid, ToMicroseconds(Event->Time)
+					);
+					if(Event->Type == EVENT_SPAN) {
+						fprintf(File, ", \"dur\": %.3f", Event->Duration * 1.0e-3);
+						if(Event->ArgName) fprintf(File, ", \"args\": {\"%s\": %d}", Event->ArgName, (int)Event->Arg);
+					} else {
+						fprintf(File, ", \"args\": {\"value\": %d}", (int)Event->Arg);
+					}
+					fprintf(File, "}");
+					First = 0;
+				}
+			}
+		}
+		fprintf(File, "\n]}\n");
+		if(ferror(File)) Ok = 0;
+		if(fclose(File) != 0) Ok = 0;
+	} else Ok = 0;
+
+	//! Free everything
+	while(ThreadList) {
+		struct TraceThread_t *Next = ThreadList->Next;
+		while(ThreadList->Head) {
+			struct TraceChunk_t *NextChunk = ThreadList->Head->Next;
+			free(ThreadList->Head);
+			ThreadList->Head = NextChunk;
+		}
+		free(ThreadList);
+		ThreadList = Next;
+	}
+	ThisThread = NULL;
+	return Ok;
+}
+
+/**************************************/
+//! EOF
+/**************************************/
@@ -11,6 +11,12 @@ static inline float Clamp(float x, float Min, float Max) {
 	return (x < Min) ? Min : (x > Max) ? Max : x;
 }
 
+//! Check if x would be changed by clamping after rounding to an integer
+//! NOTE: Rounding is to even, so Max+0.5 rounds up and Min-0.5 doesn't.
+static inline uint32_t IsClipped(float x, float Min, float Max) {
+	return (x >= Max+0.5f) | (x < Min-0.5f);
+}
+
 /**************************************/
 
 const char *WAV_ErrorCodeToString(int e) {
@@ -37,12 +43,15 @@ void WAV_ConvertToFloat_PCM8u(float *Dst, const void *RawMem, uint32_t N) {
 	}
 }
 
-void WAV_ConvertFromFloat_PCM8u(void *RawDst, const float *Src, uint32_t N) {
-	uint32_t n;
+uint32_t WAV_ConvertFromFloat_PCM8u(void *RawDst, const float *Src, uint32_t N) {
+	uint32_t n, nClipped = 0;
 	int8_t *Dst = (int8_t*)RawDst;
 	for(n=0;n<N;n++) {
-		*Dst++ = (int8_t)lrintf(Clamp(*Src++ * 0x1.0p+7f, (float)-0x80, (float)+0x7F)) ^ 0x80;
+		float x = *Src++ * 0x1.0p+7f;
+		nClipped += IsClipped(x, (float)-0x80, (float)+0x7F);
+		*Dst++ = (int8_t)lrintf(Clamp(x, (float)-0x80, (float)+0x7F)) ^ 0x80;
 	}
+	return nClipped;
 }
 
 /**************************************/
@@ -55,12 +64,15 @@ void WAV_ConvertToFloat_PCM16(float *Dst, const void *RawMem, uint32_t N) {
 	}
 }
 
-void WAV_ConvertFromFloat_PCM16(void *RawDst, const float *Src, uint32_t N) {
-	uint32_t n;
+uint32_t WAV_ConvertFromFloat_PCM16(void *RawDst, const float *Src, uint32_t N) {
+	uint32_t n, nClipped = 0;
 	int16_t *Dst = (int16_t*)RawDst;
 	for(n=0;n<N;n++) {
-		*Dst++ = (int16_t)lrintf(Clamp(*Src++ * 0x1.0p+15f, (float)-0x8000, (float)+0x7FFF));
+		float x = *Src++ * 0x1.0p+15f;
+		nClipped += IsClipped(x, (float)-0x8000, (float)+0x7FFF);
+		*Dst++ = (int16_t)lrintf(Clamp(x, (float)-0x8000, (float)+0x7FFF));
 	}
+	return nClipped;
 }
 
 /**************************************/
@@ -76,15 +88,18 @@ void WAV_ConvertToFloat_PCM24(float *Dst, const void *RawMem, uint32_t N) {
 	}
 }
 
-void WAV_ConvertFromFloat_PCM24(void *RawDst, const float *Src, uint32_t N) {
-	uint32_t n;
+uint32_t WAV_ConvertFromFloat_PCM24(void *RawDst, const float *Src, uint32_t N) {
+	uint32_t n, nClipped = 0;
 	uint8_t *Dst = (uint8_t*)RawDst;
 	for(n=0;n<N;n++) {
-		uint32_t x = (uint32_t)lrintf(Clamp(*Src++ * 0x1.0p+23f, (float)-0x800000, (float)+0x7FFFFF));
+		float f = *Src++ * 0x1.0p+23f;
+		nClipped += IsClipped(f, (float)-0x800000, (float)+0x7FFFFF);
+		uint32_t x = (uint32_t)lrintf(Clamp(f, (float)-0x800000, (float)+0x7FFFFF));
 		*Dst++ = (int8_t)(x >> 0);
 		*Dst++ = (int8_t)(x >> 8);
 		*Dst++ = (int8_t)(x >> 16);
 	}
+	return nClipped;
 }
 
 /**************************************/
@@ -147,6 +162,9 @@ void WAV_Close(struct WAV_State_t *WavState) {
 		uint32_t RIFFSize = ftell(f) - 8;
 		fseek(f, 0+4, SEEK_SET);
 		fwrite(&RIFFSize, sizeof(uint32_t), 1, f);
+
+		//! Free local format copy (and packing buffer)
+		free(WavState->fmt);
 	}
 	fclose(f);
 }
@@ -18,9 +18,10 @@ void WAV_ConvertToFloat_PCM16(float *Dst, const void *RawMem, uint32_t N);
 void WAV_ConvertToFloat_PCM24(float *Dst, const void *RawMem, uint32_t N);
 
 //! Convert data from normalized float
-void WAV_ConvertFromFloat_PCM8u(void *RawDst, const float *Src, uint32_t N);
-void WAV_ConvertFromFloat_PCM16(void *RawDst, const float *Src, uint32_t N);
-void WAV_ConvertFromFloat_PCM24(void *RawDst, const float *Src, uint32_t N);
+//! Returns the number of samples that were clipped
+uint32_t WAV_ConvertFromFloat_PCM8u(void *RawDst, const float *Src, uint32_t N);
+uint32_t WAV_ConvertFromFloat_PCM16(void *RawDst, const float *Src, uint32_t N);
+uint32_t WAV_ConvertFromFloat_PCM24(void *RawDst, const float *Src, uint32_t N);
 
 /**************************************/
 
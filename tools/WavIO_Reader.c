@@ -76,6 +76,19 @@ static const struct RIFF_CkListHdl_t RIFF_WAVE[] = {
 
 /**************************************/
 
+//! Clean up chunks list on failure
+static void FreeChunks(struct WAV_State_t *WavState) {
+	struct WAV_Chunk_t *Ck = WavState->Chunks;
+	while(Ck) {
+		struct WAV_Chunk_t *Next = Ck->Next;
+		free(Ck);
+		Ck = Next;
+	}
+	WavState->Chunks = NULL;
+}
+
+/**************************************/
+
 int WAV_OpenR(struct WAV_State_t *WavState, const char *Filename) {
 	//! Attempt to open file
 	FILE *f = fopen(Filename, "rb");
@@ -83,8 +96,11 @@ int WAV_OpenR(struct WAV_State_t *WavState, const char *Filename) {
 
 	//! Map out the RIFF structure
 	WavState->Chunks = NULL;
+	WavState->fmt    = NULL;
+	WavState->dataCk = NULL;
 	int RetVal = RIFF_CkRead(f, WavState, NULL, RIFF_WAVE, RIFF_WAVE_CkDefault);
 	if(RetVal < 0) {
+		FreeChunks(WavState);
 		fclose(f);
 		return RetVal;
 	}
@@ -92,7 +108,11 @@ int WAV_OpenR(struct WAV_State_t *WavState, const char *Filename) {
 	//! Check to see if the format is supported
 	//! Check to see if this format is supported
 	struct WAVE_fmt_t *fmt = WavState->fmt;
-	if(!fmt->nChannels) return WAV_EINVALID;
+	if(!fmt || !WavState->dataCk || !fmt->nChannels) {
+		FreeChunks(WavState);
+		fclose(f);
+		return WAV_EINVALID;
+	}
 	WavState->nSamplePoints = WavState->dataCk->CkSize / fmt->nChannels;
 	switch(fmt->wFormatTag) {
 		case WAVE_FORMAT_PCM: {
@@ -106,6 +126,7 @@ int WAV_OpenR(struct WAV_State_t *WavState, const char *Filename) {
 				WavState->nSamplePoints /= 3; //! Yeah, looks ugly and out of place
 			}
 			else {
+				FreeChunks(WavState);
 				fclose(f);
 				return WAV_EUNSUPPORTED;
 			}
@@ -115,6 +136,7 @@ int WAV_OpenR(struct WAV_State_t *WavState, const char *Filename) {
 				WavState->nSamplePoints /= sizeof(float);
 			}
 			else {
+				FreeChunks(WavState);
 				fclose(f);
 				return WAV_EUNSUPPORTED;
 			}
@@ -124,6 +146,8 @@ int WAV_OpenR(struct WAV_State_t *WavState, const char *Filename) {
 	WavState->File           = f;
 	WavState->Mode           = WAV_STATE_MODE_READ;
 	WavState->SamplePosition = 0;
+	WavState->nDataBytes     = 0;
+	WavState->nClipped       = 0;
 	return 0;
 }
 
@@ -141,7 +165,10 @@ uint32_t WAV_ReadAsFloat(struct WAV_State_t *WavState, float *Dst, uint32_t nSmp
 	//! Read data to the end of the target memory to allow unpacking
 	void *RawMem = (void*)((uintptr_t)(Dst + nSmpPoints*fmt->nChannels) - nSmpPoints*SmpPointSize);
 	uint32_t nSmpPointsRead = fread(RawMem, SmpPointSize, nSmpPoints, WavState->File);
-	if(WavState->SamplePosition+nSmpPointsRead > WavState->nSamplePoints) {
+	WavState->nDataBytes += (uint64_t)nSmpPointsRead * SmpPointSize;
+	if(WavState->SamplePosition >= WavState->nSamplePoints) {
+		nSmpPointsRead = 0;
+	} else if(WavState->SamplePosition+nSmpPointsRead > WavState->nSamplePoints) {
 		nSmpPointsRead = WavState->nSamplePoints - WavState->SamplePosition;
 	}
 
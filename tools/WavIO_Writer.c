@@ -1,23 +1,30 @@
 /**************************************/
 #include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+# include <io.h>
+#else
+# include <unistd.h>
+#endif
 /**************************************/
 #include "MiniRIFF.h"
 #include "WavIO.h"
 #include "WavIO_Helper.h"
 /**************************************/
 #define PACK_BUFFER_SIZE (64*1024)
-/**************************************/
-
-static uint8_t PackBuffer[PACK_BUFFER_SIZE];
 
 /**************************************/
 
 int WAV_OpenW(struct WAV_State_t *WavState, const char *Filename, const struct WAVE_fmt_t *fmt) {
-	//! Create a local copy of the format
-	struct WAVE_fmt_t *fmtCopy = malloc(sizeof(struct WAVE_fmt_t));
+	//! Create a local copy of the format, followed by the packing buffer
+	//! NOTE: The packing buffer belongs to this file (rather than being
+	//! shared), so that several files may be written at once from different
+	//! threads.
+	struct WAVE_fmt_t *fmtCopy = malloc(sizeof(struct WAVE_fmt_t) + PACK_BUFFER_SIZE);
 	if(!fmtCopy) return WAV_ENOMEM;
 	*fmtCopy = *fmt;
-	WavState->fmt = fmtCopy;
+	WavState->fmt        = fmtCopy;
+	WavState->PackBuffer = (uint8_t*)(fmtCopy + 1);
 
 	//! Attempt to open file
 	FILE *f = fopen(Filename, "wb");
@@ -57,6 +64,74 @@ int WAV_OpenW(struct WAV_State_t *WavState, const char *Filename, const struct W
 	WavState->File           = f;
 	WavState->Mode           = WAV_STATE_MODE_WRITE;
 	WavState->SamplePosition = 0;
+	WavState->nDataBytes     = 0;
+	WavState->nClipped       = 0;
+	WavState->Chunks         = NULL;
+	return 0;
+}
+
+/**************************************/
+
+int WAV_ResumeW(struct WAV_State_t *WavState, const char *Filename, const struct WAVE_fmt_t *fmt, uint32_t nSmpPoints) {
+	//! Create a local copy of the format, followed by the packing buffer
+	struct WAVE_fmt_t *fmtCopy = malloc(sizeof(struct WAVE_fmt_t) + PACK_BUFFER_SIZE);
+	if(!fmtCopy) return WAV_ENOMEM;
+	*fmtCopy = *fmt;
+	WavState->fmt        = fmtCopy;
+	WavState->PackBuffer = (uint8_t*)(fmtCopy + 1);
+
+	//! Attempt to open file
+	FILE *f = fopen(Filename, "r+b");
+	if(!f) {
+		free(fmtCopy);
+		return WAV_ENOFILE;
+	}
+
+	//! Check that we wrote this file, with this format
+	//! NOTE: The RIFF and data sizes are only written on closing, so
+	//! they are ignored.
+	struct {
+		uint32_t RIFFType, RIFFSize, WAVEType;
+		uint32_t fmtType, fmtSize;
+		struct WAVE_fmt_t fmt;
+		uint32_t dataType, dataSize;
+	} Header;
+	long DataEnd = (long)sizeof(Header) + (long)nSmpPoints * fmt->nBlockAlign;
+	int Valid = (fread(&Header, sizeof(Header), 1, f) == 1);
+	if(Valid) Valid = (
+		Header.RIFFType == RIFF_FOURCC("RIFF") &&
+		Header.WAVEType == RIFF_FOURCC("WAVE") &&
+		Header.fmtType  == RIFF_FOURCC("fmt ") &&
+		Header.fmtSize  == sizeof(struct WAVE_fmt_t) &&
+		Header.dataType == RIFF_FOURCC("data") &&
+		!memcmp(&Header.fmt, fmt, sizeof(struct WAVE_fmt_t))
+	);
+	if(Valid) Valid = (fseek(f, 0, SEEK_END) == 0 && ftell(f) >= DataEnd);
+	if(!Valid) {
+		fclose(f);
+		free(fmtCopy);
+		return WAV_EINVALID;
+	}
+
+	//! Drop anything past the data we're keeping, and continue from there
+	fflush(f);
+#ifdef _WIN32
+	int Error = _chsize_s(_fileno(f), DataEnd);
+#else
+	int Error = ftruncate(fileno(f), DataEnd);
+#endif
+	if(Error || fseek(f, DataEnd, SEEK_SET) != 0) {
+		fclose(f);
+		free(fmtCopy);
+		return WAV_EIO;
+	}
+
+	//! Set the state
+	WavState->File           = f;
+	WavState->Mode           = WAV_STATE_MODE_WRITE;
+	WavState->SamplePosition = nSmpPoints * fmt->nChannels;
+	WavState->nDataBytes     = 0;
+	WavState->nClipped       = 0;
 	WavState->Chunks         = NULL;
 	return 0;
 }
@@ -65,12 +140,14 @@ int WAV_OpenW(struct WAV_State_t *WavState, const char *Filename, const struct W
 
 int WAV_WriteFromFloat(struct WAV_State_t *WavState, const float *Src, uint32_t nSmpPoints) {
 	struct WAVE_fmt_t *fmt = WavState->fmt;
+	uint8_t *PackBuffer = WavState->PackBuffer;
 
 	//! If we're already targetting 32bit float, just write directly
 	uint32_t nTotalWriteSmp = 0;
 	uint32_t SmpSize = fmt->wBitsPerSample/8;
 	if(fmt->wFormatTag == WAVE_FORMAT_IEEE_FLOAT) {
 		nTotalWriteSmp = fwrite(Src, sizeof(float)*fmt->nChannels, nSmpPoints, WavState->File);
+		WavState->nDataBytes += (uint64_t)nTotalWriteSmp * sizeof(float)*fmt->nChannels;
 	} else {
 		//! While we have data to process, keep packing
 		uint32_t nSmpRem = nSmpPoints*fmt->nChannels;
@@ -83,17 +160,18 @@ int WAV_WriteFromFloat(struct WAV_State_t *WavState, const float *Src, uint32_t
 
 			//! Perform conversion
 			       if(fmt->wFormatTag == WAVE_FORMAT_PCM && fmt->wBitsPerSample == 8) {
-				WAV_ConvertFromFloat_PCM8u(PackBuffer, Src, nProcessSmp);
+				WavState->nClipped += WAV_ConvertFromFloat_PCM8u(PackBuffer, Src, nProcessSmp);
 			} else if(fmt->wFormatTag == WAVE_FORMAT_PCM && fmt->wBitsPerSample == 16) {
-				WAV_ConvertFromFloat_PCM16(PackBuffer, Src, nProcessSmp);
+				WavState->nClipped += WAV_ConvertFromFloat_PCM16(PackBuffer, Src, nProcessSmp);
 			} else if(fmt->wFormatTag == WAVE_FORMAT_PCM && fmt->wBitsPerSample == 24) {
-				WAV_ConvertFromFloat_PCM24(PackBuffer, Src, nProcessSmp);
+				WavState->nClipped += WAV_ConvertFromFloat_PCM24(PackBuffer, Src, nProcessSmp);
 			}
 			Src += nProcessSmp;
 
 			//! Dump data to file
 			uint32_t nWriteSmp = fwrite(PackBuffer, SmpSize, nProcessSmp, WavState->File);
 			nTotalWriteSmp += nWriteSmp;
+			WavState->nDataBytes += (uint64_t)nWriteSmp * SmpSize;
 			if(nWriteSmp != nProcessSmp) break;
 		}
 	}
@@ -103,6 +181,9 @@ int WAV_WriteFromFloat(struct WAV_State_t *WavState, const float *Src, uint32_t
 	return nTotalWriteSmp / SmpSize;
 }
 
+//! External definition of the inline function, for when it isn't inlined
+extern inline void WAV_Flush(struct WAV_State_t *WavState);
+
 /**************************************/
 //! EOF
 /**************************************/